@@ -27,9 +27,9 @@ int ConfigPinMap::_pinMapALen = sizeof(ConfigPinMap::_pinMapA) / sizeof(int);
 
 #else
 
-int ConfigPinMap::_pinMapOtherStr[] = {};
+const char *ConfigPinMap::_pinMapOtherStr[] = {};
 int ConfigPinMap::_pinMapOtherPin[] = {};
-int ConfigPinMap::_pinMapOtherLen = sizeof(ConfigPinMap::_pinMapOther) / sizeof(int);
+int ConfigPinMap::_pinMapOtherLen = sizeof(ConfigPinMap::_pinMapOtherPin) / sizeof(int);
 
 #if PLATFORM_ID == 6    // Photon
 int ConfigPinMap::_pinMapD[] = {D0, D1, D2, D3, D4, D5, D6, D7};
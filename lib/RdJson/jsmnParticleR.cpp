@@ -3,6 +3,7 @@
 // Rob Dobson 2017-2018
 
 #include <ArduinoLog.h>
+#include <string.h>
 #include "jsmnParticleR.h"
 
 /**
@@ -9,17 +9,21 @@
 #include <ArduinoLog.h>
 #include "RobotConsts.h"
 
+// Maths in the motion and kinematics code is single precision - the ESP32 FPU doesn't support double
+// so each double operation is done in software. Values which accumulate over many operations are
+// kept as integers (e.g. step positions) or recomputed from a reference (e.g. interpolated points)
+// rather than relying on double precision
 class AxisUtils
 {
 public:
-    static double cosineRule(double a, double b, double c);
-    static double wrapRadians(double angle);
-    static double wrapDegrees(double angle);
+    static float cosineRule(float a, float b, float c);
+    static float wrapRadians(float angle);
+    static float wrapDegrees(float angle);
     static float wrapFloat(float x, float min, float max);
-    static double r2d(double angleRadians);
-    static double d2r(double angleDegrees);
-    static bool isApprox(double v1, double v2, double withinRng = 0.0001);
-    static bool isApproxWrap(double v1, double v2, double wrapSize=360.0, double withinRng = 0.0001);
+    static float r2d(float angleRadians);
+    static float d2r(float angleDegrees);
+    static bool isApprox(float v1, float v2, float withinRng = 0.0001f);
+    static bool isApproxWrap(float v1, float v2, float wrapSize = 360.0f, float withinRng = 0.0001f);
 };
 
 class AxisFloats
@@ -243,7 +247,7 @@ class AxisFloats
                 distSum += sq;
             }
         }
-        return sqrt(distSum);
+        return sqrtf(distSum);
     }
     void logDebugStr(const char *prefixStr) {}
     String toJSON()
@@ -0,0 +1,132 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+#include "FastTrig.h"
+
+// Angle (radians -PI..PI) of the point x, y - the ratio of the smaller to the larger of |x| and |y|
+// is looked up in the atan table and the result is mapped to the octant of the point
+float FastTrig::atan2Rad(float y, float x)
+{
+    float absX = fabsf(x);
+    float absY = fabsf(y);
+    if ((absX == 0) && (absY == 0))
+        return 0;
+    bool steep = absY > absX;
+    float ratio = steep ? absX / absY : absY / absX;
+    float tablePos = ratio * ATAN_TABLE_SIZE;
+    int32_t tableIdx = int32_t(tablePos);
+    if (tableIdx >= ATAN_TABLE_SIZE)
+        tableIdx = ATAN_TABLE_SIZE - 1;
+    float angle = _atanTable[tableIdx] + (tablePos - tableIdx) * (_atanTable[tableIdx + 1] - _atanTable[tableIdx]);
+    if (steep)
+        angle = float(M_PI / 2) - angle;
+    if (x < 0)
+        angle = float(M_PI) - angle;
+    return (y < 0) ? -angle : angle;
+}
+
+// sin(2 * PI * i / SIN_TABLE_SIZE) for i = 0..SIN_TABLE_SIZE
+const float FastTrig::_sinTable[SIN_TABLE_SIZE + 1] = {
+    0.0f, 0.0122715383f, 0.0245412285f, 0.0368072229f, 0.0490676743f, 0.0613207363f, 0.0735645636f, 0.0857973123f,
+    0.0980171403f, 0.110222207f, 0.122410675f, 0.134580709f, 0.146730474f, 0.158858143f, 0.170961889f, 0.183039888f,
+    0.195090322f, 0.207111376f, 0.21910124f, 0.231058108f, 0.24298018f, 0.25486566f, 0.266712757f, 0.278519689f,
+    0.290284677f, 0.302005949f, 0.31368174f, 0.325310292f, 0.336889853f, 0.34841868f, 0.359895037f, 0.371317194f,
+    0.382683432f, 0.39399204f, 0.405241314f, 0.41642956f, 0.427555093f, 0.438616239f, 0.44961133f, 0.460538711f,
+    0.471396737f, 0.482183772f, 0.492898192f, 0.503538384f, 0.514102744f, 0.524589683f, 0.53499762f, 0.545324988f,
+    0.555570233f, 0.565731811f, 0.575808191f, 0.585797857f, 0.595699304f, 0.605511041f, 0.615231591f, 0.624859488f,
+    0.634393284f, 0.643831543f, 0.653172843f, 0.662415778f, 0.671558955f, 0.680600998f, 0.689540545f, 0.698376249f,
+    0.707106781f, 0.715730825f, 0.724247083f, 0.732654272f, 0.740951125f, 0.749136395f, 0.757208847f, 0.765167266f,
+    0.773010453f, 0.780737229f, 0.788346428f, 0.795836905f, 0.803207531f, 0.810457198f, 0.817584813f, 0.824589303f,
+    0.831469612f, 0.838224706f, 0.844853565f, 0.851355193f, 0.85772861f, 0.863972856f, 0.870086991f, 0.876070094f,
+    0.881921264f, 0.88763962f, 0.893224301f, 0.898674466f, 0.903989293f, 0.909167983f, 0.914209756f, 0.919113852f,
+    0.923879533f, 0.92850608f, 0.932992799f, 0.937339012f, 0.941544065f, 0.945607325f, 0.949528181f, 0.95330604f,
+    0.956940336f, 0.960430519f, 0.963776066f, 0.966976471f, 0.970031253f, 0.972939952f, 0.97570213f, 0.978317371f,
+    0.98078528f, 0.983105487f, 0.985277642f, 0.987301418f, 0.98917651f, 0.990902635f, 0.992479535f, 0.99390697f,
+    0.995184727f, 0.996312612f, 0.997290457f, 0.998118113f, 0.998795456f, 0.999322385f, 0.999698819f, 0.999924702f,
+    1.0f, 0.999924702f, 0.999698819f, 0.999322385f, 0.998795456f, 0.998118113f, 0.997290457f, 0.996312612f,
+    0.995184727f, 0.99390697f, 0.992479535f, 0.990902635f, 0.98917651f, 0.987301418f, 0.985277642f, 0.983105487f,
+    0.98078528f, 0.978317371f, 0.97570213f, 0.972939952f, 0.970031253f, 0.966976471f, 0.963776066f, 0.960430519f,
+    0.956940336f, 0.95330604f, 0.949528181f, 0.945607325f, 0.941544065f, 0.937339012f, 0.932992799f, 0.92850608f,
+    0.923879533f, 0.919113852f, 0.914209756f, 0.909167983f, 0.903989293f, 0.898674466f, 0.893224301f, 0.88763962f,
+    0.881921264f, 0.876070094f, 0.870086991f, 0.863972856f, 0.85772861f, 0.851355193f, 0.844853565f, 0.838224706f,
+    0.831469612f, 0.824589303f, 0.817584813f, 0.810457198f, 0.803207531f, 0.795836905f, 0.788346428f, 0.780737229f,
+    0.773010453f, 0.765167266f, 0.757208847f, 0.749136395f, 0.740951125f, 0.732654272f, 0.724247083f, 0.715730825f,
+    0.707106781f, 0.698376249f, 0.689540545f, 0.680600998f, 0.671558955f, 0.662415778f, 0.653172843f, 0.643831543f,
+    0.634393284f, 0.624859488f, 0.615231591f, 0.605511041f, 0.595699304f, 0.585797857f, 0.575808191f, 0.565731811f,
+    0.555570233f, 0.545324988f, 0.53499762f, 0.524589683f, 0.514102744f, 0.503538384f, 0.492898192f, 0.482183772f,
+    0.471396737f, 0.460538711f, 0.44961133f, 0.438616239f, 0.427555093f, 0.41642956f, 0.405241314f, 0.39399204f,
+    0.382683432f, 0.371317194f, 0.359895037f, 0.34841868f, 0.336889853f, 0.325310292f, 0.31368174f, 0.302005949f,
+    0.290284677f, 0.278519689f, 0.266712757f, 0.25486566f, 0.24298018f, 0.231058108f, 0.21910124f, 0.207111376f,
+    0.195090322f, 0.183039888f, 0.170961889f, 0.158858143f, 0.146730474f, 0.134580709f, 0.122410675f, 0.110222207f,
+    0.0980171403f, 0.0857973123f, 0.0735645636f, 0.0613207363f, 0.0490676743f, 0.0368072229f, 0.0245412285f, 0.0122715383f,
+    1.2246468e-16f, -0.0122715383f, -0.0245412285f, -0.0368072229f, -0.0490676743f, -0.0613207363f, -0.0735645636f, -0.0857973123f,
+    -0.0980171403f, -0.110222207f, -0.122410675f, -0.134580709f, -0.146730474f, -0.158858143f, -0.170961889f, -0.183039888f,
+    -0.195090322f, -0.207111376f, -0.21910124f, -0.231058108f, -0.24298018f, -0.25486566f, -0.266712757f, -0.278519689f,
+    -0.290284677f, -0.302005949f, -0.31368174f, -0.325310292f, -0.336889853f, -0.34841868f, -0.359895037f, -0.371317194f,
+    -0.382683432f, -0.39399204f, -0.405241314f, -0.41642956f, -0.427555093f, -0.438616239f, -0.44961133f, -0.460538711f,
+    -0.471396737f, -0.482183772f, -0.492898192f, -0.503538384f, -0.514102744f, -0.524589683f, -0.53499762f, -0.545324988f,
+    -0.555570233f, -0.565731811f, -0.575808191f, -0.585797857f, -0.595699304f, -0.605511041f, -0.615231591f, -0.624859488f,
+    -0.634393284f, -0.643831543f, -0.653172843f, -0.662415778f, -0.671558955f, -0.680600998f, -0.689540545f, -0.698376249f,
+    -0.707106781f, -0.715730825f, -0.724247083f, -0.732654272f, -0.740951125f, -0.749136395f, -0.757208847f, -0.765167266f,
+    -0.773010453f, -0.780737229f, -0.788346428f, -0.795836905f, -0.803207531f, -0.810457198f, -0.817584813f, -0.824589303f,
+    -0.831469612f, -0.838224706f, -0.844853565f, -0.851355193f, -0.85772861f, -0.863972856f, -0.870086991f, -0.876070094f,
+    -0.881921264f, -0.88763962f, -0.893224301f, -0.898674466f, -0.903989293f, -0.909167983f, -0.914209756f, -0.919113852f,
+    -0.923879533f, -0.92850608f, -0.932992799f, -0.937339012f, -0.941544065f, -0.945607325f, -0.949528181f, -0.95330604f,
+    -0.956940336f, -0.960430519f, -0.963776066f, -0.966976471f, -0.970031253f, -0.972939952f, -0.97570213f, -0.978317371f,
+    -0.98078528f, -0.983105487f, -0.985277642f, -0.987301418f, -0.98917651f, -0.990902635f, -0.992479535f, -0.99390697f,
+    -0.995184727f, -0.996312612f, -0.997290457f, -0.998118113f, -0.998795456f, -0.999322385f, -0.999698819f, -0.999924702f,
+    -1.0f, -0.999924702f, -0.999698819f, -0.999322385f, -0.998795456f, -0.998118113f, -0.997290457f, -0.996312612f,
+    -0.995184727f, -0.99390697f, -0.992479535f, -0.990902635f, -0.98917651f, -0.987301418f, -0.985277642f, -0.983105487f,
+    -0.98078528f, -0.978317371f, -0.97570213f, -0.972939952f, -0.970031253f, -0.966976471f, -0.963776066f, -0.960430519f,
+    -0.956940336f, -0.95330604f, -0.949528181f, -0.945607325f, -0.941544065f, -0.937339012f, -0.932992799f, -0.92850608f,
+    -0.923879533f, -0.919113852f, -0.914209756f, -0.909167983f, -0.903989293f, -0.898674466f, -0.893224301f, -0.88763962f,
+    -0.881921264f, -0.876070094f, -0.870086991f, -0.863972856f, -0.85772861f, -0.851355193f, -0.844853565f, -0.838224706f,
+    -0.831469612f, -0.824589303f, -0.817584813f, -0.810457198f, -0.803207531f, -0.795836905f, -0.788346428f, -0.780737229f,
+    -0.773010453f, -0.765167266f, -0.757208847f, -0.749136395f, -0.740951125f, -0.732654272f, -0.724247083f, -0.715730825f,
+    -0.707106781f, -0.698376249f, -0.689540545f, -0.680600998f, -0.671558955f, -0.662415778f, -0.653172843f, -0.643831543f,
+    -0.634393284f, -0.624859488f, -0.615231591f, -0.605511041f, -0.595699304f, -0.585797857f, -0.575808191f, -0.565731811f,
+    -0.555570233f, -0.545324988f, -0.53499762f, -0.524589683f, -0.514102744f, -0.503538384f, -0.492898192f, -0.482183772f,
+    -0.471396737f, -0.460538711f, -0.44961133f, -0.438616239f, -0.427555093f, -0.41642956f, -0.405241314f, -0.39399204f,
+    -0.382683432f, -0.371317194f, -0.359895037f, -0.34841868f, -0.336889853f, -0.325310292f, -0.31368174f, -0.302005949f,
+    -0.290284677f, -0.278519689f, -0.266712757f, -0.25486566f, -0.24298018f, -0.231058108f, -0.21910124f, -0.207111376f,
+    -0.195090322f, -0.183039888f, -0.170961889f, -0.158858143f, -0.146730474f, -0.134580709f, -0.122410675f, -0.110222207f,
+    -0.0980171403f, -0.0857973123f, -0.0735645636f, -0.0613207363f, -0.0490676743f, -0.0368072229f, -0.0245412285f, -0.0122715383f,
+    -2.4492936e-16f
+};
+
+// atan(i / ATAN_TABLE_SIZE) for i = 0..ATAN_TABLE_SIZE
+const float FastTrig::_atanTable[ATAN_TABLE_SIZE + 1] = {
+    0.0f, 0.00390623013f, 0.00781234106f, 0.0117182136f, 0.0156237286f, 0.019528767f, 0.0234332099f, 0.0273369383f,
+    0.0312398334f, 0.0351417768f, 0.03904265f, 0.0429423347f, 0.0468407129f, 0.0507376669f, 0.0546330792f, 0.0585268326f,
+    0.06241881f, 0.0663088949f, 0.0701969711f, 0.0740829225f, 0.0779666338f, 0.0818479898f, 0.0857268758f, 0.0896031775f,
+    0.0934767812f, 0.0973475735f, 0.101215442f, 0.105080273f, 0.108941957f, 0.112800381f, 0.116655435f, 0.12050701f,
+    0.124354995f, 0.128199281f, 0.132039762f, 0.135876328f, 0.139708874f, 0.143537294f, 0.147361481f, 0.151181332f,
+    0.154996742f, 0.158807608f, 0.162613829f, 0.166415301f, 0.170211925f, 0.174003601f, 0.177790229f, 0.181571711f,
+    0.18534795f, 0.189118849f, 0.192884312f, 0.196644245f, 0.200398554f, 0.204147145f, 0.207889927f, 0.211626809f,
+    0.2153577f, 0.219082511f, 0.222801154f, 0.226513541f, 0.230219587f, 0.233919206f, 0.237612314f, 0.241298827f,
+    0.244978663f, 0.248651741f, 0.252317981f, 0.255977303f, 0.259629629f, 0.263274883f, 0.266912988f, 0.270543868f,
+    0.274167451f, 0.277783663f, 0.281392433f, 0.284993689f, 0.288587362f, 0.292173383f, 0.295751686f, 0.299322203f,
+    0.302884868f, 0.306439619f, 0.309986391f, 0.313525123f, 0.317055753f, 0.320578222f, 0.32409247f, 0.327598441f,
+    0.331096077f, 0.334585322f, 0.338066123f, 0.341538425f, 0.345002177f, 0.348457327f, 0.351903825f, 0.355341622f,
+    0.35877067f, 0.362190922f, 0.365602332f, 0.369004855f, 0.372398447f, 0.375783065f, 0.379158669f, 0.382525217f,
+    0.385882669f, 0.389230988f, 0.392570135f, 0.395900074f, 0.39922077f, 0.402532187f, 0.405834293f, 0.409127055f,
+    0.412410442f, 0.415684422f, 0.418948967f, 0.422204048f, 0.425449637f, 0.428685708f, 0.431912235f, 0.435129194f,
+    0.43833656f, 0.441534311f, 0.444722424f, 0.447900879f, 0.451069656f, 0.454228735f, 0.457378099f, 0.460517729f,
+    0.463647609f, 0.466767724f, 0.469878058f, 0.472978598f, 0.47606933f, 0.479150243f, 0.482221324f, 0.485282564f,
+    0.488333951f, 0.491375478f, 0.494407135f, 0.497428916f, 0.500440813f, 0.503442821f, 0.506434934f, 0.509417149f,
+    0.51238946f, 0.515351866f, 0.518304364f, 0.521246951f, 0.524179629f, 0.527102395f, 0.530015251f, 0.532918198f,
+    0.535811238f, 0.538694373f, 0.541567605f, 0.54443094f, 0.547284381f, 0.550127933f, 0.552961602f, 0.555785394f,
+    0.558599315f, 0.561403374f, 0.564197577f, 0.566981934f, 0.569756453f, 0.572521145f, 0.575276018f, 0.578021084f,
+    0.580756354f, 0.583481839f, 0.586197551f, 0.588903504f, 0.59159971f, 0.594286183f, 0.596962937f, 0.599629987f,
+    0.602287346f, 0.604935031f, 0.607573058f, 0.610201443f, 0.612820202f, 0.615429353f, 0.618028912f, 0.620618899f,
+    0.62319933f, 0.625770225f, 0.628331602f, 0.630883482f, 0.633425883f, 0.635958826f, 0.63848233f, 0.640996418f,
+    0.643501109f, 0.645996425f, 0.648482388f, 0.650959019f, 0.653426341f, 0.655884377f, 0.658333148f, 0.660772679f,
+    0.663202993f, 0.665624112f, 0.668036062f, 0.670438866f, 0.672832548f, 0.675217133f, 0.677592646f, 0.679959111f,
+    0.682316555f, 0.684665002f, 0.687004478f, 0.68933501f, 0.691656622f, 0.693969341f, 0.696273194f, 0.698568208f,
+    0.700854408f, 0.703131822f, 0.705400477f, 0.7076604f, 0.709911618f, 0.71215416f, 0.714388052f, 0.716613323f,
+    0.71883f, 0.721038111f, 0.723237685f, 0.725428749f, 0.727611333f, 0.729785464f, 0.731951171f, 0.734108483f,
+    0.736257429f, 0.738398037f, 0.740530337f, 0.742654356f, 0.744770126f, 0.746877674f, 0.748977029f, 0.751068222f,
+    0.753151281f, 0.755226236f, 0.757293116f, 0.759351951f, 0.76140277f, 0.763445603f, 0.765480479f, 0.767507428f,
+    0.76952648f, 0.771537665f, 0.773541012f, 0.77553655f, 0.77752431f, 0.779504322f, 0.781476615f, 0.783441219f,
+    0.785398163f
+};
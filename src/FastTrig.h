@@ -0,0 +1,49 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// Table based trigonometry for kinematics and path interpolation
+// Values are linearly interpolated between table entries and the maximum absolute errors are:
+//   sin, cos - 2e-5 (0.0012 degrees - 3um at a radius of 145mm)
+//   atan2    - 2e-6 radians
+// Angles are reduced to a single turn in float so angles which are many turns from zero should be
+// wrapped (in double) before calling (the float representation of the angle limits accuracy anyway)
+class FastTrig
+{
+public:
+    // Sin and cos of an angle in turns (1 turn = 360 degrees)
+    static inline void sinCosTurns(float turns, float &sinVal, float &cosVal)
+    {
+        float tablePos = (turns - floorf(turns)) * SIN_TABLE_SIZE;
+        int32_t tableIdx = int32_t(tablePos);
+        float frac = tablePos - tableIdx;
+        tableIdx &= SIN_TABLE_SIZE - 1;
+        int32_t cosIdx = (tableIdx + SIN_TABLE_SIZE / 4) & (SIN_TABLE_SIZE - 1);
+        sinVal = _sinTable[tableIdx] + frac * (_sinTable[tableIdx + 1] - _sinTable[tableIdx]);
+        cosVal = _sinTable[cosIdx] + frac * (_sinTable[cosIdx + 1] - _sinTable[cosIdx]);
+    }
+
+    static inline void sinCosDeg(float angleDegrees, float &sinVal, float &cosVal)
+    {
+        sinCosTurns(angleDegrees * (1.0f / 360), sinVal, cosVal);
+    }
+
+    static inline void sinCosRad(float angleRadians, float &sinVal, float &cosVal)
+    {
+        sinCosTurns(angleRadians * float(0.5 / M_PI), sinVal, cosVal);
+    }
+
+    // Angle (radians -PI..PI) of the point x, y - 0 if both are 0
+    static float atan2Rad(float y, float x);
+
+private:
+    static constexpr int32_t SIN_TABLE_SIZE = 512;
+    static constexpr int32_t ATAN_TABLE_SIZE = 256;
+    // Sin over one turn (with the first entry repeated at the end) and atan over 0..1 (both ends included)
+    static const float _sinTable[SIN_TABLE_SIZE + 1];
+    static const float _atanTable[ATAN_TABLE_SIZE + 1];
+};
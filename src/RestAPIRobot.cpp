@@ -11,6 +11,15 @@ void RestAPIRobot::apiQueryStatus(String &reqStr, String &respStr)
     _workManager.queryStatus(respStr);
 }
 
+void RestAPIRobot::apiISRStats(String &reqStr, String &respStr)
+{
+    // Optional argument "reset" clears the statistics after they are read
+    String argStr = RestAPIEndpoints::getNthArgStr(reqStr.c_str(), 1);
+    String statsStr;
+    _workManager.queryISRStats(statsStr, argStr.equalsIgnoreCase("reset"));
+    Utils::setJsonBoolResult(respStr, true, statsStr.c_str());
+}
+
 void RestAPIRobot::apiGetRobotTypes(String &reqStr, String &respStr)
 {
     Log.notice("%sGetRobotTypes\n", MODULE_PREFIX);
@@ -138,6 +147,11 @@ void RestAPIRobot::setup(RestAPIEndpoints &endpoints)
                             std::bind(&RestAPIRobot::apiQueryStatus, this, std::placeholders::_1, std::placeholders::_2),
                             "Query status");
                             
+    // Get motion ISR timing statistics
+    endpoints.addEndpoint("isrStats", RestAPIEndpointDef::ENDPOINT_CALLBACK, RestAPIEndpointDef::ENDPOINT_GET,
+                            std::bind(&RestAPIRobot::apiISRStats, this, std::placeholders::_1, std::placeholders::_2),
+                            "Motion ISR timing statistics, isrStats/reset to clear after reading");
+                            
     //LED Strip
     endpoints.addEndpoint("settings/led", RestAPIEndpointDef::ENDPOINT_CALLBACK, RestAPIEndpointDef::ENDPOINT_GET,
                             std::bind(&RestAPIRobot::apiGetLEDConfig, this, std::placeholders::_1, std::placeholders::_2),
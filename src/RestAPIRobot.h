@@ -22,6 +22,7 @@ class RestAPIRobot
     }
  
     void apiQueryStatus(String &reqStr, String &respStr);
+    void apiISRStats(String &reqStr, String &respStr);
     void apiGetRobotTypes(String &reqStr, String &respStr);
     void apiRobotConfiguration(String &reqStr, String &respStr);
     void apiGetSettings(String &reqStr, String &respStr);
@@ -17,6 +17,8 @@ class RobotCommandArgs
 private:
     // Flags
     bool _ptUnitsSteps : 1;
+    bool _ptUnitsPolar : 1;
+    bool _isArc : 1;
     bool _dontSplitMove : 1;
     bool _extrudeValid : 1;
     bool _feedrateValid : 1;
@@ -34,6 +36,9 @@ private:
     AxisFloats _ptInMM;
     AxisFloats _ptInCoordUnits;
     AxisInt32s _ptInSteps;
+    // Actuator step rates (steps per second) - status only
+    AxisFloats _stepRates;
+    AxisFloats _arcCentreOffset;
     float _extrudeValue;
     float _feedrateValue;
     RobotMoveTypeArg _moveType;
@@ -48,6 +53,8 @@ public:
     {
         // Flags
         _ptUnitsSteps = false;
+        _ptUnitsPolar = false;
+        _isArc = false;
         _dontSplitMove = false;
         _extrudeValid = false;
         _feedrateValid = false;
@@ -65,6 +72,8 @@ public:
         _ptInMM.clear();
         _ptInCoordUnits.clear();
         _ptInSteps.clear();
+        _stepRates.clear();
+        _arcCentreOffset.clear();
         _extrudeValue = 0.0;
         _feedrateValue = 0.0;
         _moveType = RobotMoveTypeArg_None;
@@ -82,6 +91,8 @@ public:
         bool isEqual =
             // Flags
             (_ptUnitsSteps == other._ptUnitsSteps) &&
+            (_ptUnitsPolar == other._ptUnitsPolar) &&
+            (_isArc == other._isArc) &&
             (_dontSplitMove == other._dontSplitMove) &&
             (_extrudeValid == other._extrudeValid) &&
             (_feedrateValid == other._feedrateValid) &&
@@ -125,6 +136,8 @@ private:
         clear();
         // Flags
         _ptUnitsSteps = copyFrom._ptUnitsSteps;
+        _ptUnitsPolar = copyFrom._ptUnitsPolar;
+        _isArc = copyFrom._isArc;
         _dontSplitMove = copyFrom._dontSplitMove;
         _extrudeValid = copyFrom._extrudeValid;
         _feedrateValid = copyFrom._feedrateValid;
@@ -140,6 +153,8 @@ private:
         _ptInMM = copyFrom._ptInMM;
         _ptInCoordUnits = copyFrom._ptInCoordUnits;
         _ptInSteps = copyFrom._ptInSteps;
+        _stepRates = copyFrom._stepRates;
+        _arcCentreOffset = copyFrom._arcCentreOffset;
         _extrudeValue = copyFrom._extrudeValue;
         _feedrateValue = copyFrom._feedrateValue;
         _moveType = copyFrom._moveType;
@@ -158,8 +173,51 @@ public:
             _ptInMM.setVal(axisIdx, value);
             _ptInMM.setValid(axisIdx, isValid);
             _ptUnitsSteps = false;
+            _ptUnitsPolar = false;
         }
     }
+    // Polar target (theta in degrees, rho as a fraction of the maximum radius)
+    // for robots whose kinematics are natively polar
+    void setPointPolar(float thetaDegrees, float rho)
+    {
+        _ptInCoordUnits.set(thetaDegrees, rho);
+        // Piggy-back on MM validity flags
+        _ptInMM.setValid(0, true);
+        _ptInMM.setValid(1, true);
+        _ptUnitsSteps = false;
+        _ptUnitsPolar = true;
+    }
+    void setPointPolar(AxisFloats& ptPolar)
+    {
+        setPointPolar(ptPolar.getVal(0), ptPolar.getVal(1));
+    }
+    AxisFloats &getPointPolar()
+    {
+        return _ptInCoordUnits;
+    }
+    // Arc (G2/G3) - the centre is given as an offset from the start point in the
+    // plane of the first two axes (I and J in GCode)
+    void setArc(bool clockwise)
+    {
+        _isArc = true;
+        _moveClockwise = clockwise;
+    }
+    bool isArc()
+    {
+        return _isArc;
+    }
+    bool isMoveClockwise()
+    {
+        return _moveClockwise;
+    }
+    void setArcCentreOffset(int axisIdx, float value)
+    {
+        _arcCentreOffset.setVal(axisIdx, value);
+    }
+    AxisFloats &getArcCentreOffset()
+    {
+        return _arcCentreOffset;
+    }
     void setAxisSteps(int axisIdx, int32_t value, bool isValid)
     {
         if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
@@ -168,6 +226,7 @@ public:
             // Piggy-back on MM validity flags
             _ptInMM.setValid(axisIdx, isValid);
             _ptUnitsSteps = true;
+            _ptUnitsPolar = false;
         }
     }
     void reverseStepDirection()
@@ -190,6 +249,10 @@ public:
     {
         return _ptUnitsSteps;
     }
+    bool isPolar()
+    {
+        return _ptUnitsPolar;
+    }
     // Indicate that all axes need to be homed
     void setAllAxesNeedHoming()
     {
@@ -224,6 +287,15 @@ public:
     {
         return _ptInSteps;
     }
+    // Step rates aren't compared by operator== as they change continuously while moving
+    void setStepRates(AxisFloats &stepRates)
+    {
+        _stepRates = stepRates;
+    }
+    AxisFloats &getStepRates()
+    {
+        return _stepRates;
+    }
     void setMoveType(RobotMoveTypeArg moveType)
     {
         _moveType = moveType;
@@ -351,6 +423,7 @@ public:
             jsonStr = "{";
         jsonStr += "\"XYZ\":" + _ptInMM.toJSON();
         jsonStr += ",\"ABC\":" + _ptInSteps.toJSON();
+        jsonStr += ",\"ABCv\":" + _stepRates.toJSON();
         if (_feedrateValid)
         {
             String feedrateStr = String(_feedrateValue, 2);
@@ -18,8 +18,13 @@ class AxesParams
   public:
     // Cache values for master axis as they are used frequently in the planner
     float _masterAxisMaxAccMMps2;
+    // Limits for motion along the path (each axis is also limited individually)
+    float _pathMaxSpeedMMps;
+    float _pathMaxAccMMps2;
     // Cache max step rate
     AxisFloats _maxStepRatesPerSec;
+    // Cache max step acceleration
+    AxisFloats _maxAccStepsPerSec2;
 
   public:
     AxesParams()
@@ -31,6 +36,8 @@ class AxesParams
     {
         _masterAxisIdx = -1;
         _masterAxisMaxAccMMps2 = AxisParams::acceleration_default;
+        _pathMaxSpeedMMps = AxisParams::maxSpeed_default;
+        _pathMaxAccMMps2 = AxisParams::acceleration_default;
         for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
             _axisParams[axisIdx].clear();
     }
@@ -125,6 +132,13 @@ class AxesParams
         return _maxStepRatesPerSec.getVal(axisIdx);
     }
 
+    float getMaxAccStepsPerSec2(int axisIdx)
+    {
+        if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
+            return AxisParams::acceleration_default * AxisParams::stepsPerRot_default / AxisParams::unitsPerRot_default;
+        return _maxAccStepsPerSec2.getVal(axisIdx);
+    }
+
     float getMaxAccel(int axisIdx)
     {
         if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
@@ -165,14 +179,33 @@ class AxesParams
         // Find the master axis (dominant one, or first primary - or just first)
         setMasterAxis(axisIdx);
 
-        // Cache axis max step rate
+        // Cache axis max step rate and acceleration
         for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
         {
             _maxStepRatesPerSec.setVal(axisIdx, getMaxStepRatePerSec(axisIdx, true));
+            _maxAccStepsPerSec2.setVal(axisIdx, _axisParams[axisIdx].maxAccStepsPerSec2());
         }
         return true;
     }
 
+    // Set an axis as rotary - called by the robot kinematics after the axes are configured
+    void setAxisRotary(int axisIdx)
+    {
+        if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
+            return;
+        _axisParams[axisIdx]._isRotary = true;
+        _maxAccStepsPerSec2.setVal(axisIdx, _axisParams[axisIdx].maxAccStepsPerSec2());
+        Log.notice("Axis%d is rotary, maxStepAcc %F\n", axisIdx, _maxAccStepsPerSec2.getVal(axisIdx));
+    }
+
+    // Path limits default to the master axis limits
+    void configurePathLimits(const char *robotConfigJSON)
+    {
+        _pathMaxSpeedMMps = float(RdJson::getDouble("pathMaxSpeed", getMaxSpeed(_masterAxisIdx), robotConfigJSON));
+        _pathMaxAccMMps2 = float(RdJson::getDouble("pathMaxAcc", _masterAxisMaxAccMMps2, robotConfigJSON));
+        Log.notice("Path params maxSpeed %F, acceleration %F\n", _pathMaxSpeedMMps, _pathMaxAccMMps2);
+    }
+
     // Set the master axis either to the dominant axis (if there is one)
     // or just the first one found
     void setMasterAxis(int fallbackAxisIdx)
@@ -17,6 +17,8 @@ class AxisParams
     static constexpr long homeOffSteps_default = 0;
     static constexpr float minSpeedMMps_default = 0.0f;
     static constexpr uint32_t stepsForAxisHoming_default = 100000;
+    // Min time for a rotary axis to reach maxRPM (this limits its acceleration unless maxStepAcc is set)
+    static constexpr float rotarySecsToMaxRPM_default = 0.5f;
 
     // Parameters
     float _maxSpeedMMps;
@@ -25,12 +27,16 @@ class AxisParams
     float _stepsPerRot;
     float _unitsPerRot;
     float _maxRPM;
+    // Max acceleration of the actuator in steps per second per second (0 = derive from maxAcc)
+    float _maxAccStepsPerSec2;
     bool _minValValid;
     float _minVal;
     bool _maxValValid;
     float _maxVal;
     bool _isPrimaryAxis;
     bool _isDominantAxis;
+    // Rotary axes are set by the robot kinematics (their units are rotations)
+    bool _isRotary;
     float _homeOffsetVal;
     long _homeOffSteps;
 
@@ -48,12 +54,14 @@ class AxisParams
         _stepsPerRot = stepsPerRot_default;
         _unitsPerRot = unitsPerRot_default;
         _maxRPM = maxRPM_default;
+        _maxAccStepsPerSec2 = 0;
         _minValValid = false;
         _minVal = 0;
         _maxValValid = false;
         _maxVal = 0;
         _isPrimaryAxis = true;
         _isDominantAxis = false;
+        _isRotary = false;
         _homeOffsetVal = homeOffsetVal_default;
         _homeOffSteps = homeOffSteps_default;
     }
@@ -65,6 +73,21 @@ class AxisParams
         return 1;
     }
 
+    float maxAccStepsPerSec2()
+    {
+        if (_maxAccStepsPerSec2 > 0)
+            return _maxAccStepsPerSec2;
+        float maxAcc = _maxAccelMMps2 * stepsPerUnit();
+        // A rotary axis's maxAcc is in rotations/s^2 which gives a limit far above what the motor can do
+        if (_isRotary)
+        {
+            float maxRPMAcc = _maxRPM * _stepsPerRot / 60 / rotarySecsToMaxRPM_default;
+            if (maxAcc > maxRPMAcc)
+                maxAcc = maxRPMAcc;
+        }
+        return maxAcc;
+    }
+
     bool ptInBounds(float &val, bool correctValueInPlace)
     {
         bool wasValid = true;
@@ -91,6 +114,7 @@ class AxisParams
         _stepsPerRot = float(RdJson::getDouble("stepsPerRot", AxisParams::stepsPerRot_default, axisJSON));
         _unitsPerRot = float(RdJson::getDouble("unitsPerRot", AxisParams::unitsPerRot_default, axisJSON));
         _maxRPM = float(RdJson::getDouble("maxRPM", AxisParams::maxRPM_default, axisJSON));
+        _maxAccStepsPerSec2 = float(RdJson::getDouble("maxStepAcc", 0, axisJSON));
         _minVal = float(RdJson::getDouble("minVal", 0, _minValValid, axisJSON));
         _maxVal = float(RdJson::getDouble("maxVal", 0, _maxValValid, axisJSON));
         _isDominantAxis = RdJson::getLong("isDominantAxis", 0, axisJSON) != 0;
@@ -101,8 +125,8 @@ class AxisParams
 
     void debugLog(int axisIdx)
     {
-        Log.notice("Axis%d params maxSpeed %F, acceleration %F, stepsPerRot %F, unitsPerRot %F, maxRPM %F\n",
-                   axisIdx, _maxSpeedMMps, _maxAccelMMps2, _stepsPerRot, _unitsPerRot, _maxRPM);
+        Log.notice("Axis%d params maxSpeed %F, acceleration %F, stepsPerRot %F, unitsPerRot %F, maxRPM %F, maxStepAcc %F\n",
+                   axisIdx, _maxSpeedMMps, _maxAccelMMps2, _stepsPerRot, _unitsPerRot, _maxRPM, maxAccStepsPerSec2());
         Log.notice("Axis%d params minVal %F (%d), maxVal %F (%d), isDominant %d, homeOffVal %F, homeOffSteps %d\n",
                    axisIdx, _minVal, _minValValid, _maxVal, _maxValValid, _isDominantAxis, _homeOffsetVal, _homeOffSteps);
     }
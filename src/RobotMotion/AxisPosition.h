@@ -9,11 +9,36 @@ class AxisPosition
 {
   public:
     AxisFloats _axisPositionMM;
+    // Absolute steps from home - these count the same steps as the ISR so they never drift from it
+    int64_t _absStepsFromHome[RobotConsts::MAX_AXES];
+    // Steps from home as seen by the kinematics - for continuous rotation robots this is reduced
+    // to (about) a single rotation by the robot's correctStepOverflow function
     AxisInt32s _stepsFromHome;
 
     void clear()
     {
         _axisPositionMM.set(0, 0, 0);
         _stepsFromHome.set(0, 0, 0);
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            _absStepsFromHome[axisIdx] = 0;
+    }
+
+    // Set the absolute steps - the kinematics view is set to the same value and should then
+    // be reduced using correctStepOverflow
+    void setAbsSteps(int axisIdx, int64_t absSteps)
+    {
+        if ((axisIdx < 0) || (axisIdx >= RobotConsts::MAX_AXES))
+            return;
+        _absStepsFromHome[axisIdx] = absSteps;
+        _stepsFromHome.setVal(axisIdx, int32_t(absSteps));
+    }
+
+    // Move by a number of steps (both absolute steps and the kinematics view)
+    void addSteps(int axisIdx, int32_t steps)
+    {
+        if ((axisIdx < 0) || (axisIdx >= RobotConsts::MAX_AXES))
+            return;
+        _absStepsFromHome[axisIdx] += steps;
+        _stepsFromHome.setVal(axisIdx, _stepsFromHome.getVal(axisIdx) + steps);
     }
 };
@@ -5,8 +5,6 @@
 #include "AxisValues.h"
 #include "../AxesParams.h"
 
-static const char* MODULE_PREFIX = "MotionBlock: ";
-
 MotionBlock::MotionBlock()
 {
     clear();
@@ -17,111 +15,206 @@ void MotionBlock::clear()
     // Clear values
     _feedrate = 0;
     _moveDistPrimaryAxesMM = 0;
+    _accMMps2 = 0;
     _maxEntrySpeedMMps = 0;
     _entrySpeedMMps = 0;
     _exitSpeedMMps = 0;
-    _debugStepDistMM = 0;
-    _isExecuting = false;
-    _canExecute = false;
     _blockIsFollowed = false;
-    _axisIdxWithMaxSteps = 0;
-    _unitVecAxisWithMaxDist = 0;
-    _accStepsPerTTicksPerMS = 0;
-    _finalStepRatePerTTicks = 0;
-    _initialStepRatePerTTicks = 0;
-    _maxStepRatePerTTicks = 0;
-    _stepsBeforeDecel = 0;
-    _numberedCommandIndex = 0;
-    _endStopsToCheck.none();
-    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
-        _stepsTotalMaybeNeg[axisIdx] = 0;
 }
 
-void MotionBlock::setNumberedCommandIndex(int cmdIdx)
-{
-    _numberedCommandIndex = cmdIdx;
-}
-int IRAM_ATTR MotionBlock::getNumberedCommandIndex()
-{
-    return _numberedCommandIndex;
-}
-int32_t MotionBlock::getStepsToTarget(int axisIdx)
+float MotionBlock::maxAchievableSpeed(float acceleration, float target_velocity, float distance)
 {
-    if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
-    {
-        return _stepsTotalMaybeNeg[axisIdx];
-    }
-    return 0;
+    return sqrtf(target_velocity * target_velocity + 2.0F * acceleration * distance);
 }
 
-int32_t MotionBlock::getAbsStepsToTarget(int axisIdx)
+void MotionBlock::forceInBounds(float &val, float lowBound, float highBound)
 {
-    if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
-    {
-        return abs(_stepsTotalMaybeNeg[axisIdx]);
-    }
-    return 0;
+    if (val < lowBound)
+        val = lowBound;
+    if (val > highBound)
+        val = highBound;
 }
 
-void MotionBlock::setStepsToTarget(int axisIdx, int32_t steps)
+// The block's entry and exit speed are now known
+// The block can accelerate and decelerate as required as long as these criteria are met
+// We now compute the stepping parameters to make motion happen
+bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise, MotionBlockExec &blockExec, bool jerkLimited)
 {
-    if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
-    {
-        _stepsTotalMaybeNeg[axisIdx] = steps;
-        if (abs(steps) > abs(_stepsTotalMaybeNeg[_axisIdxWithMaxSteps]))
-            _axisIdxWithMaxSteps = axisIdx;
-    }
+    // If block is currently being executed don't change it
+    if (blockExec._isExecuting)
+        return false;
+
+    // Find the max number of steps for any axis
+    int axisIdxWithMaxSteps = blockExec._axisIdxWithMaxSteps;
+    uint32_t absMaxStepsForAnyAxis = blockExec.getAbsStepsToTarget(axisIdxWithMaxSteps);
+
+    // Calculate the step rates
+    float accMMps2 = _accMMps2 > 0 ? _accMMps2 : axesParams.getMaxAccel(axisIdxWithMaxSteps);
+    calcStepRates(absMaxStepsForAnyAxis, isStepwise, accMMps2, axesParams.getMaxStepRatePerSec(axisIdxWithMaxSteps), blockExec);
+
+    // Jerk-limited profile - the acceleration and deceleration phases take the same time as the
+    // trapezoid (so distances are unchanged) with acceleration varying linearly from zero to a peak of
+    // twice the trapezoid's acceleration and back to zero - so acceleration is continuous at block joins
+    // The jerk is calculated when the block is compiled into step segments (see RampGenerator)
+    blockExec._jerkLimited = jerkLimited && !isStepwise;
+    return true;
 }
 
-uint32_t MotionBlock::getExitStepRatePerTTicks()
+#ifdef MOTION_STEP_RATES_FIXED_POINT
+
+// Convert a (non-negative) value to Q16.16 - values of 65536 and above are clamped
+uint32_t MotionBlock::floatToQ16(float val)
 {
-    return _finalStepRatePerTTicks;
+    if (!(val > 0))
+        return 0;
+    if (val >= 65536.0f)
+        return UINT32_MAX;
+    return uint32_t(val * Q16_ONE);
 }
 
-float MotionBlock::maxAchievableSpeed(float acceleration, float target_velocity, float distance)
+// Convert a speed in mm/s to a step rate (Q16.16) limited to maxStepRateQ16
+uint32_t MotionBlock::mmToStepsQ16(float valMM, uint64_t stepsPerMMQ16, uint32_t maxStepRateQ16)
 {
-    return sqrtf(target_velocity * target_velocity + 2.0F * acceleration * distance);
+    uint64_t stepRateQ16 = (floatToQ16(fabsf(valMM)) * stepsPerMMQ16) >> Q16_SHIFT;
+    return stepRateQ16 > maxStepRateQ16 ? maxStepRateQ16 : uint32_t(stepRateQ16);
 }
 
-void MotionBlock::forceInBounds(float &val, float lowBound, float highBound)
+// Integer square root (rounded down)
+uint32_t MotionBlock::isqrt64(uint64_t val)
 {
-    if (val < lowBound)
-        val = lowBound;
-    if (val > highBound)
-        val = highBound;
+    uint64_t result = 0;
+    uint64_t bit = 1ull << 62;
+    while (bit > val)
+        bit >>= 2;
+    while (bit != 0)
+    {
+        if (val >= result + bit)
+        {
+            val -= result + bit;
+            result = (result >> 1) + bit;
+        }
+        else
+        {
+            result >>= 1;
+        }
+        bit >>= 2;
+    }
+    return uint32_t(result);
 }
 
-void MotionBlock::setEndStopsToCheck(AxisMinMaxBools &endStopCheck)
+// Step rate (steps per second in Q16.16) rounded to the resolution stored in the execution record
+uint16_t MotionBlock::stepRateQ16ToStored(uint32_t stepRateQ16)
 {
-    Log.verbose("%sSet test endstops %x\n", MODULE_PREFIX, endStopCheck.uintVal());
-    _endStopsToCheck = endStopCheck;
+    uint32_t stepRate = (uint32_t)(((uint64_t)stepRateQ16 + Q16_ONE / 2) >> Q16_SHIFT);
+    return stepRate > UINT16_MAX ? UINT16_MAX : uint16_t(stepRate);
 }
 
-// The block's entry and exit speed are now known
-// The block can accelerate and decelerate as required as long as these criteria are met
-// We now compute the stepping parameters to make motion happen
-bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise)
+// Calculate the step rates and the steps before deceleration for the axis with max steps
+// This is done in Q16.16 fixed point (with 64 bit intermediates for squared rates) - it is only
+// built with MOTION_STEP_RATES_FIXED_POINT defined as on the host it is slower than the float version
+// (see test_motion_block) - step rates are in steps per second and squared rates and acceleration
+// in Q16.16 steps^2/s^2 and steps/s^2
+void MotionBlock::calcStepRates(uint32_t absMaxSteps, bool isStepwise, float accMMps2, float maxStepRatePerSec,
+                    MotionBlockExec &blockExec)
 {
-    // If block is currently being executed don't change it
-    if (_isExecuting)
-        return false;
+    uint32_t stepRateLimitQ16 = floatToQ16(maxStepRatePerSec);
+    if (stepRateLimitQ16 > ((uint32_t)UINT16_MAX << Q16_SHIFT))
+        stepRateLimitQ16 = (uint32_t)UINT16_MAX << Q16_SHIFT;
+    uint32_t initialStepRateQ16 = 0;
+    uint32_t finalStepRateQ16 = 0;
+    uint32_t axisMaxStepRateQ16 = 0;
+    uint64_t maxAccStepsQ16 = 0;
+    uint32_t stepsDecelerating = 0;
+    if (isStepwise)
+    {
+        // Feedrate is in steps per second in this case
+        uint32_t stepRateQ16 = std::min(floatToQ16(_feedrate), stepRateLimitQ16);
+        initialStepRateQ16 = stepRateQ16;
+        finalStepRateQ16 = stepRateQ16;
+        axisMaxStepRateQ16 = stepRateQ16;
+        maxAccStepsQ16 = stepRateQ16;
+    }
+    else
+    {
+        // Steps per mm of the axis with max steps - this is the only floating point calculation as the
+        // block distance can be far smaller than the resolution of Q16.16
+        uint64_t stepsPerMMQ16 = floatToQ16(absMaxSteps / _moveDistPrimaryAxesMM);
 
-    // Find the max number of steps for any axis
-    uint32_t absMaxStepsForAnyAxis = abs(_stepsTotalMaybeNeg[_axisIdxWithMaxSteps]);
+        // Initial, final and max step rates and acceleration
+        initialStepRateQ16 = mmToStepsQ16(_entrySpeedMMps, stepsPerMMQ16, stepRateLimitQ16);
+        finalStepRateQ16 = mmToStepsQ16(_exitSpeedMMps, stepsPerMMQ16, stepRateLimitQ16);
+        axisMaxStepRateQ16 = mmToStepsQ16(_feedrate, stepsPerMMQ16, stepRateLimitQ16);
+        maxAccStepsQ16 = std::max((floatToQ16(fabsf(accMMps2)) * stepsPerMMQ16) >> Q16_SHIFT, (uint64_t)1);
+        uint64_t initialRateSq = ((uint64_t)initialStepRateQ16 * initialStepRateQ16) >> Q16_SHIFT;
+        uint64_t finalRateSq = ((uint64_t)finalStepRateQ16 * finalStepRateQ16) >> Q16_SHIFT;
+        uint64_t axisMaxRateSq = ((uint64_t)axisMaxStepRateQ16 * axisMaxStepRateQ16) >> Q16_SHIFT;
 
+        // Calculate the distance accelerating (assuming max accleration followed by max deceleration):
+        //		Vmax * Vmax = Ventry * Ventry + 2 * Amax * Saccelerating
+        //		Vexit * Vexit = Vmax * Vmax - 2 * Amax * Sdecelerating
+        //      Stotal = Saccelerating + Sdecelerating
+        // And solving for Saccelerating (distance accelerating) rounding up
+        int64_t rateSqChange = (int64_t)finalRateSq - (int64_t)initialRateSq;
+        int64_t fourAcc = 4 * (int64_t)maxAccStepsQ16;
+        int64_t stepsAcceleratingSigned = rateSqChange > 0 ? (rateSqChange + fourAcc - 1) / fourAcc : -(-rateSqChange / fourAcc);
+        stepsAcceleratingSigned += absMaxSteps / 2;
+        uint32_t stepsAccelerating = 0;
+        if (stepsAcceleratingSigned > 0)
+            stepsAccelerating = stepsAcceleratingSigned > absMaxSteps ? absMaxSteps : uint32_t(stepsAcceleratingSigned);
+
+        // See if max speed will be reached
+        uint64_t twoAcc = 2 * maxAccStepsQ16;
+        uint64_t stepsToMaxSpeed = axisMaxRateSq > initialRateSq ? (axisMaxRateSq - initialRateSq) / twoAcc : 0;
+        if (stepsAccelerating > stepsToMaxSpeed)
+        {
+            // Max speed will be reached
+            stepsAccelerating = uint32_t(stepsToMaxSpeed);
+
+            // Decelerating steps
+            uint64_t stepsDecelQ = axisMaxRateSq > finalRateSq ? (axisMaxRateSq - finalRateSq) / twoAcc : 0;
+            stepsDecelerating = stepsDecelQ > absMaxSteps ? absMaxSteps : uint32_t(stepsDecelQ);
+        }
+        else
+        {
+            // Calculate max speed that will be reached - stepsAccelerating is no more than stepsToMaxSpeed
+            // so the squared rate is within the max rate squared
+            uint64_t peakRateSq = initialRateSq + twoAcc * stepsAccelerating;
+            axisMaxStepRateQ16 = isqrt64(peakRateSq << Q16_SHIFT);
+
+            // Decelerating steps
+            stepsDecelerating = absMaxSteps - stepsAccelerating;
+        }
+    }
+
+    // Fill in the step values for this axis
+    blockExec._initialStepRatePerSec = stepRateQ16ToStored(initialStepRateQ16);
+    blockExec._maxStepRatePerSec = stepRateQ16ToStored(axisMaxStepRateQ16);
+    blockExec._finalStepRatePerSec = stepRateQ16ToStored(finalStepRateQ16);
+    uint64_t accStepsPerTTicksPerMS = (maxAccStepsQ16 * (MotionBlockExec::TTICKS_PER_STEP_PER_SEC / 1000)) >> Q16_SHIFT;
+    blockExec._accStepsPerTTicksPerMS = accStepsPerTTicksPerMS > UINT32_MAX ? UINT32_MAX : uint32_t(accStepsPerTTicksPerMS);
+    blockExec._stepsBeforeDecel = absMaxSteps - stepsDecelerating;
+}
+
+#else
+
+// Calculate the step rates and the steps before deceleration for the axis with max steps
+// This is single precision as the ESP32 FPU has no double support and divisions are replaced with
+// multiplication by a reciprocal where possible
+void MotionBlock::calcStepRates(uint32_t absMaxSteps, bool isStepwise, float accMMps2, float maxStepRatePerSec,
+                    MotionBlockExec &blockExec)
+{
     // Check if stepwise movement
     float initialStepRatePerSec = 0;
     float finalStepRatePerSec = 0;
     float maxAccStepsPerSec2 = 0;
     float axisMaxStepRatePerSec = 0;
     uint32_t stepsDecelerating = 0; 
-    double stepDistMM = 0;
     if (isStepwise)
     {
         // Feedrate is in steps per second in this case
         float stepRatePerSec = _feedrate;
-        if (stepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
-            stepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
+        if (stepRatePerSec > maxStepRatePerSec)
+            stepRatePerSec = maxStepRatePerSec;
         initialStepRatePerSec = stepRatePerSec;
         finalStepRatePerSec = stepRatePerSec;
         maxAccStepsPerSec2 = stepRatePerSec;
@@ -131,99 +224,89 @@ bool MotionBlock::prepareForStepping(AxesParams &axesParams, bool isStepwise)
     else
     {
         // Get the initial step rate, final step rate and max acceleration for the axis with max steps
-        stepDistMM = fabsf(_moveDistPrimaryAxesMM / _stepsTotalMaybeNeg[_axisIdxWithMaxSteps]);
-        initialStepRatePerSec = fabsf(_entrySpeedMMps / stepDistMM);
-        if (initialStepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
-            initialStepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
-        finalStepRatePerSec = fabsf(_exitSpeedMMps / stepDistMM);
-        if (finalStepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
-            finalStepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
-        maxAccStepsPerSec2 = fabsf(axesParams.getMaxAccel(_axisIdxWithMaxSteps) / stepDistMM);
+        float stepsPerMM = absMaxSteps / _moveDistPrimaryAxesMM;
+        initialStepRatePerSec = fabsf(_entrySpeedMMps * stepsPerMM);
+        if (initialStepRatePerSec > maxStepRatePerSec)
+            initialStepRatePerSec = maxStepRatePerSec;
+        finalStepRatePerSec = fabsf(_exitSpeedMMps * stepsPerMM);
+        if (finalStepRatePerSec > maxStepRatePerSec)
+            finalStepRatePerSec = maxStepRatePerSec;
+        maxAccStepsPerSec2 = fabsf(accMMps2 * stepsPerMM);
+        float halfInvAcc = 0.5F / maxAccStepsPerSec2;
+        float initialRateSq = initialStepRatePerSec * initialStepRatePerSec;
+        float finalRateSq = finalStepRatePerSec * finalStepRatePerSec;
 
         // Calculate the distance decelerating and ensure within bounds
-        // Using the facts for the block ... (assuming max accleration followed by max deceleration):
-        //		Vmax * Vmax = Ventry * Ventry + 2 * Amax * Saccelerating
-        //		Vexit * Vexit = Vmax * Vmax - 2 * Amax * Sdecelerating
-        //      Stotal = Saccelerating + Sdecelerating
-        // And solving for Saccelerating (distance accelerating)
         uint32_t stepsAccelerating = 0;
         float stepsAcceleratingFloat =
-            ceilf((powf(finalStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) / 4 /
-                        maxAccStepsPerSec2 +
-                    absMaxStepsForAnyAxis / 2);
+            ceilf((finalRateSq - initialRateSq) * 0.5F * halfInvAcc + absMaxSteps / 2);
         if (stepsAcceleratingFloat > 0)
         {
             stepsAccelerating = uint32_t(stepsAcceleratingFloat);
-            if (stepsAccelerating > absMaxStepsForAnyAxis)
-                stepsAccelerating = absMaxStepsForAnyAxis;
+            if (stepsAccelerating > absMaxSteps)
+                stepsAccelerating = absMaxSteps;
         }
 
-        // Decelerating steps
-        stepsDecelerating = 0;
-
         // Find max possible rate for axis with max steps
-        axisMaxStepRatePerSec = fabsf(_feedrate / stepDistMM);
-        if (axisMaxStepRatePerSec > axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps))
-            axisMaxStepRatePerSec = axesParams.getMaxStepRatePerSec(_axisIdxWithMaxSteps);
+        axisMaxStepRatePerSec = fabsf(_feedrate * stepsPerMM);
+        if (axisMaxStepRatePerSec > maxStepRatePerSec)
+            axisMaxStepRatePerSec = maxStepRatePerSec;
+        float axisMaxRateSq = axisMaxStepRatePerSec * axisMaxStepRatePerSec;
 
         // See if max speed will be reached
-        uint32_t stepsToMaxSpeed =
-            uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(initialStepRatePerSec, 2)) /
-                        2 / maxAccStepsPerSec2);
+        float stepsToMaxSpeedFloat = (axisMaxRateSq - initialRateSq) * halfInvAcc;
+        uint32_t stepsToMaxSpeed = stepsToMaxSpeedFloat > 0 ? uint32_t(stepsToMaxSpeedFloat) : 0;
         if (stepsAccelerating > stepsToMaxSpeed)
         {
             // Max speed will be reached
             stepsAccelerating = stepsToMaxSpeed;
 
             // Decelerating steps
-            stepsDecelerating =
-                uint32_t((powf(axisMaxStepRatePerSec, 2) - powf(finalStepRatePerSec, 2)) /
-                            2 / maxAccStepsPerSec2);
+            float stepsDeceleratingFloat = (axisMaxRateSq - finalRateSq) * halfInvAcc;
+            stepsDecelerating = stepsDeceleratingFloat > 0 ? uint32_t(stepsDeceleratingFloat) : 0;
         }
         else
         {
             // Calculate max speed that will be reached
-            axisMaxStepRatePerSec =
-                sqrtf(powf(initialStepRatePerSec, 2) + 2.0F * maxAccStepsPerSec2 * stepsAccelerating);
+            axisMaxStepRatePerSec = sqrtf(initialRateSq + 2.0F * maxAccStepsPerSec2 * stepsAccelerating);
 
             // Decelerating steps
-            stepsDecelerating = absMaxStepsForAnyAxis - stepsAccelerating;
+            stepsDecelerating = absMaxSteps - stepsAccelerating;
         }
     }
 
     // Fill in the step values for this axis
-    _initialStepRatePerTTicks = uint32_t((initialStepRatePerSec * TTICKS_VALUE) / TICKS_PER_SEC);
-    _maxStepRatePerTTicks = uint32_t((axisMaxStepRatePerSec * TTICKS_VALUE) / TICKS_PER_SEC);
-    _finalStepRatePerTTicks = uint32_t((finalStepRatePerSec * TTICKS_VALUE) / TICKS_PER_SEC);
-    _accStepsPerTTicksPerMS = uint32_t((maxAccStepsPerSec2 * TTICKS_VALUE) / TICKS_PER_SEC / 1000);
-    _stepsBeforeDecel = absMaxStepsForAnyAxis - stepsDecelerating;
-    _debugStepDistMM = stepDistMM;
-
-    return true;
+    blockExec._initialStepRatePerSec = MotionBlockExec::stepRateToStored(initialStepRatePerSec);
+    blockExec._maxStepRatePerSec = MotionBlockExec::stepRateToStored(axisMaxStepRatePerSec);
+    blockExec._finalStepRatePerSec = MotionBlockExec::stepRateToStored(finalStepRatePerSec);
+    blockExec._accStepsPerTTicksPerMS = uint32_t(maxAccStepsPerSec2 * TTICKS_PER_STEP_PER_SEC_PER_MS);
+    blockExec._stepsBeforeDecel = absMaxSteps - stepsDecelerating;
 }
 
+#endif
+
 void MotionBlock::debugShowBlkHead()
 {
-    Log.notice("#i EntMMps ExtMMps StTot0 StTot1 StTot2 St>Dec    Init     (perTT)      Pk     (perTT)     Fin     (perTT)     Acc     (perTT) UnitVecMax   FeedRtMMps StepDistMM  MaxStepRate\n");
+    Log.notice("#i EntMMps ExtMMps StTot0 StTot1 StTot2 St>Dec    Init     (perTT)      Pk     (perTT)     Fin     (perTT)     Acc     (perTT) FeedRtMMps StepDistMM  MaxStepRate\n");
 }
 
-void MotionBlock::debugShowBlock(int elemIdx, AxesParams &axesParams)
+void MotionBlock::debugShowBlock(int elemIdx, AxesParams &axesParams, MotionBlockExec &blockExec)
 {
     char tmpBuf[200];
-    sprintf(tmpBuf, "%2d%8.3f%8.3f%7d%7d%7d%7u%8.3f(%10d)%8.3f(%10d)%8.3f(%10d)%8.3f(%10u)%13.8f%11.6f%11.8f%11.3f", elemIdx,
+    float stepDistMM = debugStepDistMM(blockExec);
+    sprintf(tmpBuf, "%2d%8.3f%8.3f%7d%7d%7d%7u%8.3f(%10d)%8.3f(%10d)%8.3f(%10d)%8.3f(%10u)%11.6f%11.8f%11.3f", elemIdx,
                 _entrySpeedMMps,
                 _exitSpeedMMps,
-                getStepsToTarget(0),
-                getStepsToTarget(1),
-                getStepsToTarget(2),
-                _stepsBeforeDecel,
-                debugStepRateToMMps(_initialStepRatePerTTicks), _initialStepRatePerTTicks,
-                debugStepRateToMMps(_maxStepRatePerTTicks), _maxStepRatePerTTicks,
-                debugStepRateToMMps(_finalStepRatePerTTicks), _finalStepRatePerTTicks,
-                debugStepRateToMMps2(_accStepsPerTTicksPerMS),_accStepsPerTTicksPerMS,
-                _unitVecAxisWithMaxDist,
+                blockExec.getStepsToTarget(0),
+                blockExec.getStepsToTarget(1),
+                blockExec.getStepsToTarget(2),
+                blockExec._stepsBeforeDecel,
+                debugStepRateToMMps(blockExec.getInitialStepRatePerTTicks(), stepDistMM), blockExec.getInitialStepRatePerTTicks(),
+                debugStepRateToMMps(blockExec.getMaxStepRatePerTTicks(), stepDistMM), blockExec.getMaxStepRatePerTTicks(),
+                debugStepRateToMMps(blockExec.getExitStepRatePerTTicks(), stepDistMM), blockExec.getExitStepRatePerTTicks(),
+                debugStepRateToMMps2(blockExec._accStepsPerTTicksPerMS, stepDistMM), blockExec._accStepsPerTTicksPerMS,
                 _feedrate,
-                _debugStepDistMM,
+                stepDistMM,
                 axesParams.getMaxStepRatePerSec(0));
     Log.notice("%s\n", tmpBuf);
 }
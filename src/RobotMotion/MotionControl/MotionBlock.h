@@ -6,12 +6,14 @@
 #include "math.h"
 #include "AxisValues.h"
 #include "../AxesParams.h"
+#include "MotionBlockExec.h"
 
+// Planner data for a motion block - the data used by the ISR is in the block's execution record
 class MotionBlock
 {
 public:
     // Minimum move distance
-    static constexpr double MINIMUM_MOVE_DIST_MM = 0.0001;
+    static constexpr float MINIMUM_MOVE_DIST_MM = 0.0001f;
 
     // Number of ticks to accumulate for rate actuation
     static constexpr uint32_t TTICKS_VALUE = 1000000000l;
@@ -25,76 +27,72 @@ public:
     // Number of ns in ms
     static constexpr uint32_t NS_IN_A_MS = 1000000;
 
+    // Conversion from steps per second (and steps per second per second) to the values used by the ISR
+    static constexpr float TTICKS_PER_STEP_PER_SEC = TTICKS_VALUE / TICKS_PER_SEC;
+    static constexpr float TTICKS_PER_STEP_PER_SEC_PER_MS = TTICKS_VALUE / TICKS_PER_SEC / 1000;
+    static_assert(MotionBlockExec::TTICKS_PER_STEP_PER_SEC == uint32_t(TTICKS_PER_STEP_PER_SEC),
+                "Execution record step rate scaling must match the tick rate");
+
+    // Q16.16 fixed point
+    static constexpr int Q16_SHIFT = 16;
+    static constexpr uint32_t Q16_ONE = 1ul << Q16_SHIFT;
+
 public:
     // Max speed for move - either MMps or stepsPerSec depending if move is stepwise
     float _feedrate;
     // Distance (pythagorean) to move considering primary axes only
     float _moveDistPrimaryAxesMM;
-    // Unit vector on axis with max movement
-    float _unitVecAxisWithMaxDist;
+    // Max acceleration along the path - limited so that no actuator exceeds its own acceleration
+    float _accMMps2;
     // Computed max entry speed for a block based on max junction deviation calculation
     float _maxEntrySpeedMMps;
     // Computed entry speed for this block
     float _entrySpeedMMps;
     // Computed exit speed for this block
     float _exitSpeedMMps;
-    // Step distance in MM
-    double _debugStepDistMM;
-    // End-stops to test
-    AxisMinMaxBools _endStopsToCheck;
-    // Numbered command index - to help keep track of block execution from other processes
-    // like homing
-    int _numberedCommandIndex;
-
-    // Flags
-    struct
-    {
-        // Flag indicating the block is currently executing
-        volatile bool _isExecuting : 1;
-        // Flag indicating the block can start executing
-        volatile bool _canExecute : 1;
-        // Block is followed by others
-        bool _blockIsFollowed : 1;
-    };
-
-    // Steps to target and before deceleration
-    int32_t _stepsTotalMaybeNeg[RobotConsts::MAX_AXES];
-    int _axisIdxWithMaxSteps;
-    uint32_t _stepsBeforeDecel;
-
-    // Stepping acceleration/deceleration profile
-    uint32_t _initialStepRatePerTTicks;
-    uint32_t _maxStepRatePerTTicks;
-    uint32_t _finalStepRatePerTTicks;
-    uint32_t _accStepsPerTTicksPerMS;
+    // Block is followed by others
+    bool _blockIsFollowed;
 
 public:
     MotionBlock();
     void clear();
-    void setNumberedCommandIndex(int cmdIdx);
-    int IRAM_ATTR getNumberedCommandIndex();
-    int32_t getStepsToTarget(int axisIdx);
-    int32_t getAbsStepsToTarget(int axisIdx);
-    void setStepsToTarget(int axisIdx, int32_t steps);
-    uint32_t getExitStepRatePerTTicks();
     static float maxAchievableSpeed(float acceleration, float target_velocity, float distance);
     void forceInBounds(float &val, float lowBound, float highBound);
-    void setEndStopsToCheck(AxisMinMaxBools &endStopCheck);
 
     // The block's entry and exit speed are now known
     // The block can accelerate and decelerate as required as long as these criteria are met
     // We now compute the stepping parameters to make motion happen
-    bool prepareForStepping(AxesParams &axesParams, bool isStepwise);
+    // The stepping parameters are written to the block's execution record
+    // If jerkLimited is set then an S-curve profile is used with the same duration as the trapezoid
+    bool prepareForStepping(AxesParams &axesParams, bool isStepwise, MotionBlockExec &blockExec, bool jerkLimited = false);
+
+    // Step rates and steps before deceleration for the axis with max steps - this is single precision
+    // float unless MOTION_STEP_RATES_FIXED_POINT is defined when it is Q16.16 fixed point
+    void calcStepRates(uint32_t absMaxSteps, bool isStepwise, float accMMps2, float maxStepRatePerSec,
+                MotionBlockExec &blockExec);
 
     // Debug
     void debugShowBlkHead();
-    void debugShowBlock(int elemIdx, AxesParams &axesParams);
-    float debugStepRateToMMps(float val)
+    void debugShowBlock(int elemIdx, AxesParams &axesParams, MotionBlockExec &blockExec);
+    float debugStepDistMM(MotionBlockExec &blockExec)
     {
-        return (((val * 1.0) * MotionBlock::TICKS_PER_SEC) / MotionBlock::TTICKS_VALUE) * _debugStepDistMM;
+        int32_t maxSteps = blockExec.getAbsStepsToTarget(blockExec._axisIdxWithMaxSteps);
+        return maxSteps == 0 ? 0 : _moveDistPrimaryAxesMM / maxSteps;
     }
-    float debugStepRateToMMps2(float val)
+    float debugStepRateToMMps(float val, float stepDistMM)
     {
-        return (((val * 1.0) * 1000 * MotionBlock::TICKS_PER_SEC) / MotionBlock::TTICKS_VALUE) * _debugStepDistMM;
+        return (((val * 1.0f) * MotionBlock::TICKS_PER_SEC) / MotionBlock::TTICKS_VALUE) * stepDistMM;
     }
+    float debugStepRateToMMps2(float val, float stepDistMM)
+    {
+        return (((val * 1.0f) * 1000 * MotionBlock::TICKS_PER_SEC) / MotionBlock::TTICKS_VALUE) * stepDistMM;
+    }
+
+#ifdef MOTION_STEP_RATES_FIXED_POINT
+private:
+    static uint32_t floatToQ16(float val);
+    static uint32_t mmToStepsQ16(float valMM, uint64_t stepsPerMMQ16, uint32_t maxStepRateQ16);
+    static uint32_t isqrt64(uint64_t val);
+    static uint16_t stepRateQ16ToStored(uint32_t stepRateQ16);
+#endif
 };
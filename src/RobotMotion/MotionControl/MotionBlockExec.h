@@ -0,0 +1,142 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <stdlib.h>
+#include "AxisValues.h"
+#include "RobotConsts.h"
+
+// Execution record for a motion block
+// This is the part of a block which is used by the ISR (RampGenerator) to generate steps. It is
+// stored separately from the planner's data (MotionBlock) so that it is small and the pipeline
+// can be deep without using too much RAM
+class MotionBlockExec
+{
+public:
+    // Step rates are stored in steps per second to keep the record small - the segment compiler
+    // works in TTicks per step (see MotionBlock::TTICKS_PER_STEP_PER_SEC)
+    static constexpr uint32_t TTICKS_PER_STEP_PER_SEC = 20000;
+
+    // Steps to target (sign is direction)
+    int32_t _stepsTotalMaybeNeg[RobotConsts::MAX_AXES];
+    // Steps (on the axis with max steps) before deceleration starts
+    uint32_t _stepsBeforeDecel;
+
+    // Stepping acceleration/deceleration profile (the jerk-limited profile is derived from this
+    // when the block is compiled into step segments)
+    uint32_t _accStepsPerTTicksPerMS;
+
+    // Numbered command index - to help keep track of block execution from other processes
+    // like homing
+    int _numberedCommandIndex;
+    // End-stops to test
+    AxisMinMaxBools _endStopsToCheck;
+
+    // Step rates (steps per second) of the axis with max steps
+    uint16_t _initialStepRatePerSec;
+    uint16_t _maxStepRatePerSec;
+    uint16_t _finalStepRatePerSec;
+
+    // Axis with max steps
+    uint8_t _axisIdxWithMaxSteps;
+
+    // Flags
+    struct
+    {
+        // Flag indicating the block is currently executing
+        volatile bool _isExecuting : 1;
+        // Flag indicating the block can start executing
+        volatile bool _canExecute : 1;
+        // Use the jerk-limited (S-curve) profile - acceleration ramps up linearly for half of each
+        // acceleration/deceleration phase and then back down so it is zero at the start and end of the block
+        bool _jerkLimited : 1;
+    };
+
+public:
+    MotionBlockExec()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            _stepsTotalMaybeNeg[axisIdx] = 0;
+        _stepsBeforeDecel = 0;
+        _accStepsPerTTicksPerMS = 0;
+        _numberedCommandIndex = 0;
+        _initialStepRatePerSec = 0;
+        _maxStepRatePerSec = 0;
+        _finalStepRatePerSec = 0;
+        _endStopsToCheck.none();
+        _axisIdxWithMaxSteps = 0;
+        _isExecuting = false;
+        _canExecute = false;
+        _jerkLimited = false;
+    }
+
+    void setNumberedCommandIndex(int cmdIdx)
+    {
+        _numberedCommandIndex = cmdIdx;
+    }
+
+    int IRAM_ATTR getNumberedCommandIndex()
+    {
+        return _numberedCommandIndex;
+    }
+
+    int32_t getStepsToTarget(int axisIdx)
+    {
+        if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
+            return _stepsTotalMaybeNeg[axisIdx];
+        return 0;
+    }
+
+    int32_t getAbsStepsToTarget(int axisIdx)
+    {
+        if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
+            return abs(_stepsTotalMaybeNeg[axisIdx]);
+        return 0;
+    }
+
+    void setStepsToTarget(int axisIdx, int32_t steps)
+    {
+        if (axisIdx >= 0 && axisIdx < RobotConsts::MAX_AXES)
+        {
+            _stepsTotalMaybeNeg[axisIdx] = steps;
+            if (abs(steps) > abs(_stepsTotalMaybeNeg[_axisIdxWithMaxSteps]))
+                _axisIdxWithMaxSteps = axisIdx;
+        }
+    }
+
+    // Step rate in steps per second rounded to the stored resolution
+    static uint16_t stepRateToStored(float stepsPerSec)
+    {
+        if (stepsPerSec <= 0)
+            return 0;
+        if (stepsPerSec >= UINT16_MAX)
+            return UINT16_MAX;
+        return uint16_t(stepsPerSec + 0.5f);
+    }
+
+    uint32_t getInitialStepRatePerTTicks()
+    {
+        return _initialStepRatePerSec * TTICKS_PER_STEP_PER_SEC;
+    }
+
+    uint32_t getMaxStepRatePerTTicks()
+    {
+        return _maxStepRatePerSec * TTICKS_PER_STEP_PER_SEC;
+    }
+
+    uint32_t getExitStepRatePerTTicks()
+    {
+        return _finalStepRatePerSec * TTICKS_PER_STEP_PER_SEC;
+    }
+
+    void setEndStopsToCheck(AxisMinMaxBools &endStopCheck)
+    {
+        _endStopsToCheck = endStopCheck;
+    }
+};
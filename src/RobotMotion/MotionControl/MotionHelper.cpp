@@ -21,6 +21,8 @@ MotionHelper::MotionHelper() :
     _isPaused = false;
     _moveRelative = false;
     _blockDistanceMM = 0;
+    _arcChordToleranceMM = arcChordToleranceMM_default;
+    _pathToleranceMM = pathToleranceMM_default;
     _allowAllOutOfBounds = false;
     // Clear axis current location
     _lastCommandedAxisPos.clear();
@@ -31,12 +33,22 @@ MotionHelper::MotionHelper() :
     _correctStepOverflowFn = NULL;
     // Handling of splitting-up of motion into smaller blocks
     _blocksToAddTotal = 0;    
+    _blocksToAddIsPolar = false;
+    _blocksToAddIsArc = false;
+    _blocksToAddIsAdaptive = false;
+    _blocksToAddAdaptivePos = 0;
+    _blocksToAddAdaptiveStep = 1;
+    _blocksToAddAdaptiveMaxStep = 1;
+    _blocksToAddAdaptiveMinStep = 1;
     // Init callbacks
     _ptToActuatorFn = nullptr;
     _actuatorToPtFn = nullptr;
     _correctStepOverflowFn = nullptr;
     _convertCoordsFn = nullptr;
     _setRobotAttributes = nullptr;
+    _polarToActuatorFn = nullptr;
+    _actuatorToPolarFn = nullptr;
+    _ptsToActuatorFn = nullptr;
 }
 
 // Destructor
@@ -47,10 +59,16 @@ MotionHelper::~MotionHelper()
 // Each robot has a set of functions that transform points from real-world coordinates
 // to actuator coordinates
 // There is also a function to correct step overflow which is important in robots
-// which have continuous rotation as step counts would otherwise overflow 32bit integer values
+// which have continuous rotation - it calculates the (32 bit) steps used by the kinematics from
+// the 64 bit absolute steps (which match the ISR step counts)
+// Robots with polar kinematics can also supply functions to convert directly between
+// polar coords and actuator coords so that polar moves avoid a round trip through cartesian
+// A batch version of ptToActuator can also be supplied for converting several points at once
 void MotionHelper::setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPtFnType actuatorToPtFn,
                                  correctStepOverflowFnType correctStepOverflowFn,
-                                 convertCoordsFnType convertCoordsFn, setRobotAttributesFnType setRobotAttributes)
+                                 convertCoordsFnType convertCoordsFn, setRobotAttributesFnType setRobotAttributes,
+                                 polarToActuatorFnType polarToActuatorFn, actuatorToPolarFnType actuatorToPolarFn,
+                                 ptsToActuatorFnType ptsToActuatorFn)
 {
     // Store callbacks
     _ptToActuatorFn = ptToActuatorFn;
@@ -58,6 +76,9 @@ void MotionHelper::setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPt
     _correctStepOverflowFn = correctStepOverflowFn;
     _convertCoordsFn = convertCoordsFn;
     _setRobotAttributes = setRobotAttributes;
+    _polarToActuatorFn = polarToActuatorFn;
+    _actuatorToPolarFn = actuatorToPolarFn;
+    _ptsToActuatorFn = ptsToActuatorFn;
 }
 
 // Configure the robot and pipeline parameters using a JSON input string
@@ -74,21 +95,25 @@ void MotionHelper::configure(const char *robotConfigJSON)
     int pipelineLen = int(RdJson::getLong("pipelineLen", pipelineLen_default, robotGeom.c_str()));
     _blockDistanceMM = float(RdJson::getDouble("blockDistanceMM", blockDistanceMM_default, robotGeom.c_str()));
     _allowAllOutOfBounds = bool(RdJson::getLong("allowOutOfBounds", false, robotGeom.c_str()));
+    _arcChordToleranceMM = float(RdJson::getDouble("arcChordTolMM", arcChordToleranceMM_default, robotGeom.c_str()));
+    _pathToleranceMM = float(RdJson::getDouble("pathTolMM", pathToleranceMM_default, robotGeom.c_str()));
     float junctionDeviation = float(RdJson::getDouble("junctionDeviation", junctionDeviation_default, robotGeom.c_str()));
-    Log.notice("%sconfigMotionPipeline len %d, blockDistMM %F (0=no-max), allowOoB %s, jnDev %F\n", MODULE_PREFIX,
-               pipelineLen, _blockDistanceMM, _allowAllOutOfBounds ? "Y" : "N", junctionDeviation);
-
-    // Pipeline length and block size
-    _motionPipeline.init(pipelineLen);
-
-    // Motion Pipeline and Planner
-    _motionPlanner.configure(junctionDeviation);
+    bool jerkLimited = RdJson::getLong("jerkLimited", 0, robotGeom.c_str()) != 0;
+    Log.notice("%sconfigMotionPipeline len %d, blockDistMM %F (0=no-max), allowOoB %s, jnDev %F, jerkLimited %s, arcTolMM %F, pathTolMM %F (0=fixed blocks)\n", MODULE_PREFIX,
+               pipelineLen, _blockDistanceMM, _allowAllOutOfBounds ? "Y" : "N", junctionDeviation, jerkLimited ? "Y" : "N",
+               _arcChordToleranceMM, _pathToleranceMM);
 
     // Clean up previous
     _trinamicsController.deinit();
     _rampGenerator.deinit();
     _motorEnabler.deinit();
 
+    // Pipeline length and block size
+    _motionPipeline.init(pipelineLen);
+
+    // Motion Pipeline and Planner
+    _motionPlanner.configure(junctionDeviation, jerkLimited);
+
     // Configure Axes
     _axesParams.clearAxes();
     String axisJSON;
@@ -101,6 +126,9 @@ void MotionHelper::configure(const char *robotConfigJSON)
         }
     }
 
+    // Path limits
+    _axesParams.configurePathLimits(robotGeom.c_str());
+
     // Set the robot attributes
     if (_setRobotAttributes)
         _setRobotAttributes(_axesParams, _robotAttributes);
@@ -115,7 +143,10 @@ void MotionHelper::configure(const char *robotConfigJSON)
     _motorEnabler.configure(robotGeom.c_str());
 
     // Start motion actuator
-    _rampGenerator.configure(true);
+    bool variableStepTimer = RdJson::getLong("variableStepTimer", 0, robotGeom.c_str()) != 0;
+    bool stepSmoothing = RdJson::getLong("stepSmoothing", 1, robotGeom.c_str()) != 0;
+    bool isrStats = RdJson::getLong("isrStats", 1, robotGeom.c_str()) != 0;
+    _rampGenerator.configure(true, variableStepTimer, stepSmoothing, isrStats);
 
     // Clear motion info
     _lastCommandedAxisPos.clear();
@@ -129,7 +160,7 @@ bool MotionHelper::canAccept()
     if (_motionHoming.isHomingInProgress())
         return false;
     // Check that the motion pipeline can accept new data
-    return (_blocksToAddTotal == 0) && _motionPipeline.canAccept();
+    return !blocksToAddPending() && _motionPipeline.canAccept();
 }
 
 // Pause (or un-pause) all motion
@@ -149,7 +180,7 @@ bool MotionHelper::isPaused()
 // Stop
 void MotionHelper::stop()
 {
-    _blocksToAddTotal = 0;
+    blocksToAddClear();
     _stopRequested = true;
     _stopRequestTimeMs = millis();
     _rampGenerator.stop();
@@ -165,18 +196,32 @@ bool MotionHelper::isIdle()
     return !_motionPipeline.canGet();
 }
 
+// Check if homing (the pipeline empties between homing moves)
+bool MotionHelper::isHoming()
+{
+    return _motionHoming.isHomingInProgress();
+}
+
 void MotionHelper::setCurPosActualPosition()
 {
     // Get final position of actuator after a short delay to attempt to
     // ensure any final step is completed
     delayMicroseconds(100);
-    AxisInt32s actuatorPos;
-    _rampGenerator.getTotalStepPosition(actuatorPos);
+    AxisPosition actuatorPos;
+    getCurStepsFromHome(actuatorPos);
     AxisFloats curPosMM;
     if (_actuatorToPtFn)
-        _actuatorToPtFn(actuatorPos, curPosMM, _lastCommandedAxisPos, _axesParams);
+        _actuatorToPtFn(actuatorPos._stepsFromHome, curPosMM, _lastCommandedAxisPos, _axesParams);
+    _lastCommandedAxisPos = actuatorPos;
     _lastCommandedAxisPos._axisPositionMM = curPosMM;
-    _lastCommandedAxisPos._stepsFromHome = actuatorPos;
+}
+
+// Get the actuator position from the ISR (absolute steps) and the kinematics view of it
+void MotionHelper::getCurStepsFromHome(AxisPosition &actuatorPos)
+{
+    _rampGenerator.getTotalStepPosition(actuatorPos);
+    if (_correctStepOverflowFn)
+        _correctStepOverflowFn(actuatorPos, _axesParams);
 }
 
 // Set parameters such as relative vs absolute motion
@@ -190,14 +235,24 @@ void MotionHelper::setMotionParams(RobotCommandArgs &args)
 // Get current status of robot
 void MotionHelper::getCurStatus(RobotCommandArgs &args)
 {
-    // Get current position
-    AxisInt32s curActuatorPos;
-    _rampGenerator.getTotalStepPosition(curActuatorPos);
-    args.setPointSteps(curActuatorPos);
+    // Get current position and step rates (consistent with each other)
+    MotionSnapshot snapshot;
+    _rampGenerator.getMotionSnapshot(snapshot);
+    AxisPosition curActuatorPos;
+    AxisFloats stepRates;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        curActuatorPos.setAbsSteps(axisIdx, snapshot._stepPos[axisIdx]);
+        stepRates.setVal(axisIdx, snapshot.getStepRatePerSec(axisIdx));
+    }
+    if (_correctStepOverflowFn)
+        _correctStepOverflowFn(curActuatorPos, _axesParams);
+    args.setPointSteps(curActuatorPos._stepsFromHome);
+    args.setStepRates(stepRates);
     // Use reverse kinematics to get location
     AxisFloats curMMPos;
     if (_actuatorToPtFn)
-        _actuatorToPtFn(curActuatorPos, curMMPos, _lastCommandedAxisPos, _axesParams);
+        _actuatorToPtFn(curActuatorPos._stepsFromHome, curMMPos, _lastCommandedAxisPos, _axesParams);
     args.setPointMM(curMMPos);
     // Get end-stop values
     AxisMinMaxBools endstops;
@@ -213,6 +268,25 @@ void MotionHelper::getCurStatus(RobotCommandArgs &args)
     args.setNumQueued(_motionPipeline.count());
 }
 
+// Get current actuator position - this is a consistent snapshot of the position from the ISR
+// (the low 32 bits of the absolute steps so differences are valid across whole rotations)
+void MotionHelper::getCurActuatorPos(AxisInt32s &actuatorPos)
+{
+    AxisPosition curPos;
+    _rampGenerator.getTotalStepPosition(curPos);
+    actuatorPos = curPos._stepsFromHome;
+}
+
+// Get current position in MM - this doesn't access the motion pipeline so it can be called
+// from any task (the kinematics only use the actuator position and the axis parameters)
+void MotionHelper::getCurPositionMM(AxisFloats &curPosMM)
+{
+    AxisPosition curActuatorPos;
+    getCurStepsFromHome(curActuatorPos);
+    if (_actuatorToPtFn)
+        _actuatorToPtFn(curActuatorPos._stepsFromHome, curPosMM, _lastCommandedAxisPos, _axesParams);
+}
+
 // Get attributes of robot
 void MotionHelper::getRobotAttributes(String& robotAttrs)
 {
@@ -233,14 +307,71 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
     {
         return _motionPlanner.moveToStepwise(args, _lastCommandedAxisPos, _axesParams, _motionPipeline);
     }
+    // Handle polar motion
+    if (args.isPolar())
+    {
+        return moveToPolar(args);
+    }
     // Convert coordinates if required
     // Convert coords to MM (in-place conversion)
     if (_convertCoordsFn)
         _convertCoordsFn(args, _axesParams);
-    // Fill in the destPos for axes for which values not specified
-    // Handle relative motion override if present
-    AxisFloats destPos = args.getPointMM();
+    // Handle arcs
+    if (args.isArc())
+    {
+        return moveToArc(args);
+    }
+    // Destination
+    AxisFloats destPos;
+    calcDestPos(args, destPos);
+
+    // Split up into blocks of maximum length
     bool includeDist[RobotConsts::MAX_AXES];
+    for (int i = 0; i < RobotConsts::MAX_AXES; i++)
+        includeDist[i] = _axesParams.isPrimaryAxis(i);
+    float lineLen = destPos.distanceTo(_lastCommandedAxisPos._axisPositionMM, includeDist);
+
+    // Adaptive splitting uses as few blocks as possible while keeping within the path tolerance
+    bool splitAdaptively = (_pathToleranceMM > 0) && _ptToActuatorFn && _actuatorToPtFn && !args.getDontSplitMove();
+
+    // Ensure at least one block
+    int numBlocks = 1;
+    if (_blockDistanceMM > 0.01f && !args.getDontSplitMove() && !splitAdaptively)
+        numBlocks = int(ceilf(lineLen / _blockDistanceMM));
+    if (numBlocks == 0)
+        numBlocks = 1;
+
+    // Setup for adding blocks to the pipe
+    _blocksToAddCommandArgs = args;
+    _blocksToAddStartPos = _lastCommandedAxisPos._axisPositionMM;
+    _blocksToAddDelta = (destPos - _lastCommandedAxisPos._axisPositionMM) / float(numBlocks);
+    _blocksToAddEndPos = destPos;
+    _blocksToAddIsPolar = false;
+    _blocksToAddIsArc = false;
+    _blocksToAddIsAdaptive = splitAdaptively;
+    if (splitAdaptively)
+        adaptiveSetup(lineLen);
+    _blocksToAddCurBlock = 0;
+    _blocksToAddTotal = numBlocks;
+
+    // Process anything that can be done immediately
+    blocksToAddProcess();
+    return true;
+}
+
+// Check relative motion - override current options if this command explicitly states a moveType
+bool MotionHelper::isMoveRelative(RobotCommandArgs &args)
+{
+    if (args.getMoveType() != RobotMoveTypeArg_None)
+        return args.getMoveType() == RobotMoveTypeArg_Relative;
+    return _moveRelative;
+}
+
+// Fill in the destination for axes for which values are not specified and
+// handle relative motion
+void MotionHelper::calcDestPos(RobotCommandArgs &args, AxisFloats &destPos)
+{
+    destPos = args.getPointMM();
     for (int i = 0; i < RobotConsts::MAX_AXES; i++)
     {
         if (!args.isValid(i))
@@ -254,11 +385,8 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
         }
         else
         {
-            // Check relative motion - override current options if this command
-            // explicitly states a moveType
-            bool moveRelative = _moveRelative;
-            if (args.getMoveType() != RobotMoveTypeArg_None)
-                moveRelative = (args.getMoveType() == RobotMoveTypeArg_Relative);
+            // Check relative motion
+            bool moveRelative = isMoveRelative(args);
             if (moveRelative)
                 destPos.setVal(i, _lastCommandedAxisPos._axisPositionMM.getVal(i) + args.getValMM(i));
 #ifdef DEBUG_MOTION_HELPER
@@ -268,24 +396,87 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
                     moveRelative ? "Y" : "N");
 #endif
         }
-        includeDist[i] = _axesParams.isPrimaryAxis(i);
     }
+}
 
-    // Split up into blocks of maximum length
-    double lineLen = destPos.distanceTo(_lastCommandedAxisPos._axisPositionMM, includeDist);
+// Move along an arc (GCode G2/G3) in the plane of axes 0 and 1 - the centre is specified as an
+// offset from the start point and any other axes move linearly (helix)
+// The arc is split into chords which deviate from the true arc by no more than the chord tolerance
+// and these go straight to the planner as blocks
+bool MotionHelper::moveToArc(RobotCommandArgs &args)
+{
+    // Destination
+    AxisFloats destPos;
+    calcDestPos(args, destPos);
+
+    // Centre and radius
+    AxisFloats &startPos = _lastCommandedAxisPos._axisPositionMM;
+    AxisFloats &centreOffset = args.getArcCentreOffset();
+    float centreX = startPos.getVal(0) + centreOffset.getVal(0);
+    float centreY = startPos.getVal(1) + centreOffset.getVal(1);
+    float radius = sqrtf(centreOffset.getVal(0) * centreOffset.getVal(0) + centreOffset.getVal(1) * centreOffset.getVal(1));
+    if (radius < distToTravelMM_ignoreBelow)
+    {
+        Log.verbose("%smoveToArc radius too small\n", MODULE_PREFIX);
+        return false;
+    }
 
-    // Ensure at least one block
+    // The end point must be on the arc (to within the chord tolerance)
+    float endRadius = sqrtf((destPos.getVal(0) - centreX) * (destPos.getVal(0) - centreX) +
+                            (destPos.getVal(1) - centreY) * (destPos.getVal(1) - centreY));
+    if (fabsf(endRadius - radius) > fmaxf(_arcChordToleranceMM, distToTravelMM_ignoreBelow))
+    {
+        Log.notice("%smoveToArc end not on arc radius %F end radius %F\n", MODULE_PREFIX, radius, endRadius);
+        return false;
+    }
+
+    // Angle travelled - start and end at the same point is a full circle
+    static constexpr float ARC_ANGULAR_TRAVEL_EPSILON = 5E-7f;
+    float startAngle = atan2f(-centreOffset.getVal(1), -centreOffset.getVal(0));
+    float endAngle = atan2f(destPos.getVal(1) - centreY, destPos.getVal(0) - centreX);
+    float angularTravel = endAngle - startAngle;
+    if (args.isMoveClockwise())
+    {
+        if (angularTravel >= -ARC_ANGULAR_TRAVEL_EPSILON)
+            angularTravel -= float(2 * M_PI);
+    }
+    else
+    {
+        if (angularTravel <= ARC_ANGULAR_TRAVEL_EPSILON)
+            angularTravel += float(2 * M_PI);
+    }
+
+    // Number of chords required to stay within the chord tolerance
     int numBlocks = 1;
+    if ((_arcChordToleranceMM > 0) && (_arcChordToleranceMM < radius))
+    {
+        float maxChordAngle = 2 * acosf(1 - _arcChordToleranceMM / radius);
+        numBlocks = int(ceilf(fabsf(angularTravel) / maxChordAngle));
+    }
+    // Also respect the maximum block length
     if (_blockDistanceMM > 0.01f && !args.getDontSplitMove())
-        numBlocks = int(ceil(lineLen / _blockDistanceMM));
-    if (numBlocks == 0)
+        numBlocks = max(numBlocks, int(ceilf(fabsf(angularTravel) * radius / _blockDistanceMM)));
+    if (numBlocks <= 0)
         numBlocks = 1;
 
+#ifdef DEBUG_MOTION_HELPER
+    Log.notice("%smoveToArc centre %F,%F radius %F angle %F blocks %d\n", MODULE_PREFIX,
+            centreX, centreY, radius, angularTravel, numBlocks);
+#endif
+
     // Setup for adding blocks to the pipe
     _blocksToAddCommandArgs = args;
-    _blocksToAddStartPos = _lastCommandedAxisPos._axisPositionMM;
-    _blocksToAddDelta = (destPos - _lastCommandedAxisPos._axisPositionMM) / float(numBlocks);
+    _blocksToAddStartPos = startPos;
+    _blocksToAddDelta = (destPos - startPos) / float(numBlocks);
     _blocksToAddEndPos = destPos;
+    _blocksToAddIsPolar = false;
+    _blocksToAddIsArc = true;
+    _blocksToAddIsAdaptive = false;
+    _blocksToAddArcCentreX = centreX;
+    _blocksToAddArcCentreY = centreY;
+    _blocksToAddArcRadius = radius;
+    _blocksToAddArcStartAngle = startAngle;
+    _blocksToAddArcAngleDelta = angularTravel / numBlocks;
     _blocksToAddCurBlock = 0;
     _blocksToAddTotal = numBlocks;
 
@@ -294,6 +485,130 @@ bool MotionHelper::moveTo(RobotCommandArgs &args)
     return true;
 }
 
+// Move to a point specified in polar coords (theta degrees, rho fraction of max radius) - only
+// available on robots with polar kinematics - blocks are interpolated in polar coords and go
+// straight to actuator coords with no cartesian round trip
+// In relative mode theta and rho are added to the current position and theta turns by exactly the
+// amount given (otherwise theta takes the shortest route)
+bool MotionHelper::moveToPolar(RobotCommandArgs &args)
+{
+    if (!_polarToActuatorFn || !_actuatorToPolarFn)
+    {
+        Log.verbose("%smoveToPolar not supported by robot\n", MODULE_PREFIX);
+        return false;
+    }
+
+    // Start from the polar position of the last commanded actuator position
+    AxisFloats startPolar;
+    _actuatorToPolarFn(_lastCommandedAxisPos._stepsFromHome, startPolar, _axesParams);
+    AxisFloats destPolar = args.getPointPolar();
+    bool moveRelative = isMoveRelative(args);
+    if (moveRelative)
+        destPolar = startPolar + destPolar;
+
+    // Check the destination is valid and find the equivalent cartesian point
+    AxisFloats destActuator;
+    AxisFloats destPos = _lastCommandedAxisPos._axisPositionMM;
+    if (!_polarToActuatorFn(destPolar, destActuator, destPos, _lastCommandedAxisPos, _axesParams,
+                args.getAllowOutOfBounds() || _allowAllOutOfBounds))
+        return false;
+
+    // Polar change
+    AxisFloats polarDelta = destPolar - startPolar;
+    if (!moveRelative)
+    {
+        // Theta is held close to the origin (see polarToActuator) so moves to the origin go straight
+        // in and moves from the origin turn to the destination theta there and go straight out
+        AxisFloats &startPos = _lastCommandedAxisPos._axisPositionMM;
+        if (AxisUtils::isApprox(destPos.getVal(0), 0, 1) && AxisUtils::isApprox(destPos.getVal(1), 0, 1))
+            destPolar.setVal(0, startPolar.getVal(0));
+        else if (AxisUtils::isApprox(startPos.getVal(0), 0, 1) && AxisUtils::isApprox(startPos.getVal(1), 0, 1))
+            startPolar.setVal(0, destPolar.getVal(0));
+
+        // Theta takes the shortest route
+        float thetaDelta = destPolar.getVal(0) - startPolar.getVal(0);
+        if (thetaDelta <= -180)
+            thetaDelta += 360;
+        else if (thetaDelta > 180)
+            thetaDelta -= 360;
+        polarDelta.set(thetaDelta, destPolar.getVal(1) - startPolar.getVal(1));
+    }
+
+    // Setup for adding blocks to the pipe
+    _blocksToAddCommandArgs = args;
+    _blocksToAddStartPos = startPolar;
+    _blocksToAddEndPos = destPolar;
+    _blocksToAddIsPolar = true;
+    _blocksToAddIsArc = false;
+
+    // Path length is that of the path interpolated in polar coords (not the chord)
+    _blocksToAddDelta = polarDelta;
+    float pathLen = polarPathLen();
+
+    // Adaptive splitting checks the actuator path against the path interpolated in polar coords
+    bool splitAdaptively = (_pathToleranceMM > 0) && _actuatorToPtFn && !args.getDontSplitMove();
+
+    // Ensure at least one block
+    int numBlocks = 1;
+    if (_blockDistanceMM > 0.01f && !args.getDontSplitMove() && !splitAdaptively)
+        numBlocks = int(ceilf(pathLen / _blockDistanceMM));
+    if (numBlocks == 0)
+        numBlocks = 1;
+
+    // The robot turns theta by the shortest route to the end of each block so blocks must turn
+    // by less than half a turn
+    float absThetaDelta = fabsf(polarDelta.getVal(0));
+    numBlocks = max(numBlocks, int(ceilf(absThetaDelta / polarMaxBlockDegrees)));
+
+#ifdef DEBUG_MOTION_HELPER
+    Log.notice("%smoveToPolar theta %F rho %F pathLen %F blocks %d adaptive %s\n", MODULE_PREFIX,
+            polarDelta.getVal(0), polarDelta.getVal(1), pathLen, numBlocks, splitAdaptively ? "Y" : "N");
+#endif
+
+    _blocksToAddIsAdaptive = splitAdaptively;
+    if (splitAdaptively)
+    {
+        adaptiveSetup(pathLen);
+        if (absThetaDelta > polarMaxBlockDegrees)
+            _blocksToAddAdaptiveMaxStep = std::min(_blocksToAddAdaptiveMaxStep, polarMaxBlockDegrees / absThetaDelta);
+    }
+    else
+    {
+        _blocksToAddDelta = polarDelta / float(numBlocks);
+    }
+    _blocksToAddCurBlock = 0;
+    _blocksToAddTotal = numBlocks;
+
+    // Process anything that can be done immediately
+    blocksToAddProcess();
+    return true;
+}
+
+// Length of the path of a polar move (from _blocksToAddStartPos by _blocksToAddDelta) - the sum
+// of chords of the path interpolated in polar coords
+float MotionHelper::polarPathLen()
+{
+    int numChords = max(polarPathLenMinChords, int(ceilf(fabsf(_blocksToAddDelta.getVal(0)) / polarPathLenChordDegrees)));
+    float pathLen = 0;
+    AxisFloats prevPt, pt, actuator;
+    for (int chordIdx = 0; chordIdx <= numChords; chordIdx++)
+    {
+        AxisFloats movePolar = _blocksToAddStartPos + _blocksToAddDelta * (float(chordIdx) / numChords);
+        pt = _lastCommandedAxisPos._axisPositionMM;
+        _polarToActuatorFn(movePolar, actuator, pt, _lastCommandedAxisPos, _axesParams, true);
+        if (chordIdx > 0)
+        {
+            float lenSq = 0;
+            for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+                if (_axesParams.isPrimaryAxis(axisIdx))
+                    lenSq += (pt.getVal(axisIdx) - prevPt.getVal(axisIdx)) * (pt.getVal(axisIdx) - prevPt.getVal(axisIdx));
+            pathLen += sqrtf(lenSq);
+        }
+        prevPt = pt;
+    }
+    return pathLen;
+}
+
 // A single moveTo command can be split into blocks - this function checks if such
 // splitting is in progress and adds the split-up motion blocks accordingly
 void MotionHelper::blocksToAddProcess()
@@ -302,26 +617,48 @@ void MotionHelper::blocksToAddProcess()
     while (_motionPipeline.canAccept())
     {
         // Check if any blocks remain to be expanded out
-        if (_blocksToAddTotal <= 0)
+        if (!blocksToAddPending())
             return;
 
         // Add to pipeline any blocks that are waiting to be expanded out
-        AxisFloats nextBlockDest = _blocksToAddStartPos + _blocksToAddDelta * float(_blocksToAddCurBlock + 1);
+        AxisFloats nextBlockDest;
+        bool isLastBlock = false;
+        if (_blocksToAddIsAdaptive)
+        {
+            // Adaptive blocks run until the end of the move is reached
+            _blocksToAddAdaptivePos = adaptiveBlockEnd();
+            nextBlockDest = _blocksToAddStartPos + _blocksToAddDelta * _blocksToAddAdaptivePos;
+            isLastBlock = _blocksToAddAdaptivePos >= 1;
+        }
+        else
+        {
+            nextBlockDest = _blocksToAddStartPos + _blocksToAddDelta * float(_blocksToAddCurBlock + 1);
+            if (_blocksToAddIsArc)
+            {
+                float angle = _blocksToAddArcStartAngle + _blocksToAddArcAngleDelta * float(_blocksToAddCurBlock + 1);
+                nextBlockDest.setVal(0, _blocksToAddArcCentreX + _blocksToAddArcRadius * cosf(angle));
+                nextBlockDest.setVal(1, _blocksToAddArcCentreY + _blocksToAddArcRadius * sinf(angle));
+            }
+            isLastBlock = _blocksToAddCurBlock + 1 >= _blocksToAddTotal;
+        }
 
         // If last block then just use end point coords
-        if (_blocksToAddCurBlock + 1 >= _blocksToAddTotal)
+        if (isLastBlock)
             nextBlockDest = _blocksToAddEndPos;
 
         // Bump position
         _blocksToAddCurBlock++;
 
         // Check if done
-        if (_blocksToAddCurBlock >= _blocksToAddTotal)
+        if (isLastBlock)
             _blocksToAddTotal = 0;
 
         // Prepare add to planner
-        _blocksToAddCommandArgs.setPointMM(nextBlockDest);
-        _blocksToAddCommandArgs.setMoreMovesComing(_blocksToAddTotal != 0);
+        if (_blocksToAddIsPolar)
+            _blocksToAddCommandArgs.setPointPolar(nextBlockDest);
+        else
+            _blocksToAddCommandArgs.setPointMM(nextBlockDest);
+        _blocksToAddCommandArgs.setMoreMovesComing(!isLastBlock);
 
 
         // Add to planner
@@ -334,6 +671,185 @@ void MotionHelper::blocksToAddProcess()
     }
 }
 
+// Setup for adaptive splitting of a move of the given length - the number of blocks isn't known in
+// advance so the first attempt is the whole move (limited to the maximum block length)
+void MotionHelper::adaptiveSetup(float pathLen)
+{
+    _blocksToAddAdaptivePos = 0;
+    _blocksToAddAdaptiveStep = 1;
+    _blocksToAddAdaptiveMinStep = (pathLen > adaptiveBlockMinMM) ? float(adaptiveBlockMinMM / pathLen) : 1;
+    _blocksToAddAdaptiveMaxStep = 1;
+    if ((_blockDistanceMM > 0.01f) && (pathLen > _blockDistanceMM))
+        _blocksToAddAdaptiveMaxStep = std::max(_blockDistanceMM / pathLen, _blocksToAddAdaptiveMinStep);
+}
+
+// Find the end (as a fraction of the whole move) of the next adaptively split block - the
+// actuators move linearly in actuator coords during a block so the block is made as long as
+// possible while the resulting path stays within the path tolerance of the straight line
+float MotionHelper::adaptiveBlockEnd()
+{
+    float startFrac = _blocksToAddAdaptivePos;
+    float remaining = 1 - startFrac;
+    if (remaining <= _blocksToAddAdaptiveMinStep)
+        return 1;
+
+    // Start from twice the previous block length (the curvature changes gradually along a line)
+    // and halve until within tolerance - blocks are never longer than the maximum block length
+    float step = std::min(std::min(_blocksToAddAdaptiveStep * 2, _blocksToAddAdaptiveMaxStep), remaining);
+
+    // Actuator coords at the start of the block and at the first candidate end
+    AxisFloats startActuator, endActuator;
+    if (!adaptiveBlockActuators(startFrac, startFrac + step, startActuator, endActuator))
+        return 1;
+    while (step > _blocksToAddAdaptiveMinStep)
+    {
+        if (adaptiveBlockDeviation(startFrac, startFrac + step, startActuator, endActuator) <= _pathToleranceMM)
+            break;
+        step /= 2;
+        if (!adaptiveBlockActuator(startFrac + step, endActuator))
+            break;
+    }
+    step = std::max(step, _blocksToAddAdaptiveMinStep);
+    _blocksToAddAdaptiveStep = step;
+    return std::min(startFrac + step, 1.0f);
+}
+
+// Actuator coords (and optionally the cartesian point) at a fraction of the whole move - for polar
+// moves the point is interpolated in polar coords
+bool MotionHelper::adaptiveBlockActuator(float frac, AxisFloats &actuator, AxisFloats *pPt)
+{
+    AxisFloats movePt = _blocksToAddStartPos + _blocksToAddDelta * frac;
+    if (_blocksToAddIsPolar)
+    {
+        AxisFloats pt = _lastCommandedAxisPos._axisPositionMM;
+        bool rslt = _polarToActuatorFn(movePt, actuator, pt, _lastCommandedAxisPos, _axesParams, true);
+        if (pPt)
+            *pPt = pt;
+        return rslt;
+    }
+    if (pPt)
+        *pPt = movePt;
+    return _ptToActuatorFn(movePt, actuator, _lastCommandedAxisPos, _axesParams, true);
+}
+
+// Actuator coords at two points (fractions of the whole move) - converted together when the robot
+// supports batch conversion
+bool MotionHelper::adaptiveBlockActuators(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator)
+{
+    if (!_ptsToActuatorFn || _blocksToAddIsPolar)
+        return adaptiveBlockActuator(startFrac, startActuator) && adaptiveBlockActuator(endFrac, endActuator);
+    AxisFloats startPt = _blocksToAddStartPos + _blocksToAddDelta * startFrac;
+    AxisFloats endPt = _blocksToAddStartPos + _blocksToAddDelta * endFrac;
+
+    // Structure of arrays with one array per axis
+    static constexpr int NUM_PTS = 2;
+    float ptVals[RobotConsts::MAX_AXES][NUM_PTS];
+    float actuatorVals[RobotConsts::MAX_AXES][NUM_PTS];
+    const float *ptAxes[RobotConsts::MAX_AXES];
+    float *actuatorAxes[RobotConsts::MAX_AXES];
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        ptVals[axisIdx][0] = startPt.getVal(axisIdx);
+        ptVals[axisIdx][1] = endPt.getVal(axisIdx);
+        actuatorVals[axisIdx][0] = actuatorVals[axisIdx][1] = 0;
+        ptAxes[axisIdx] = ptVals[axisIdx];
+        actuatorAxes[axisIdx] = actuatorVals[axisIdx];
+    }
+    if (!_ptsToActuatorFn(ptAxes, actuatorAxes, NUM_PTS, _lastCommandedAxisPos, _axesParams, true))
+        return false;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        startActuator.setVal(axisIdx, actuatorVals[axisIdx][0]);
+        endActuator.setVal(axisIdx, actuatorVals[axisIdx][1]);
+    }
+    return true;
+}
+
+// Maximum distance from the intended path of the path taken by the actuators moving from
+// startActuator to endActuator - the intended path is the straight line or, for polar moves, the
+// path interpolated in polar coords between startFrac and endFrac
+float MotionHelper::adaptiveBlockDeviation(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator)
+{
+    if (_blocksToAddIsPolar)
+        return adaptiveBlockPolarDeviation(startFrac, endFrac, startActuator, endActuator);
+
+    // Unit vector along the line (primary axes)
+    float lineLen = 0;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (_axesParams.isPrimaryAxis(axisIdx))
+            lineLen += _blocksToAddDelta.getVal(axisIdx) * _blocksToAddDelta.getVal(axisIdx);
+    lineLen = sqrtf(lineLen);
+    if (lineLen <= 0)
+        return 0;
+
+    // Check points within the block
+    static constexpr int NUM_CHECK_POINTS = 3;
+    float maxDeviation = 0;
+    for (int checkIdx = 1; checkIdx <= NUM_CHECK_POINTS; checkIdx++)
+    {
+        // Actuator position part-way through the block and the corresponding point
+        float checkFrac = float(checkIdx) / (NUM_CHECK_POINTS + 1);
+        AxisInt32s checkActuator;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            checkActuator.setVal(axisIdx, int32_t(roundf(startActuator.getVal(axisIdx) +
+                        (endActuator.getVal(axisIdx) - startActuator.getVal(axisIdx)) * checkFrac)));
+        AxisFloats checkPt;
+        _actuatorToPtFn(checkActuator, checkPt, _lastCommandedAxisPos, _axesParams);
+
+        // Perpendicular distance from the line
+        float alongLine = 0;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            if (_axesParams.isPrimaryAxis(axisIdx))
+                alongLine += (checkPt.getVal(axisIdx) - _blocksToAddStartPos.getVal(axisIdx)) * _blocksToAddDelta.getVal(axisIdx) / lineLen;
+        float deviationSq = 0;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        {
+            if (!_axesParams.isPrimaryAxis(axisIdx))
+                continue;
+            float offLine = checkPt.getVal(axisIdx) - _blocksToAddStartPos.getVal(axisIdx) -
+                        alongLine * _blocksToAddDelta.getVal(axisIdx) / lineLen;
+            deviationSq += offLine * offLine;
+        }
+        maxDeviation = std::max(maxDeviation, sqrtf(deviationSq));
+    }
+    return maxDeviation;
+}
+
+// Maximum distance of the path taken by the actuators from the path interpolated in polar coords -
+// the distance is between points at the same fraction of the block so it is never less than the
+// distance from the polar path
+float MotionHelper::adaptiveBlockPolarDeviation(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator)
+{
+    static constexpr int NUM_CHECK_POINTS = 3;
+    float maxDeviation = 0;
+    for (int checkIdx = 1; checkIdx <= NUM_CHECK_POINTS; checkIdx++)
+    {
+        // Actuator position part-way through the block and the corresponding point
+        float checkFrac = float(checkIdx) / (NUM_CHECK_POINTS + 1);
+        AxisInt32s checkActuator;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            checkActuator.setVal(axisIdx, int32_t(roundf(startActuator.getVal(axisIdx) +
+                        (endActuator.getVal(axisIdx) - startActuator.getVal(axisIdx)) * checkFrac)));
+        AxisFloats checkPt;
+        _actuatorToPtFn(checkActuator, checkPt, _lastCommandedAxisPos, _axesParams);
+
+        // Point on the polar path
+        AxisFloats polarActuator, polarPt;
+        if (!adaptiveBlockActuator(startFrac + (endFrac - startFrac) * checkFrac, polarActuator, &polarPt))
+            continue;
+        float deviationSq = 0;
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        {
+            if (!_axesParams.isPrimaryAxis(axisIdx))
+                continue;
+            float offPath = checkPt.getVal(axisIdx) - polarPt.getVal(axisIdx);
+            deviationSq += offPath * offPath;
+        }
+        maxDeviation = std::max(maxDeviation, sqrtf(deviationSq));
+    }
+    return maxDeviation;
+}
+
 // Add a movement to the pipeline using the planner which computes suitable motion
 bool MotionHelper::addToPlanner(RobotCommandArgs &args)
 {
@@ -344,9 +860,20 @@ bool MotionHelper::addToPlanner(RobotCommandArgs &args)
     // Convert the move to actuator coordinates
     AxisFloats actuatorCoords;
     bool moveOk = false;
-    if (_ptToActuatorFn)
+    if (args.isPolar())
+    {
+        // The planner works in cartesian so the polar conversion also provides the equivalent point
+        AxisFloats destPos = _lastCommandedAxisPos._axisPositionMM;
+        if (_polarToActuatorFn)
+            moveOk = _polarToActuatorFn(args.getPointPolar(), actuatorCoords, destPos, _lastCommandedAxisPos, _axesParams,
+                    args.getAllowOutOfBounds() || _allowAllOutOfBounds);
+        args.setPointMM(destPos);
+    }
+    else if (_ptToActuatorFn)
+    {
         moveOk = _ptToActuatorFn(args.getPointMM(), actuatorCoords, _lastCommandedAxisPos, _axesParams,
                     args.getAllowOutOfBounds() || _allowAllOutOfBounds);
+    }
 
     // Plan the move
     if (moveOk)
@@ -377,7 +904,7 @@ void MotionHelper::service()
     {
         if (Utils::isTimeout(millis(), _stopRequestTimeMs, MAX_TIME_BEFORE_STOP_COMPLETE_MS))
         {
-            _blocksToAddTotal = 0;
+            blocksToAddClear();
             _rampGenerator.stop();
             _trinamicsController.stop();
             _motionPipeline.clear();
@@ -387,8 +914,10 @@ void MotionHelper::service()
         }
     }
 
-    // Call process on motion actuator - only really used for testing as
-    // motion is handled by ISR
+    // Complete any pipeline clear
+    _motionPipeline.service();
+
+    // Call process on motion actuator - this compiles step segments for the ISR
     _rampGenerator.process();
 
     // Process any split-up blocks to be added to the pipeline
@@ -411,7 +940,9 @@ void MotionHelper::setCurPositionAsHome(int axisIdx)
     if (axisIdx < 0 || axisIdx >= RobotConsts::MAX_AXES)
         return;
     _lastCommandedAxisPos._axisPositionMM.setVal(axisIdx, _axesParams.getHomeOffsetVal(axisIdx));
-    _lastCommandedAxisPos._stepsFromHome.setVal(axisIdx, _axesParams.gethomeOffSteps(axisIdx));
+    _lastCommandedAxisPos.setAbsSteps(axisIdx, _axesParams.gethomeOffSteps(axisIdx));
+    if (_correctStepOverflowFn)
+        _correctStepOverflowFn(_lastCommandedAxisPos, _axesParams);
     _rampGenerator.setTotalStepPosition(axisIdx, _axesParams.gethomeOffSteps(axisIdx));
 }
 
@@ -436,10 +967,11 @@ int MotionHelper::testGetPipelineCount()
     return _motionPipeline.count();
 }
 
-bool MotionHelper::testGetPipelineBlock(int elIdx, MotionBlock &block)
+bool MotionHelper::testGetPipelineBlock(int elIdx, MotionBlock &block, MotionBlockExec &blockExec)
 {
     if ((int)_motionPipeline.count() <= elIdx)
         return false;
     block = *_motionPipeline.peekNthFromPut(_motionPipeline.count() - 1 - elIdx);
+    blockExec = *_motionPipeline.peekExecNthFromPut(_motionPipeline.count() - 1 - elIdx);
     return true;
 }
@@ -17,8 +17,14 @@ class MotionHelper
 public:
     static constexpr float blockDistanceMM_default = 0.0f;
     static constexpr float junctionDeviation_default = 0.05f;
+    static constexpr float arcChordToleranceMM_default = 0.02f;
+    static constexpr float pathToleranceMM_default = 0.0f;
+    static constexpr float adaptiveBlockMinMM = 0.05f;
     static constexpr float distToTravelMM_ignoreBelow = 0.01f;
-    static constexpr int pipelineLen_default = 100;
+    static constexpr float polarMaxBlockDegrees = 90.0f;
+    static constexpr int polarPathLenMinChords = 16;
+    static constexpr float polarPathLenChordDegrees = 10.0f;
+    static constexpr int pipelineLen_default = 256;
     static constexpr uint32_t MAX_TIME_BEFORE_STOP_COMPLETE_MS = 500;
 
 private:
@@ -26,6 +32,11 @@ private:
     bool _isPaused;
     // Block distance
     float _blockDistanceMM;
+    // Maximum deviation of an arc chord from the true arc
+    float _arcChordToleranceMM;
+    // Maximum deviation of the actual path from a straight line move - when non-zero
+    // straight and polar moves are split adaptively into blocks of up to _blockDistanceMM
+    float _pathToleranceMM;
     // Allow all out of bounds movement
     bool _allowAllOutOfBounds;
     // Axes parameters
@@ -38,6 +49,11 @@ private:
     correctStepOverflowFnType _correctStepOverflowFn;
     convertCoordsFnType _convertCoordsFn;
     setRobotAttributesFnType _setRobotAttributes;
+    // Callbacks for robots with native polar kinematics (optional)
+    polarToActuatorFnType _polarToActuatorFn;
+    actuatorToPolarFnType _actuatorToPolarFn;
+    // Callback to convert a batch of points to actuator coords (optional)
+    ptsToActuatorFnType _ptsToActuatorFn;
     // Relative motion
     bool _moveRelative;
     // Planner used to plan the pipeline of motion
@@ -66,6 +82,21 @@ private:
     AxisFloats _blocksToAddEndPos;
     // Deltas for each axis for block generation
     AxisFloats _blocksToAddDelta;
+    // Blocks are being generated in polar coords
+    bool _blocksToAddIsPolar;
+    // Blocks are being generated around an arc in the plane of axes 0 and 1
+    bool _blocksToAddIsArc;
+    float _blocksToAddArcCentreX;
+    float _blocksToAddArcCentreY;
+    float _blocksToAddArcRadius;
+    float _blocksToAddArcStartAngle;
+    float _blocksToAddArcAngleDelta;
+    // Blocks are being generated adaptively - progress is a fraction of the whole move
+    bool _blocksToAddIsAdaptive;
+    float _blocksToAddAdaptivePos;
+    float _blocksToAddAdaptiveStep;
+    float _blocksToAddAdaptiveMinStep;
+    float _blocksToAddAdaptiveMaxStep;
     // Command args for block generation
     RobotCommandArgs _blocksToAddCommandArgs;
 
@@ -82,7 +113,9 @@ public:
 
     void setTransforms(ptToActuatorFnType ptToActuatorFn, actuatorToPtFnType actuatorToPtFn,
                        correctStepOverflowFnType correctStepOverflowFn,
-                       convertCoordsFnType convertCoordsFn, setRobotAttributesFnType setRobotAttributes);
+                       convertCoordsFnType convertCoordsFn, setRobotAttributesFnType setRobotAttributes,
+                       polarToActuatorFnType polarToActuatorFn = nullptr, actuatorToPolarFnType actuatorToPolarFn = nullptr,
+                       ptsToActuatorFnType ptsToActuatorFn = nullptr);
 
     void configure(const char *robotConfigJSON);
 
@@ -96,18 +129,20 @@ public:
     void stop();
     // Check if idle
     bool isIdle();
+    // Check if homing
+    bool isHoming();
 
-    double getStepsPerUnit(int axisIdx)
+    float getStepsPerUnit(int axisIdx)
     {
         return _axesParams.getStepsPerUnit(axisIdx);
     }
 
-    double getStepsPerRot(int axisIdx)
+    float getStepsPerRot(int axisIdx)
     {
         return _axesParams.getStepsPerRot(axisIdx);
     }
 
-    double getunitsPerRot(int axisIdx)
+    float getunitsPerRot(int axisIdx)
     {
         return _axesParams.getunitsPerRot(axisIdx);
     }
@@ -127,6 +162,8 @@ public:
     bool moveTo(RobotCommandArgs &args);
     void setMotionParams(RobotCommandArgs &args);
     void getCurStatus(RobotCommandArgs &args);
+    void getCurActuatorPos(AxisInt32s &actuatorPos);
+    void getCurPositionMM(AxisFloats &curPosMM);
     void getRobotAttributes(String& robotAttrs);
     void goHome(RobotCommandArgs &args);
     int getLastCompletedNumberedCmdIdx()
@@ -140,13 +177,19 @@ public:
         return _motorEnabler.getLastActiveUnixTime();
     }
 
+    // ISR timing statistics
+    String getISRStatsJSON(bool reset)
+    {
+        return _rampGenerator.getISRStatsJSON(reset);
+    }
+
     // Test code
     void debugShowBlocks();
     void debugShowTopBlock();
     void debugShowTiming();
     String getDebugStr();
     int testGetPipelineCount();
-    bool testGetPipelineBlock(int elIdx, MotionBlock &elem);
+    bool testGetPipelineBlock(int elIdx, MotionBlock &elem, MotionBlockExec &elemExec);
     void setIntrumentationMode(const char *testModeStr)
     {
         _rampGenerator.setInstrumentationMode(testModeStr);
@@ -157,14 +200,55 @@ public:
     {
         return &_motionHoming;
     }
+
+    // Transforms set by the robot geometry
+    ptToActuatorFnType testGetPtToActuatorFn()
+    {
+        return _ptToActuatorFn;
+    }
+    ptsToActuatorFnType testGetPtsToActuatorFn()
+    {
+        return _ptsToActuatorFn;
+    }
+    actuatorToPtFnType testGetActuatorToPtFn()
+    {
+        return _actuatorToPtFn;
+    }
+    correctStepOverflowFnType testGetCorrectStepOverflowFn()
+    {
+        return _correctStepOverflowFn;
+    }
 #endif
 
 private:
-    bool isInBounds(double v, double b1, double b2)
+    bool isInBounds(float v, float b1, float b2)
     {
-        return (v > fmin(b1, b2) && v < fmax(b1, b2));
+        return (v > fminf(b1, b2) && v < fmaxf(b1, b2));
     }
     void setCurPosActualPosition();
+    void getCurStepsFromHome(AxisPosition &actuatorPos);
+    bool isMoveRelative(RobotCommandArgs &args);
+    void calcDestPos(RobotCommandArgs &args, AxisFloats &destPos);
+    bool moveToArc(RobotCommandArgs &args);
+    bool blocksToAddPending()
+    {
+        if (_blocksToAddIsAdaptive)
+            return _blocksToAddAdaptivePos < 1;
+        return _blocksToAddTotal > 0;
+    }
+    void blocksToAddClear()
+    {
+        _blocksToAddTotal = 0;
+        _blocksToAddIsAdaptive = false;
+    }
+    void adaptiveSetup(float pathLen);
+    float adaptiveBlockEnd();
+    bool adaptiveBlockActuator(float frac, AxisFloats &actuator, AxisFloats *pPt = NULL);
+    bool adaptiveBlockActuators(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator);
+    float adaptiveBlockDeviation(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator);
+    float adaptiveBlockPolarDeviation(float startFrac, float endFrac, AxisFloats &startActuator, AxisFloats &endActuator);
+    bool moveToPolar(RobotCommandArgs &args);
+    float polarPathLen();
     bool addToPlanner(RobotCommandArgs &args);
     void blocksToAddProcess();
 };
@@ -59,9 +59,7 @@ void MotionHoming::homingStart(RobotCommandArgs &args)
     _doCentring = false;
     _homeReqMillis = millis();
     _feedrateStepsPerSecForHoming = -1;
-    RobotCommandArgs curStatus;
-    _pMotionHelper->getCurStatus(curStatus);
-    _homingStartSteps = curStatus.getPointSteps();
+    _pMotionHelper->getCurActuatorPos(_homingStartSteps);
     Log.notice("%sstart, seq = %s\n", MODULE_PREFIX, _homingSequence.c_str());
 }
 
@@ -214,9 +212,7 @@ void MotionHoming::startCentringOperation()
     // Start the centring process
     _centringInProgress = true;
     _centringPhase = 0;
-    RobotCommandArgs curStatus;
-    _pMotionHelper->getCurStatus(curStatus);
-    _centringSteps[_centringPhase++] = curStatus.getPointSteps();
+    _pMotionHelper->getCurActuatorPos(_centringSteps[_centringPhase++]);
     // Process first part of centring
     processHomingCommand(_curCommand);
 }
@@ -228,9 +224,7 @@ bool MotionHoming::nextCentringOperation()
     // Record current position
     if (_centringPhase >= NUM_CENTRING_PHASES)
         return false;
-    RobotCommandArgs curStatus;
-    _pMotionHelper->getCurStatus(curStatus);
-    _centringSteps[_centringPhase] = curStatus.getPointSteps();
+    _pMotionHelper->getCurActuatorPos(_centringSteps[_centringPhase]);
     // Check which phase of centring we're in
     if (_centringPhase == 1)
     {
@@ -424,9 +418,8 @@ void MotionHoming::setAtHomePos(int axisIdx)
 
 void MotionHoming::debugShowSteps(const char* debugMsg)
 {
-    RobotCommandArgs curStatus;
-    _pMotionHelper->getCurStatus(curStatus);
-    AxisInt32s curSteps = curStatus.getPointSteps();
+    AxisInt32s curSteps;
+    _pMotionHelper->getCurActuatorPos(curSteps);
     Log.DBG_HOMING_LVL("%s%s stepFromHomingStart %d %d %d\n", MODULE_PREFIX, 
             debugMsg, 
             curSteps.getVal(0) - _homingStartSteps.getVal(0),
@@ -10,24 +10,55 @@
 class MotionPipeline
 {
   private:
+    // The main loop adds blocks (producer) and the ISR removes them (consumer)
     MotionRingBufferPosn _pipelinePosn;
+    // Planner data and execution records (used by the ISR) are held in separate arrays
+    // with the same index so that the execution records are compact
     std::vector<MotionBlock> _pipeline;
+    std::vector<MotionBlockExec> _pipelineExec;
+    // Planner watermark - position of the first block which the planner may still change
+    // (blocks before this are optimally planned) - only used by the planner (not the ISR)
+    unsigned int _plannedPos;
 
   public:
     MotionPipeline() : _pipelinePosn(0)
     {
+        _plannedPos = 0;
     }
 
+    // Init - the size is rounded up to a power of two - must not be called when the ISR is running
     void init(int pipelineSize)
     {
-        _pipeline.resize(pipelineSize);
         _pipelinePosn.init(pipelineSize);
+        _pipeline.resize(_pipelinePosn.size());
+        _pipelineExec.resize(_pipelinePosn.size());
+        _plannedPos = 0;
     }
 
-    // Clear the pipeline
+    // Clear the pipeline (any context) - the blocks are discarded by the ISR and the clear is completed
+    // by service() in the main loop - no blocks can be added until then
     void clear()
     {
-        _pipelinePosn.clear();
+        _pipelinePosn.requestFlush();
+    }
+
+    // Check if a clear is in progress
+    bool IRAM_ATTR isClearPending()
+    {
+        return _pipelinePosn.isFlushPending();
+    }
+
+    // Discard all blocks while a clear is in progress (ISR) - returns true if clearing
+    bool IRAM_ATTR serviceClearISR()
+    {
+        return _pipelinePosn.consumerFlush();
+    }
+
+    // Complete a clear once the ISR has discarded all blocks (main loop)
+    void service()
+    {
+        if (_pipelinePosn.isFlushPending() && _pipelinePosn.producerFlushAck())
+            _plannedPos = _pipelinePosn.putPos();
     }
 
     unsigned int count()
@@ -42,14 +73,16 @@ class MotionPipeline
     }
 
     // Add to pipeline
-    bool add(MotionBlock &block)
+    bool add(MotionBlock &block, MotionBlockExec &blockExec)
     {
         // Check if full
         if (!_pipelinePosn.canPut())
             return false;
 
         // Add the item
-        _pipeline[_pipelinePosn._putPos] = block;
+        unsigned int putIdx = _pipelinePosn.putIdx();
+        _pipeline[putIdx] = block;
+        _pipelineExec[putIdx] = blockExec;
         _pipelinePosn.hasPut();
         return true;
     }
@@ -61,14 +94,16 @@ class MotionPipeline
     }
 
     // Get from queue
-    bool IRAM_ATTR get(MotionBlock &block)
+    bool IRAM_ATTR get(MotionBlock &block, MotionBlockExec &blockExec)
     {
         // Check if queue is empty
         if (!_pipelinePosn.canGet())
             return false;
 
         // read the item and remove
-        block = _pipeline[_pipelinePosn._getPos];
+        unsigned int getIdx = _pipelinePosn.getIdx();
+        block = _pipeline[getIdx];
+        blockExec = _pipelineExec[getIdx];
         _pipelinePosn.hasGot();
         return true;
     }
@@ -85,14 +120,14 @@ class MotionPipeline
         return true;
     }
 
-    // Peek the block which would be got (if there is one)
-    MotionBlock* IRAM_ATTR peekGet()
+    // Peek the execution record of the block which would be got (if there is one)
+    MotionBlockExec* IRAM_ATTR peekGet()
     {
         // Check if queue is empty
         if (!_pipelinePosn.canGet())
             return NULL;
         // get pointer to the last item (don't remove)
-        return &(_pipeline[_pipelinePosn._getPos]);
+        return &(_pipelineExec[_pipelinePosn.getIdx()]);
     }
 
     // Peek from the put position
@@ -108,6 +143,16 @@ class MotionPipeline
         return &(_pipeline[nthPos]);
     }
 
+    // Peek execution record from the put position (indexed as peekNthFromPut)
+    MotionBlockExec *peekExecNthFromPut(unsigned int N)
+    {
+        // Get index
+        int nthPos = _pipelinePosn.getNthFromPut(N);
+        if (nthPos < 0)
+            return NULL;
+        return &(_pipelineExec[nthPos]);
+    }
+
     // Peek from the get position
     // 0 is the element next got from the queue
     // 1 is the one got after that
@@ -121,6 +166,33 @@ class MotionPipeline
         return &(_pipeline[nthPos]);
     }
 
+    // Peek execution record from the get position (indexed as peekNthFromGet)
+    MotionBlockExec *peekExecNthFromGet(unsigned int N)
+    {
+        // Get index
+        int nthPos = _pipelinePosn.getNthFromGet(N);
+        if (nthPos < 0)
+            return NULL;
+        return &(_pipelineExec[nthPos]);
+    }
+
+    // Get the planner watermark as an index from the put position (as used by peekNthFromPut)
+    // returns -1 if the watermark block has already left the pipeline
+    int getPlannedNthFromPut()
+    {
+        unsigned int nthFromPut = _pipelinePosn.putPos() - 1 - _plannedPos;
+        if (nthFromPut >= count())
+            return -1;
+        return nthFromPut;
+    }
+
+    // Set the planner watermark using an index from the put position
+    // -1 indicates that no blocks currently in the pipeline can be changed
+    void setPlannedNthFromPut(int N)
+    {
+        _plannedPos = _pipelinePosn.putPos() - 1 - N;
+    }
+
     // Debug
     void debugShowBlocks(AxesParams &axesParams)
     {
@@ -129,14 +201,15 @@ class MotionPipeline
         for (int i = count() - 1; i >= 0; i--)
         {
             MotionBlock *pBlock = peekNthFromPut(i);
-            if (pBlock)
+            MotionBlockExec *pBlockExec = peekExecNthFromPut(i);
+            if (pBlock && pBlockExec)
             {
                 if (!headShown)
                 {
                     pBlock->debugShowBlkHead();
                     headShown = true;
                 }
-                pBlock->debugShowBlock(elIdx++, axesParams);
+                pBlock->debugShowBlock(elIdx++, axesParams, *pBlockExec);
             }
         }
     }
@@ -148,7 +221,8 @@ class MotionPipeline
         if (cnt == 0)
             return;
         MotionBlock *pBlock = peekNthFromPut(cnt-1);
-        if (pBlock)
-            pBlock->debugShowBlock(0, axesParams);
+        MotionBlockExec *pBlockExec = peekExecNthFromPut(cnt-1);
+        if (pBlock && pBlockExec)
+            pBlock->debugShowBlock(0, axesParams, *pBlockExec);
     }
 };
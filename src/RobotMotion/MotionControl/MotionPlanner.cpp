@@ -3,9 +3,10 @@
 
 #include "MotionPlanner.h"
 
-void MotionPlanner::configure(float junctionDeviation)
+void MotionPlanner::configure(float junctionDeviation, bool jerkLimited)
 {
     _junctionDeviation = junctionDeviation;
+    _jerkLimited = jerkLimited;
 }
 
 // Entry point for adding a motion block
@@ -14,14 +15,6 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
             AxisPosition &curAxisPositions,
             AxesParams &axesParams, MotionPipeline &motionPipeline)
 {
-    // Find first primary axis
-    int firstPrimaryAxis = -1;
-    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
-        if (axesParams.isPrimaryAxis(axisIdx))
-            firstPrimaryAxis = axisIdx;
-    if (firstPrimaryAxis == -1)
-        firstPrimaryAxis = 0;
-
     // Find axis deltas and sum of squares of motion on primary axes
     float deltas[RobotConsts::MAX_AXES];
     bool isAMove = false;
@@ -53,24 +46,25 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
 
     // Create a block for this movement which will end up on the pipeline
     MotionBlock block;
+    MotionBlockExec blockExec;
 
     // Set flag to indicate if more moves coming
     block._blockIsFollowed = args.getMoreMovesComing();
 
     // set end-stop check requirements
-    block.setEndStopsToCheck(args.getEndstopCheck());
+    blockExec.setEndStopsToCheck(args.getEndstopCheck());
 
     // Set numbered command index if present
-    block.setNumberedCommandIndex(args.getNumberedCommandIndex());
+    blockExec.setNumberedCommandIndex(args.getNumberedCommandIndex());
 
     // Max speed (may be overridden downwards by feedrate)
     float validFeedrateMMps = 1e8;
     if (args.isFeedrateValid())
         validFeedrateMMps = args.getFeedrate();
 
-    // Check the feedrate against the first primary axis
-    if (validFeedrateMMps > axesParams.getMaxSpeed(firstPrimaryAxis))
-        validFeedrateMMps = axesParams.getMaxSpeed(firstPrimaryAxis);
+    // Check the feedrate against the path limit (each axis is checked below)
+    if (validFeedrateMMps > axesParams._pathMaxSpeedMMps)
+        validFeedrateMMps = axesParams._pathMaxSpeedMMps;
 
     // Find the unit vectors for the primary axes and check the feedrate
     AxisFloats unitVectors;
@@ -83,12 +77,14 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
         }
     }
 
-    // Store values in the block
-    block._feedrate = validFeedrateMMps;
-    block._moveDistPrimaryAxesMM = moveDist;
-
     // Find if there are any steps
+    // The actuators move in proportion throughout the block so the speed and acceleration along the
+    // path are also limited by each actuator's own speed, step rate and acceleration (this matters for
+    // robots like the rotary sand table where the relationship between mm and steps varies with position)
+    // An axis's maxAcc is applied through its step acceleration (which defaults to maxAcc in steps)
     bool hasSteps = false;
+    float blockAccMMps2 = axesParams._pathMaxAccMMps2;
+    AxisFloats actuatorStepsPerMM;
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
     {
         // Check if any steps to perform
@@ -97,14 +93,31 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
         if (steps != 0)
             hasSteps = true;
         // Value (and direction)
-        block.setStepsToTarget(axisIdx, steps);
+        blockExec.setStepsToTarget(axisIdx, steps);
+
+        // Actuator limits
+        float stepsPerMM = steps / moveDist;
+        actuatorStepsPerMM._pt[axisIdx] = stepsPerMM;
+        if (steps != 0)
+        {
+            float absStepsPerMM = fabsf(stepsPerMM);
+            validFeedrateMMps = fminf(validFeedrateMMps, axesParams.getMaxStepRatePerSec(axisIdx) / absStepsPerMM);
+            validFeedrateMMps = fminf(validFeedrateMMps,
+                        axesParams.getMaxSpeed(axisIdx) * axesParams.getStepsPerUnit(axisIdx) / absStepsPerMM);
+            blockAccMMps2 = fminf(blockAccMMps2, axesParams.getMaxAccStepsPerSec2(axisIdx) / absStepsPerMM);
+        }
     }
 
+    // Store values in the block
+    block._feedrate = validFeedrateMMps;
+    block._moveDistPrimaryAxesMM = moveDist;
+    block._accMMps2 = blockAccMMps2;
+
 #ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
     Log.notice("F %F D %F uX %F uY %F, uZ %F maxStAx %d maxDAx %d %s\n", validFeedrateMMps,
             moveDist, 
             unitVectors.getVal(0), unitVectors.getVal(1), unitVectors.getVal(2), 
-            block._axisIdxWithMaxSteps, axisWithMaxMoveDist,
+            blockExec._axisIdxWithMaxSteps, axisWithMaxMoveDist,
             hasSteps ? "has steps" : "NO STEPS");
 #endif
 
@@ -112,9 +125,6 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
     if (!hasSteps)
         return false;
 
-    // Set the dist moved on the axis with max steps
-    block._unitVecAxisWithMaxDist = unitVectors.getVal(axisWithMaxMoveDist);
-
     // If there is a prior block then compute the maximum speed at exit of the second block to keep
     // the junction deviation within bounds - there are more comments in the Smoothieware (and GRBL) code
     float junctionDeviation = _junctionDeviation;
@@ -141,11 +151,24 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
                 // Skip and avoid divide by zero for straight junctions at 180 degrees. Limit to min() of nominal speeds.
                 if (cosTheta > -0.95F)
                 {
+                    // The acceleration around the junction is limited by each actuator - the change in
+                    // actuator step rate for each unit of velocity change in the direction of the junction
+                    // is the change in steps per mm divided by the length of the unit vector difference
+                    float junctionAccMMps2 = axesParams._pathMaxAccMMps2;
+                    float unitVecDiff = sqrtf(2.0F + 2.0F * cosTheta);
+                    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+                    {
+                        float stepsPerMMChange = fabsf(actuatorStepsPerMM._pt[axisIdx] - _prevMotionBlock._actuatorStepsPerMM._pt[axisIdx]);
+                        if (stepsPerMMChange > 0)
+                            junctionAccMMps2 = fminf(junctionAccMMps2,
+                                        axesParams.getMaxAccStepsPerSec2(axisIdx) * unitVecDiff / stepsPerMMChange);
+                    }
+
                     // Compute maximum junction velocity based on maximum acceleration and junction deviation
                     // Trig half angle identity, always positive
                     float sinThetaD2 = sqrtf(0.5F * (1.0F - cosTheta));
                     vmaxJunction = fminf(vmaxJunction,
-                                            sqrtf(axesParams._masterAxisMaxAccMMps2 * junctionDeviation * sinThetaD2 /
+                                            sqrtf(junctionAccMMps2 * junctionDeviation * sinThetaD2 /
                                                 (1.0F - sinThetaD2)));
                 }
             }
@@ -159,10 +182,11 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
 #endif
 
     // Add the element to the pipeline and remember previous element
-    motionPipeline.add(block);
+    motionPipeline.add(block, blockExec);
     MotionBlockSequentialData prevBlockInfo;
     prevBlockInfo._maxParamSpeedMMps = block._feedrate;
     prevBlockInfo._unitVectors = unitVectors;
+    prevBlockInfo._actuatorStepsPerMM = actuatorStepsPerMM;
     _prevMotionBlock = prevBlockInfo;
     _prevMotionBlockValid = true;
 
@@ -171,8 +195,7 @@ bool MotionPlanner::moveTo(RobotCommandArgs &args,
 
     // Return the change in actuator position
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
-        curAxisPositions._stepsFromHome.setVal(axisIdx,
-                    curAxisPositions._stepsFromHome.getVal(axisIdx) + block.getStepsToTarget(axisIdx));
+        curAxisPositions.addSteps(axisIdx, blockExec.getStepsToTarget(axisIdx));
 
     return true;
 }
@@ -196,112 +219,118 @@ void MotionPlanner::debugDumpQueue(const char *comStr, MotionPipeline &motionPip
 
 void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesParams &axesParams)
 {
+    // The pipeline keeps a watermark (the "planned" block) - the entry speed of this block is fixed
+    // and no block before it can be improved so only blocks from the watermark onwards are changed.
     // The last block in the pipe (most recently added) will have zero exit speed
-    // For each block, walking backwards in the queue :
+    // Walk backwards in the queue from the most recent block to the watermark:
     //    We know the desired exit speed so calculate the entry speed using v^2 = u^2 + 2*a*s
-    //    Set the exit speed for the previous block from this entry speed
-    // Then walk forward in the queue starting with the first block that can be changed:
-    //    Set the entry speed from the previous block (or to 0 if none)
-    //    Calculate the max possible exit speed for the block using the same formula as above
-    //    Set the entry speed for the next block using this exit speed
-    // Finally prepare the block for stepper motor actuation
+    //    (blocks already at their max entry speed can't go any faster so are skipped)
+    // Then walk forwards from the watermark:
+    //    Limit the entry speed of the next block to the speed achievable by accelerating through this one
+    //    Move the watermark up to any block which is acceleration limited or at its max entry speed
+    //    as such blocks are optimally planned and can't be improved by adding more blocks
+    //    Set the exit speed of each block from the entry speed of the next
+    // Finally prepare the changed blocks for stepper motor actuation
+    // This keeps the work for each added block bounded rather than proportional to pipeline length
 
 #ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
     Log.notice("^^^^^^^^^^^^^^^^^^^^^^^BEFORE RECALC^^^^^^^^^^^^^^^^^^^^^^^^\n");
     motionPipeline.debugShowBlocks(axesParams);
 #endif
 
-    // Iterate the block queue in backwards time order stopping at the first block that has its recalculateFlag false
-    int blockIdx = 0;
-    int earliestBlockToReprocess = -1;
-    float previousBlockExitSpeed = 0;
+    // The oldest block which can change - executing blocks (which may include blocks the
+    // RampGenerator has started compiling into step segments) can't change and neither
+    // can the entry speed of the block following them
+    int numBlocks = motionPipeline.count();
+    int oldestChangeableIdx = numBlocks - 1;
+    MotionBlockExec *pBlockExec = motionPipeline.peekExecNthFromGet(0);
+    for (int blockIdx = 1; pBlockExec && pBlockExec->_isExecuting; blockIdx++)
+    {
+        oldestChangeableIdx--;
+        pBlockExec = motionPipeline.peekExecNthFromGet(blockIdx);
+    }
+    if (oldestChangeableIdx < 0)
+        return;
+
+    // Get the watermark (checking it hasn't already been executed)
+    int plannedIdx = motionPipeline.getPlannedNthFromPut();
+    if ((plannedIdx < 0) || (plannedIdx > oldestChangeableIdx))
+        plannedIdx = oldestChangeableIdx;
+
+    // Iterate the block queue in backwards time order as far as the watermark
     float followingBlockEntrySpeed = 0;
     MotionBlock *pBlock = NULL;
-    MotionBlock *pFollowingBlock = NULL;
-    while (true)
+    for (int blockIdx = 0; blockIdx < plannedIdx; blockIdx++)
     {
         // Get the block at current index
         pBlock = motionPipeline.peekNthFromPut(blockIdx);
-        if (pBlock == NULL)
-            break;
-
-        // Stop if we don't need to recalculate beyond here or if this block is already executing
-        if (pBlock->_isExecuting)
-        {
-            // Get the exit speed from this executing block to use as the entry speed when going forwards
-            previousBlockExitSpeed = pBlock->_exitSpeedMMps;
+        if (!pBlock)
             break;
-        }
 
-        // If entry speed is already at the maximum entry speed then we can stop here as no further changes are
-        // going to be made by going back further
-        if (pBlock->_entrySpeedMMps == pBlock->_maxEntrySpeedMMps && blockIdx > 1)
+        // Calculate the max speed we can enter the block to be able to slow to the entry speed of the
+        // following block (the most recent block must be able to stop)
+        if ((blockIdx == 0) || (pBlock->_entrySpeedMMps != pBlock->_maxEntrySpeedMMps))
         {
-#ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
-            Log.notice("++++++++++++++++++++++++++++++ Optimizing block %d, prevSpeed %F\n", blockIdx, pBlock->_exitSpeedMMps);
-#endif
-            //Get the exit speed from this block to use as the entry speed when going forwards
-            previousBlockExitSpeed = pBlock->_exitSpeedMMps;
-            break;
+            float maxEntrySpeed = MotionBlock::maxAchievableSpeed(pBlock->_accMMps2,
+                                                                  followingBlockEntrySpeed, pBlock->_moveDistPrimaryAxesMM);
+            pBlock->_entrySpeedMMps = fminf(maxEntrySpeed, pBlock->_maxEntrySpeedMMps);
         }
 
-        // If there was a following block (remember we're working backwards) then now set the entry speed
-        if (pFollowingBlock)
-        {
-            // Assume for now that that whole block will be deceleration and calculate the max speed we can enter to be able to slow
-            // to the exit speed required
-            float maxEntrySpeed = MotionBlock::maxAchievableSpeed(axesParams._masterAxisMaxAccMMps2,
-                                                                    pFollowingBlock->_exitSpeedMMps, pFollowingBlock->_moveDistPrimaryAxesMM);
-            pFollowingBlock->_entrySpeedMMps = fminf(maxEntrySpeed, pFollowingBlock->_maxEntrySpeedMMps);
-
-            // Remember entry speed (to use as exit speed in the next loop)
-            followingBlockEntrySpeed = pFollowingBlock->_entrySpeedMMps;
-        }
-
-        // Remember the following block for the next pass
-        pFollowingBlock = pBlock;
-
-        // Set the block's exit speed to the entry speed of the block after this one
-        pBlock->_exitSpeedMMps = followingBlockEntrySpeed;
-
-        // Remember this as the earliest block to reprocess when going forwards
-        earliestBlockToReprocess = blockIdx;
-
-        // Next
-        blockIdx++;
+        // Remember entry speed (to use as exit speed in the next loop)
+        followingBlockEntrySpeed = pBlock->_entrySpeedMMps;
     }
 
-    // Now iterate in forward time order
-    for (blockIdx = earliestBlockToReprocess; blockIdx >= 0; blockIdx--)
+    // Now iterate in forward time order from the watermark
+    MotionBlock *pPrevBlock = motionPipeline.peekNthFromPut(plannedIdx);
+    if (!pPrevBlock)
+        return;
+    int newPlannedIdx = plannedIdx;
+    for (int blockIdx = plannedIdx - 1; blockIdx >= 0; blockIdx--)
     {
         // Get the block to calculate for
         pBlock = motionPipeline.peekNthFromPut(blockIdx);
         if (!pBlock)
             break;
 
-        // Set the entry speed to the previous block exit speed
-        // if (pBlock->_entrySpeedMMps > previousBlockExitSpeed)
-        pBlock->_entrySpeedMMps = previousBlockExitSpeed;
+        // Limit the entry speed to the speed achievable by accelerating through the previous block
+        if (pPrevBlock->_entrySpeedMMps < pBlock->_entrySpeedMMps)
+        {
+            float maxEntrySpeed = MotionBlock::maxAchievableSpeed(pPrevBlock->_accMMps2,
+                                                                  pPrevBlock->_entrySpeedMMps, pPrevBlock->_moveDistPrimaryAxesMM);
+            if (maxEntrySpeed < pBlock->_entrySpeedMMps)
+            {
+                pBlock->_entrySpeedMMps = maxEntrySpeed;
+                newPlannedIdx = blockIdx;
+            }
+        }
 
-        // Calculate maximum speed possible for the block - based on acceleration at the best rate
-        float maxExitSpeed = pBlock->maxAchievableSpeed(axesParams._masterAxisMaxAccMMps2,
-                                                        pBlock->_entrySpeedMMps, pBlock->_moveDistPrimaryAxesMM);
-        pBlock->_exitSpeedMMps = fminf(maxExitSpeed, pBlock->_exitSpeedMMps);
+        // A block at its max entry speed is also optimal
+        if (pBlock->_entrySpeedMMps == pBlock->_maxEntrySpeedMMps)
+            newPlannedIdx = blockIdx;
 
-        // Remember for next block
-        previousBlockExitSpeed = pBlock->_exitSpeedMMps;
+        // Previous block exits at the entry speed of this one
+        pPrevBlock->_exitSpeedMMps = pBlock->_entrySpeedMMps;
+        pPrevBlock = pBlock;
     }
 
-    // Recalculate acceleration and deceleration curves
-    for (blockIdx = earliestBlockToReprocess; blockIdx >= 0; blockIdx--)
+    // The most recent block comes to a stop
+    pPrevBlock->_exitSpeedMMps = 0;
+
+    // Recalculate acceleration and deceleration curves for the blocks that may have changed
+    for (int blockIdx = plannedIdx; blockIdx >= 0; blockIdx--)
     {
         // Get the block to calculate for
         pBlock = motionPipeline.peekNthFromPut(blockIdx);
-        if (!pBlock)
+        pBlockExec = motionPipeline.peekExecNthFromPut(blockIdx);
+        if (!pBlock || !pBlockExec)
             break;
 
+        // The executing block must not be changed
+        if (pBlockExec->_isExecuting)
+            continue;
+
         // Prepare this block for stepping
-        if (pBlock->prepareForStepping(axesParams, false))
+        if (pBlock->prepareForStepping(axesParams, false, *pBlockExec, _jerkLimited))
         {
             // Check if the block is part of a split block and has at least one more block following it
             // in which case wait until at least two blocks are in the pipeline before locking down the
@@ -309,11 +338,14 @@ void MotionPlanner::recalculatePipeline(MotionPipeline &motionPipeline, AxesPara
             if ((!pBlock->_blockIsFollowed) || (motionPipeline.count() > 1))
             {
                 // No more changes
-                pBlock->_canExecute = true;
+                pBlockExec->_canExecute = true;
             }
         }
     }
 
+    // Update the watermark
+    motionPipeline.setPlannedNthFromPut(newPlannedIdx);
+
 #ifdef DEBUG_MOTIONPLANNER_DETAILED_INFO
     Log.notice(".................AFTER RECALC.......................\n");
     motionPipeline.debugShowBlocks(axesParams);
@@ -329,6 +361,7 @@ bool MotionPlanner::moveToStepwise(RobotCommandArgs &args,
 {
     // Create a block for this movement which will end up on the pipeline
     MotionBlock block;
+    MotionBlockExec blockExec;
     block._entrySpeedMMps = 0;
     block._exitSpeedMMps = 0;
 
@@ -355,21 +388,18 @@ bool MotionPlanner::moveToStepwise(RobotCommandArgs &args,
                 minFeedrateStepsPerSec = axesParams.getMaxStepRatePerSec(axisIdx);
         }
         // Value (and direction)
-        block.setStepsToTarget(axisIdx, steps);
+        blockExec.setStepsToTarget(axisIdx, steps);
     }
 
     // Check there are some actual steps
     if (!hasSteps)
         return false;
 
-    // Set unit vector
-    block._unitVecAxisWithMaxDist = 1.0;
-
     // set end-stop check requirements
-    block.setEndStopsToCheck(args.getEndstopCheck());
+    blockExec.setEndStopsToCheck(args.getEndstopCheck());
 
     // Set numbered command index if present
-    block.setNumberedCommandIndex(args.getNumberedCommandIndex());
+    blockExec.setNumberedCommandIndex(args.getNumberedCommandIndex());
 
     // feedrate override?
     if (args.isFeedrateValid())
@@ -377,20 +407,24 @@ bool MotionPlanner::moveToStepwise(RobotCommandArgs &args,
     block._feedrate = minFeedrateStepsPerSec;
 
     // Prepare for stepping
-    if (block.prepareForStepping(axesParams, true))
+    if (block.prepareForStepping(axesParams, true, blockExec))
     {
         // No more changes
-        block._canExecute = true;
+        blockExec._canExecute = true;
     }
 
     // Add the block
-    motionPipeline.add(block);
-    _prevMotionBlockValid = true;
+    motionPipeline.add(block, blockExec);
+
+    // The block ends at rest so there is no junction with the next block
+    _prevMotionBlockValid = false;
+
+    // Stepwise blocks start and end at rest so the planner must not change this (or earlier) blocks
+    motionPipeline.setPlannedNthFromPut(-1);
 
     // Return the change in actuator position
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
-        curAxisPositions._stepsFromHome.setVal(axisIdx,
-            curAxisPositions._stepsFromHome.getVal(axisIdx) + block.getStepsToTarget(axisIdx));
+        curAxisPositions.addSteps(axisIdx, blockExec.getStepsToTarget(axisIdx));
 
 #ifdef DEBUG_MOTIONPLANNER_INFO
     Log.notice("^^^^^^^^^^^^^^^^^^^^^^^STEPWISE^^^^^^^^^^^^^^^^^^^^^^^^\n");
@@ -18,6 +18,9 @@ typedef void (*actuatorToPtFnType)(AxisInt32s &targetActuator, AxisFloats &outPt
 typedef void (*correctStepOverflowFnType)(AxisPosition &curPos, AxesParams &axesParams);
 typedef void (*convertCoordsFnType)(RobotCommandArgs& cmdArgs, AxesParams &axesParams);
 typedef void (*setRobotAttributesFnType)(AxesParams& axesParams, String& robotAttributes);
+typedef bool (*polarToActuatorFnType)(AxisFloats &targetPolar, AxisFloats &outActuator, AxisFloats &outPt, AxisPosition &curPos, AxesParams &axesParams, bool allowOutOfBounds);
+typedef void (*actuatorToPolarFnType)(AxisInt32s &targetActuator, AxisFloats &outPolar, AxesParams &axesParams);
+typedef bool (*ptsToActuatorFnType)(const float* const ptAxes[], float* const outActuatorAxes[], int numPts, AxisPosition &curPos, AxesParams &axesParams, bool allowOutOfBounds);
 
 class MotionPlanner
 {
@@ -26,12 +29,16 @@ class MotionPlanner
     float _minimumPlannerSpeedMMps;
     // Junction deviation
     float _junctionDeviation;
+    // Use jerk-limited (S-curve) velocity profiles
+    bool _jerkLimited;
 
     // Structure to store details on last processed block
     struct MotionBlockSequentialData
     {
         AxisFloats _unitVectors;
-        float _maxParamSpeedMMps;
+        // Actuator steps per mm travelled (signed) - direction of the block in joint space
+        AxisFloats _actuatorStepsPerMM;
+        float _maxParamSpeedMMps = 0;
     };
     // Data on previously processed block
     bool _prevMotionBlockValid;
@@ -44,9 +51,10 @@ class MotionPlanner
         _minimumPlannerSpeedMMps = 0;
         // Configure the motion pipeline - these values will be changed in config
         _junctionDeviation = 0;
+        _jerkLimited = false;
     }
 
-    void configure(float junctionDeviation);
+    void configure(float junctionDeviation, bool jerkLimited);
 
     // Entry point for adding a motion block
     bool moveTo(RobotCommandArgs &args,
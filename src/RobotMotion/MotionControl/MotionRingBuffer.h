@@ -1,75 +1,147 @@
 #pragma once
 
+#include <atomic>
+
 // Generic interrupt-safe ring buffer pointer class
-// Each pointer is only updated by one source (ISR or main thread)
+// This is a single-producer, single-consumer ring - the put position is only updated by the producer
+// (e.g. main thread) and the get position only by the consumer (e.g. ISR). Positions count continuously
+// and are masked to index the buffer (the length of which is a power of two). An element is published
+// (release) by the producer after it is written and released by the consumer after it is used so each
+// side sees the other's data complete even when running on a different core
+//
+// Clearing from a running system uses a flush protocol as neither side may change the other's position:
+//   requestFlush() - any context - requests that all elements are discarded
+//   consumerFlush() - consumer - discards all elements while a flush is pending
+//   producerFlushAck() - producer - completes the flush once the buffer is empty (the producer must
+//                        reset any state relating to the discarded elements before calling this)
+// canPut() is false while a flush is pending so elements put before the producer has seen the request
+// are discarded by the consumer
 class MotionRingBufferPosn
 {
-  public:
-    volatile unsigned int _putPos;
-    volatile unsigned int _getPos;
+  private:
+    std::atomic<unsigned int> _putPos;
+    std::atomic<unsigned int> _getPos;
     unsigned int _bufLen;
+    unsigned int _bufMask;
+    std::atomic<unsigned int> _flushRequests;
+    std::atomic<unsigned int> _flushAcks;
 
+  public:
     MotionRingBufferPosn(int maxLen)
     {
         init(maxLen);
     }
 
+    // Length is rounded up to a power of two
     void init(int maxLen)
     {
-        _bufLen = maxLen;
-        _putPos = 0;
-        _getPos = 0;
+        _bufLen = 0;
+        if (maxLen > 0)
+        {
+            _bufLen = 1;
+            while (_bufLen < (unsigned int)maxLen)
+                _bufLen <<= 1;
+        }
+        _bufMask = _bufLen - 1;
+        _flushRequests.store(0, std::memory_order_relaxed);
+        clear();
     }
 
+    // Buffer length (which elements are indexed into)
+    unsigned int size()
+    {
+        return _bufLen;
+    }
+
+    // Reset - only valid when neither producer nor consumer is active
     void clear()
     {
-        _getPos = _putPos = 0;
+        _getPos.store(0, std::memory_order_relaxed);
+        _putPos.store(0, std::memory_order_relaxed);
+        _flushAcks.store(_flushRequests.load(std::memory_order_relaxed), std::memory_order_release);
     }
+
     bool canPut()
     {
         if (_bufLen == 0)
             return false;
-        if (_putPos == _getPos)
-            return true;
-        unsigned int gp = _getPos;
-        if (_putPos > gp)
-        {
-            if ((_putPos != _bufLen - 1) || (gp != 0))
-                return true;
-        }
-        else
-        {
-            if (gp - _putPos > 1)
-                return true;
-        }
-        return false;
+        if (isFlushPending())
+            return false;
+        return _putPos.load(std::memory_order_relaxed) - _getPos.load(std::memory_order_acquire) < _bufLen;
     }
 
     bool IRAM_ATTR canGet()
     {
-        return _putPos != _getPos;
+        return _putPos.load(std::memory_order_acquire) != _getPos.load(std::memory_order_acquire);
     }
 
+    // Index of element to put (producer)
+    unsigned int putIdx()
+    {
+        return _putPos.load(std::memory_order_relaxed) & _bufMask;
+    }
+
+    // Index of element to get
+    unsigned int IRAM_ATTR getIdx()
+    {
+        return _getPos.load(std::memory_order_acquire) & _bufMask;
+    }
+
+    // Position (unmasked) of element to put
+    unsigned int putPos()
+    {
+        return _putPos.load(std::memory_order_acquire);
+    }
+
+    // Publish the element written at putIdx() (producer)
     void hasPut()
     {
-        _putPos++;
-        if (_putPos >= _bufLen)
-            _putPos = 0;
+        _putPos.store(_putPos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
 
+    // Release the element at getIdx() (consumer)
     void IRAM_ATTR hasGot()
     {
-        _getPos++;
-        if (_getPos >= _bufLen)
-            _getPos = 0;
+        _getPos.store(_getPos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
     }
 
     unsigned int count()
     {
-        unsigned int getPos = _getPos;
-        if (getPos <= _putPos)
-            return _putPos - getPos;
-        return _bufLen - getPos + _putPos;
+        unsigned int getPos = _getPos.load(std::memory_order_acquire);
+        return _putPos.load(std::memory_order_acquire) - getPos;
+    }
+
+    // Request a flush (any context)
+    void IRAM_ATTR requestFlush()
+    {
+        _flushRequests.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    bool IRAM_ATTR isFlushPending()
+    {
+        return _flushAcks.load(std::memory_order_acquire) != _flushRequests.load(std::memory_order_acquire);
+    }
+
+    // Discard all elements if a flush is pending (consumer) - returns true if flushing
+    bool IRAM_ATTR consumerFlush()
+    {
+        if (!isFlushPending())
+            return false;
+        _getPos.store(_putPos.load(std::memory_order_acquire), std::memory_order_release);
+        return true;
+    }
+
+    // Complete a pending flush when the consumer has emptied the buffer (producer) - returns
+    // true if no flush is pending on return
+    bool producerFlushAck()
+    {
+        unsigned int flushRequests = _flushRequests.load(std::memory_order_acquire);
+        if (_flushAcks.load(std::memory_order_relaxed) == flushRequests)
+            return true;
+        if (canGet())
+            return false;
+        _flushAcks.store(flushRequests, std::memory_order_release);
+        return true;
     }
 
     // Get Nth element prior to the put position
@@ -78,16 +150,9 @@ class MotionRingBufferPosn
     // Returns -1 if invalid
     int getNthFromPut(unsigned int N)
     {
-        if (!canGet())
-            return -1;
-        if (N >= _bufLen)
-            return -1;
-        int nthPos = _putPos - 1 - N;
-        if (nthPos < 0)
-            nthPos += _bufLen;
-        if (((unsigned int)(nthPos + 1) == _getPos) || ((unsigned int)(nthPos + 1) == _bufLen && _getPos == 0))
+        if (N >= count())
             return -1;
-        return nthPos;
+        return (_putPos.load(std::memory_order_relaxed) - 1 - N) & _bufMask;
     }
 
     // Get Nth element from the get position
@@ -96,15 +161,9 @@ class MotionRingBufferPosn
     // returns -1 if invalid
     int getNthFromGet(unsigned int N)
     {
-        if (!canGet())
-            return -1;
-        if (N >= _bufLen)
-            return -1;
-        unsigned int nthPos = _getPos + N;
-        if (nthPos >= _bufLen)
-            nthPos -= _bufLen;
-        if (nthPos == _putPos)
+        unsigned int getPos = _getPos.load(std::memory_order_acquire);
+        if (N >= _putPos.load(std::memory_order_acquire) - getPos)
             return -1;
-        return nthPos;
+        return (getPos + N) & _bufMask;
     }
 };
@@ -0,0 +1,89 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef ESP32
+#include "soc/gpio_struct.h"
+#endif
+
+// End-stop pins to check while a block is executing
+// The pins are gathered into a mask (and the level which indicates a hit) for each bank of input
+// pins when a block is setup so the ISR can test all end-stops with one register read per bank
+class EndStopPinMask
+{
+private:
+    // Pins are grouped in banks of 32 (on the ESP32 GPIO0..31 and GPIO32..39)
+    static constexpr int NUM_BANKS = 2;
+    static constexpr int PINS_PER_BANK = 32;
+    uint32_t _pinMask[NUM_BANKS];
+    uint32_t _hitLevels[NUM_BANKS];
+    bool _anyPins;
+
+public:
+    EndStopPinMask()
+    {
+        clear();
+    }
+
+    // Remove all pins
+    void IRAM_ATTR clear()
+    {
+        for (int bankIdx = 0; bankIdx < NUM_BANKS; bankIdx++)
+        {
+            _pinMask[bankIdx] = 0;
+            _hitLevels[bankIdx] = 0;
+        }
+        _anyPins = false;
+    }
+
+    // Add a pin to check - the end-stop is hit when the pin reads hitLevel
+    void IRAM_ATTR add(int pin, bool hitLevel)
+    {
+        if ((pin < 0) || (pin >= NUM_BANKS * PINS_PER_BANK))
+            return;
+        uint32_t pinMask = 1ul << (pin % PINS_PER_BANK);
+        int bankIdx = pin / PINS_PER_BANK;
+        _pinMask[bankIdx] |= pinMask;
+        if (hitLevel)
+            _hitLevels[bankIdx] |= pinMask;
+        else
+            _hitLevels[bankIdx] &= ~pinMask;
+        _anyPins = true;
+    }
+
+    // Check if there are any pins to check
+    bool IRAM_ATTR any()
+    {
+        return _anyPins;
+    }
+
+    // Check if any end-stop is hit
+    bool IRAM_ATTR isHit()
+    {
+        if (!_anyPins)
+            return false;
+#ifdef ESP32
+        if (_pinMask[0] && (~(GPIO.in ^ _hitLevels[0]) & _pinMask[0]))
+            return true;
+        if (_pinMask[1] && (~(GPIO.in1.val ^ _hitLevels[1]) & _pinMask[1]))
+            return true;
+#else
+        // Other platforms read each pin
+        for (int bankIdx = 0; bankIdx < NUM_BANKS; bankIdx++)
+        {
+            for (int bitIdx = 0; (bitIdx < PINS_PER_BANK) && (_pinMask[bankIdx] >> bitIdx); bitIdx++)
+            {
+                if (!(_pinMask[bankIdx] & (1ul << bitIdx)))
+                    continue;
+                bool hitLevel = _hitLevels[bankIdx] & (1ul << bitIdx);
+                if ((digitalRead(bankIdx * PINS_PER_BANK + bitIdx) != 0) == hitLevel)
+                    return true;
+            }
+        }
+#endif
+        return false;
+    }
+};
@@ -0,0 +1,177 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+#ifdef ESP32
+#include "xtensa/core-macros.h"
+#endif
+
+// Timing statistics for the motion ISR
+// The duration of each ISR call is measured with the CPU cycle counter and recorded in a histogram
+// (1us buckets) and as the worst case for the code path taken - the path is the most significant
+// thing the call did (e.g. starting a new block). An overrun is a call which took longer than the
+// interval to the next call
+// Statistics are only written by the ISR (a reset is requested and done on the next ISR call) so
+// values read elsewhere may be from different ISR calls but each is valid
+class MotionISRStats
+{
+public:
+    // Code paths in order of significance
+    enum ISRPath
+    {
+        ISR_PATH_IDLE,
+        ISR_PATH_MOVING,
+        ISR_PATH_SUB_STEP,
+        ISR_PATH_STEP,
+        ISR_PATH_NEW_BLOCK,
+        ISR_PATH_END_STOP,
+        ISR_PATH_CLEARING,
+        ISR_PATH_NUM
+    };
+    static constexpr int HISTOGRAM_BUCKETS = 32;
+
+private:
+    bool _enabled;
+    volatile bool _resetRequested;
+    uint32_t _cyclesPerUs;
+    uint32_t _cyclesPerTick;
+
+    // Current call
+    uint32_t _startCycles;
+    ISRPath _curPath;
+
+    // Statistics
+    uint32_t _histogram[HISTOGRAM_BUCKETS];
+    uint32_t _pathCount[ISR_PATH_NUM];
+    uint32_t _pathMaxCycles[ISR_PATH_NUM];
+    uint32_t _callCount;
+    uint64_t _totalCycles;
+    uint32_t _overrunCount;
+
+public:
+    MotionISRStats()
+    {
+        _enabled = false;
+        _resetRequested = false;
+        _cyclesPerUs = 1;
+        _cyclesPerTick = 1;
+        _startCycles = 0;
+        _curPath = ISR_PATH_IDLE;
+        clear();
+    }
+
+    // Configure (when the ISR isn't running)
+    void configure(bool enabled, uint32_t tickIntervalNs)
+    {
+        _enabled = enabled;
+#ifdef ESP32
+        _cyclesPerUs = getCpuFrequencyMhz();
+#else
+        _cyclesPerUs = 1;
+#endif
+        _cyclesPerTick = std::max(_cyclesPerUs * tickIntervalNs / 1000, (uint32_t)1);
+        clear();
+    }
+
+    bool isEnabled()
+    {
+        return _enabled;
+    }
+
+    // Request a reset of the statistics (done on the next ISR call)
+    void requestReset()
+    {
+        _resetRequested = true;
+    }
+
+    // Start of ISR call
+    void IRAM_ATTR start()
+    {
+        if (!_enabled)
+            return;
+        if (_resetRequested)
+        {
+            clear();
+            _resetRequested = false;
+        }
+        _curPath = ISR_PATH_IDLE;
+        _startCycles = cycleCount();
+    }
+
+    // Note a code path taken in this call - the most significant is recorded
+    void IRAM_ATTR notePath(ISRPath path)
+    {
+        if (path > _curPath)
+            _curPath = path;
+    }
+
+    // End of ISR call - intervalTicks is the time until the next call
+    void IRAM_ATTR end(uint32_t intervalTicks)
+    {
+        if (!_enabled)
+            return;
+        uint32_t cycles = cycleCount() - _startCycles;
+        uint32_t bucketIdx = std::min(cycles / _cyclesPerUs, (uint32_t)(HISTOGRAM_BUCKETS - 1));
+        _histogram[bucketIdx]++;
+        _pathCount[_curPath]++;
+        if (cycles > _pathMaxCycles[_curPath])
+            _pathMaxCycles[_curPath] = cycles;
+        _callCount++;
+        _totalCycles += cycles;
+        if (cycles > intervalTicks * _cyclesPerTick)
+            _overrunCount++;
+    }
+
+    // Statistics as JSON (times in us)
+    String toJSON()
+    {
+        static const char *pathNames[ISR_PATH_NUM] = {"idle", "moving", "subStep", "step", "newBlock", "endStop", "clearing"};
+        String jsonStr = "{\"enabled\":" + String(_enabled ? 1 : 0);
+        jsonStr += ",\"calls\":" + String(_callCount);
+        jsonStr += ",\"meanUs\":" + String(_callCount ? (float)(_totalCycles / _callCount) / _cyclesPerUs : 0.0f, 2);
+        jsonStr += ",\"overruns\":" + String(_overrunCount);
+        jsonStr += ",\"paths\":{";
+        for (int pathIdx = 0; pathIdx < ISR_PATH_NUM; pathIdx++)
+        {
+            if (pathIdx != 0)
+                jsonStr += ",";
+            jsonStr += "\"" + String(pathNames[pathIdx]) + "\":{\"n\":" + String(_pathCount[pathIdx]) +
+                        ",\"maxUs\":" + String((float)_pathMaxCycles[pathIdx] / _cyclesPerUs, 2) + "}";
+        }
+        jsonStr += "},\"histUs\":[";
+        for (int bucketIdx = 0; bucketIdx < HISTOGRAM_BUCKETS; bucketIdx++)
+        {
+            if (bucketIdx != 0)
+                jsonStr += ",";
+            jsonStr += String(_histogram[bucketIdx]);
+        }
+        jsonStr += "]}";
+        return jsonStr;
+    }
+
+private:
+    void IRAM_ATTR clear()
+    {
+        for (int bucketIdx = 0; bucketIdx < HISTOGRAM_BUCKETS; bucketIdx++)
+            _histogram[bucketIdx] = 0;
+        for (int pathIdx = 0; pathIdx < ISR_PATH_NUM; pathIdx++)
+        {
+            _pathCount[pathIdx] = 0;
+            _pathMaxCycles[pathIdx] = 0;
+        }
+        _callCount = 0;
+        _totalCycles = 0;
+        _overrunCount = 0;
+    }
+
+    static inline uint32_t IRAM_ATTR cycleCount()
+    {
+#ifdef ESP32
+        return XTHAL_GET_CCOUNT();
+#else
+        return micros();
+#endif
+    }
+};
@@ -12,12 +12,15 @@
 #define INSTRUMENT_MOTION_ACTUATOR_OUTPUT 1
 #define SystemTicksPerMicrosecond System.ticksPerMicrosecond()
 #define SystemTicks System.ticks()
-#else
+#elif defined(ESP32)
 //#define INSTRUMENT_MOTION_ACTUATOR_ENABLE    1
 //#define INSTRUMENT_MOTION_ACTUATOR_OUTPUT    1
 #include "xtensa/core-macros.h"
 #define SystemTicksPerMicrosecond XTHAL_GET_CCOUNT()
 #define SystemTicks (10000000)
+#else
+#define SystemTicksPerMicrosecond 1
+#define SystemTicks (micros())
 #endif
 #define INSTRUMENT_MOTION_ACTUATOR_CONFIG "TIMEISR BLINKD7"
 
@@ -37,7 +40,7 @@ static constexpr int INSTRUMENT_OUTPUT_STEPS = 1000;
         _pMotionInstrumentation->stepEnd();
 #define INSTRUMENT_MOTION_ACTUATOR_STEP_DIRN \
     if (_pMotionInstrumentation)          \
-        _pMotionInstrumentation->stepDirn(axisIdx, stepsTotal >= 0);
+        _pMotionInstrumentation->stepDirn(axisIdx, dirnPositive);
 #define INSTRUMENT_MOTION_ACTUATOR_STEP_START(AX_IDX) \
     if (_pMotionInstrumentation)                   \
         _pMotionInstrumentation->stepStart(AX_IDX);
@@ -84,7 +87,7 @@ public:
 
     InstrumentOutputStepData() : _stepBufPos(INSTRUMENT_OUTPUT_STEPS)
     {
-        _stepBuf.resize(INSTRUMENT_OUTPUT_STEPS);
+        _stepBuf.resize(_stepBufPos.size());
     }
 
     void stepStart(int axisIdx)
@@ -112,14 +115,14 @@ public:
             newInf._micros = micros();
             newInf._pin = uint8_t(pin);
             newInf._val = val;
-            _stepBuf[_stepBufPos._putPos] = newInf;
+            _stepBuf[_stepBufPos.putIdx()] = newInf;
             _stepBufPos.hasPut();
         }
     }
 
     TestOutputStepInf getStepInf()
     {
-        TestOutputStepInf inf = _stepBuf[_stepBufPos._getPos];
+        TestOutputStepInf inf = _stepBuf[_stepBufPos.getIdx()];
         _stepBufPos.hasGot();
         return inf;
     }
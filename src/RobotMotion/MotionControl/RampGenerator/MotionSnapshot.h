@@ -0,0 +1,103 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <atomic>
+#include <string.h>
+#include "../MotionBlock.h"
+
+// Snapshot of the state of motion as seen by the ISR
+class MotionSnapshot
+{
+public:
+    // Step position of each actuator
+    int64_t _stepPos[RobotConsts::MAX_AXES];
+    // Steps in the current block (negative for reverse direction) and the axis with max steps
+    int32_t _blockStepsTotal[RobotConsts::MAX_AXES];
+    int _axisIdxWithMaxSteps;
+    // Current step rate (in steps per TTicks) of the axis with max steps - 0 when not moving
+    uint32_t _stepRatePerTTicks;
+    // Count of blocks ended and numbered command index of the current block
+    uint32_t _blocksEnded;
+    int _numberedCmdIdx;
+
+    MotionSnapshot()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        {
+            _stepPos[axisIdx] = 0;
+            _blockStepsTotal[axisIdx] = 0;
+        }
+        _axisIdxWithMaxSteps = 0;
+        _stepRatePerTTicks = 0;
+        _blocksEnded = 0;
+        _numberedCmdIdx = RobotConsts::NUMBERED_COMMAND_NONE;
+    }
+
+    // Step rate of an axis in steps per second (signed by direction)
+    float getStepRatePerSec(int axisIdx)
+    {
+        if ((axisIdx < 0) || (axisIdx >= RobotConsts::MAX_AXES))
+            return 0;
+        int32_t maxSteps = abs(_blockStepsTotal[_axisIdxWithMaxSteps]);
+        if (maxSteps == 0)
+            return 0;
+        float maxStepsPerSec = _stepRatePerTTicks / MotionBlock::TTICKS_PER_STEP_PER_SEC;
+        return maxStepsPerSec * _blockStepsTotal[axisIdx] / maxSteps;
+    }
+};
+
+// Seqlock for the motion snapshot - there is a single writer (the ISR) which never waits and any number
+// of readers which retry if the writer was active while they copied the snapshot
+class MotionSnapshotSeqLock
+{
+private:
+    std::atomic<uint32_t> _seq;
+    MotionSnapshot _snapshot;
+
+    // Number of retries before a reader gives up and returns a possibly inconsistent snapshot - the writer
+    // is only active for a few instructions so this is never expected
+    static constexpr int MAX_READ_RETRIES = 100;
+
+public:
+    MotionSnapshotSeqLock() : _seq(0)
+    {
+    }
+
+    // Start an update (writer) - returns the snapshot to be updated in place
+    MotionSnapshot& IRAM_ATTR writeBegin()
+    {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return _snapshot;
+    }
+
+    // Complete an update (writer)
+    void IRAM_ATTR writeEnd()
+    {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Get a consistent copy of the snapshot (reader) - returns false if the writer was always active
+    bool read(MotionSnapshot& snapshot)
+    {
+        for (int retryIdx = 0; retryIdx < MAX_READ_RETRIES; retryIdx++)
+        {
+            uint32_t seqStart = _seq.load(std::memory_order_acquire);
+            if (seqStart & 1)
+                continue;
+            memcpy(&snapshot, (const void*)&_snapshot, sizeof(MotionSnapshot));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (_seq.load(std::memory_order_relaxed) == seqStart)
+                return true;
+        }
+        memcpy(&snapshot, (const void*)&_snapshot, sizeof(MotionSnapshot));
+        return false;
+    }
+};
@@ -27,6 +27,7 @@ RampGenIO::~RampGenIO()
 
 void RampGenIO::deinit()
 {
+    _stepPinBank.clear();
     // remove motors and end stops
     for (int i = 0; i < RobotConsts::MAX_AXES; i++)
     {
@@ -79,7 +80,7 @@ bool RampGenIO::configureAxis(int axisIdx, const char *axisJSON)
         // Setup stepper
         if ((stepPin >= 0) && ((dirnPin >= 0) || (muxPin1 >= 0)))
             _stepperMotors[axisIdx] = new StepperMotor(RobotConsts::MOTOR_TYPE_DRIVER, stepPin, dirnPin, 
-                                muxPin1, muxPin2, muxPin3, muxDirnIdx, directionReversed);
+                                muxPin1, muxPin2, muxPin3, muxDirnIdx, directionReversed, &_stepPinBank);
     }
 
     // End stops
@@ -248,6 +249,12 @@ void IRAM_ATTR RampGenIO::stepStart(int axisIdx)
         pStepper->stepStart();
 }
 
+// Apply step and direction pin changes made since the last call
+void IRAM_ATTR RampGenIO::applyPinChanges()
+{
+    _stepPinBank.apply();
+}
+
 bool IRAM_ATTR RampGenIO::stepEnd(int axisIdx)
 {
     StepperMotor* pStepper = _stepperMotors[axisIdx];
@@ -5,6 +5,7 @@
 
 #include <time.h>
 #include "RobotConsts.h"
+#include "StepPinBank.h"
 
 #ifndef SPARK
 //#define BOUNDS_CHECK_ISR_FUNCTIONS    1
@@ -21,6 +22,8 @@ private:
     StepperMotor* _stepperMotors[RobotConsts::MAX_AXES];
     // End stops
     EndStop* _endStops[RobotConsts::MAX_AXES][RobotConsts::MAX_ENDSTOPS_PER_AXIS];
+    // Step and direction pins
+    StepPinBank _stepPinBank;
 
 public:
     RampGenIO();
@@ -54,6 +57,7 @@ public:
     void setDirection(int axisIdx, bool direction);
     void stepStart(int axisIdx);
     bool stepEnd(int axisIdx);
+    void applyPinChanges();
 
 // private:
 
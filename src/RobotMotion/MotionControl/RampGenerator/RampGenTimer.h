@@ -0,0 +1,83 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+
+// Timer used to call the RampGenerator ISR
+// The period can be changed from within the ISR to schedule the next call so that the interrupt
+// rate follows the step rate - a fake implementation can be used to drive the ISR in virtual time
+class RampGenTimer
+{
+public:
+    virtual ~RampGenTimer()
+    {
+    }
+
+    // Start calling isrFn every periodUs
+    virtual bool start(void (*isrFn)(), uint32_t periodUs) = 0;
+
+    // Stop calling
+    virtual void stop() = 0;
+
+    // Set the period until the next call (and subsequent calls) - can be called from the ISR
+    virtual void setPeriodUs(uint32_t periodUs) = 0;
+};
+
+#ifdef ESP32
+
+// ESP32 hardware timer
+class RampGenTimerESP32 : public RampGenTimer
+{
+private:
+    hw_timer_t *_isrMotionTimer;
+    bool _isrTimerStarted;
+    // Timer prescaler to count in uS
+    static constexpr uint32_t CLOCK_RATE_MHZ = 80;
+
+public:
+    RampGenTimerESP32()
+    {
+        _isrMotionTimer = NULL;
+        _isrTimerStarted = false;
+    }
+
+    virtual ~RampGenTimerESP32()
+    {
+        stop();
+    }
+
+    virtual bool start(void (*isrFn)(), uint32_t periodUs)
+    {
+        if (!_isrMotionTimer)
+        {
+            _isrMotionTimer = timerBegin(0, CLOCK_RATE_MHZ, true);
+            if (!_isrMotionTimer)
+                return false;
+            timerAttachInterrupt(_isrMotionTimer, isrFn, true);
+        }
+        timerAlarmWrite(_isrMotionTimer, periodUs, true);
+        timerAlarmEnable(_isrMotionTimer);
+        _isrTimerStarted = true;
+        return true;
+    }
+
+    virtual void stop()
+    {
+        if (_isrTimerStarted)
+        {
+            timerAlarmDisable(_isrMotionTimer);
+            _isrTimerStarted = false;
+        }
+    }
+
+    // The alarm auto-reloads (resetting the count to zero) so the new value sets the time
+    // until the next call
+    virtual void IRAM_ATTR setPeriodUs(uint32_t periodUs)
+    {
+        timerAlarmWrite(_isrMotionTimer, periodUs, true);
+    }
+};
+
+#endif
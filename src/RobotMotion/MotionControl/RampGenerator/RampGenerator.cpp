@@ -5,8 +5,6 @@
 #include "MotionInstrumentation.h"
 #include "../MotionPipeline.h"
 
-//#define USE_FAST_PIN_ACCESS 1
-
 // Instrumentation of motion actuator
 INSTRUMENT_MOTION_ACTUATOR_INSTANCE
 
@@ -32,15 +30,13 @@ INSTRUMENT_MOTION_ACTUATOR_INSTANCE
 // uint32_t RampGenerator::_curAccumulatorStep = 0;
 // uint32_t RampGenerator::_curAccumulatorNS = 0;
 // uint32_t RampGenerator::_curAccumulatorRelative[RobotConsts::MAX_AXES];
-// int RampGenerator::_endStopCheckNum;
-// RampGenerator::EndStopChecks RampGenerator::_endStopChecks[RobotConsts::MAX_AXES];
 // bool RampGenerator::_isrTimerStarted = false;
 // RampGenIO* RampGenerator::_pMotionIO = NULL;
 // bool RampGenerator::_rampGenEnabled = false;
 
 RampGenerator* RampGenerator::_pThis = NULL;
 
-RampGenerator::RampGenerator(MotionPipeline* pMotionPipeline)
+RampGenerator::RampGenerator(MotionPipeline* pMotionPipeline, RampGenTimer* pRampGenTimer)
 {
     // Static refrerence to a single RampGenerator instance
     _pThis = this;
@@ -51,12 +47,29 @@ RampGenerator::RampGenerator(MotionPipeline* pMotionPipeline)
     _endStopReached = false;
     _lastDoneNumberedCmdIdx = RobotConsts::NUMBERED_COMMAND_NONE;
     _isEnabled = false;
-    _curStepRatePerTTicks = 0;
-    _curAccumulatorStep = 0;
-    _curAccumulatorNS = 0;
-    _endStopCheckNum = 0;
+    _isrBlocksEnded = 0;
+    _isrSnapshotChanged = false;
+    _stepPosSetAxisMask = 0;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        _totalStepsInc[axisIdx] = 0;
+    _isrSegTicksStarted = 0;
+    _stepSegments.init(STEP_SEGMENT_QUEUE_LEN);
+    clearSegments();
+    _endStopPinMask.clear();
     _isrTimerStarted = false;
+    _stepTimerVariable = false;
+    _isrIntervalTicks = 1;
+    _isrIntervalIdle = false;
+    _stepPulseActive = false;
     _rampGenEnabled = false;
+    _stepSmoothing = true;
+
+    // Timer - a timer can be supplied (e.g. to drive the ISR in virtual time when testing)
+    _pRampGenTimer = pRampGenTimer;
+#ifdef USE_ESP32_TIMER_ISR
+    if (!_pRampGenTimer)
+        _pRampGenTimer = &_rampGenTimerESP32;
+#endif
 
 #ifdef TEST_MOTION_ACTUATOR_ENABLE
     _pMotionInstrumentation = NULL;
@@ -79,16 +92,14 @@ void RampGenerator::setInstrumentationMode(const char *testModeStr)
 
 void RampGenerator::deinit()
 {
-#ifdef USE_ESP32_TIMER_ISR
     if (_isrTimerStarted)
     {
-        timerAlarmDisable(_isrMotionTimer);
+        _pRampGenTimer->stop();
         _isrTimerStarted = false;
     }
-#endif
 }
 
-void RampGenerator::configure(bool rampGenEnabled)
+void RampGenerator::configure(bool rampGenEnabled, bool stepTimerVariable, bool stepSmoothing, bool isrStats)
 {
     // Cache axis and endstop info
     _rampGenIO.getRawMotionHwInfo(_rawMotionHwInfo);
@@ -104,24 +115,30 @@ void RampGenerator::configure(bool rampGenEnabled)
 
 
     _rampGenEnabled = rampGenEnabled;
-    // If we are using the ISR then create the Spark Interval Timer and start it
-#ifdef USE_ESP32_TIMER_ISR
-    if (_rampGenEnabled)
+    _stepTimerVariable = stepTimerVariable;
+    _stepSmoothing = stepSmoothing;
+    _isrIntervalTicks = 1;
+    _isrIntervalIdle = false;
+    _stepPulseActive = false;
+    clearSegments();
+    _isrStats.configure(isrStats, MotionBlock::TICK_INTERVAL_NS);
+
+    // If we are using the ISR then start the timer
+    if (_rampGenEnabled && _pRampGenTimer)
     {
-        Log.notice("RampGenerator: Starting ISR timer for direct stepping\n");
-        _isrMotionTimer = timerBegin(0, CLOCK_RATE_MHZ, true);
-        timerAttachInterrupt(_isrMotionTimer, _staticISRStepperMotion, true);
-        timerAlarmWrite(_isrMotionTimer, DIRECT_STEP_ISR_TIMER_PERIOD_US, true);
-        timerAlarmEnable(_isrMotionTimer);
-        _isrTimerStarted = true;
+        Log.notice("RampGenerator: Starting ISR timer for direct stepping (%s interval, step smoothing %s)\n",
+                    _stepTimerVariable ? "variable" : "fixed", _stepSmoothing ? "on" : "off");
+        _isrTimerStarted = _pRampGenTimer->start(_staticISRStepperMotion, DIRECT_STEP_ISR_TIMER_PERIOD_US);
     }
-#endif
 }
 
+// Stop (any context) - all blocks and segments are discarded by the ISR
 void RampGenerator::stop()
 {
     _isPaused = true;
     _endStopReached = false;
+    _stepSegments.requestClear();
+    _pMotionPipeline->clear();
 }
 
 void RampGenerator::pause(bool pauseIt)
@@ -133,26 +150,102 @@ void RampGenerator::pause(bool pauseIt)
     }
 }
 
+// The step position is only changed by the ISR while moving so these must only be called when idle
+// (from the task which calls process())
 void RampGenerator::resetTotalStepPosition()
 {
+    setStepPosition((1 << RobotConsts::MAX_AXES) - 1, 0);
+}
+
+bool RampGenerator::getTotalStepPosition(AxisPosition& actuatorPos)
+{
+    MotionSnapshot snapshot;
+    bool snapshotValid = getMotionSnapshot(snapshot);
     for (int i = 0; i < RobotConsts::MAX_AXES; i++)
     {
-        _axisTotalSteps[i] = 0;
-        _totalStepsInc[i] = 0;
+        actuatorPos.setAbsSteps(i, snapshot._stepPos[i]);
     }
+    return snapshotValid;
 }
-void RampGenerator::getTotalStepPosition(AxisInt32s& actuatorPos)
+
+void RampGenerator::setTotalStepPosition(int axisIdx, int64_t stepPos)
 {
-    for (int i = 0; i < RobotConsts::MAX_AXES; i++)
+    if ((axisIdx >= 0) && (axisIdx < RobotConsts::MAX_AXES))
+        setStepPosition(1 << axisIdx, stepPos);
+}
+
+// Set the step position of the axes in the mask - without a running ISR timer (before configure
+// or when process() calls the ISR) there is no other writer so the change is made directly,
+// otherwise the ISR is asked to make it and this waits until it has
+void RampGenerator::setStepPosition(uint32_t axisMask, int64_t stepPos)
+{
+    if (!_isrTimerStarted)
     {
-        actuatorPos.setVal(i, _axisTotalSteps[i]);
+        for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+            if (axisMask & (1 << axisIdx))
+                _axisTotalSteps[axisIdx] = stepPos;
+        publishSnapshot();
+        return;
     }
+
+    // Wait for any earlier request to be applied before changing the requested values
+    uint32_t waitStartMs = millis();
+    while (_stepPosSetAxisMask.load(std::memory_order_acquire) && (millis() - waitStartMs < STEP_POS_SET_MAX_WAIT_MS))
+        delay(1);
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (axisMask & (1 << axisIdx))
+            _stepPosSetVals[axisIdx] = stepPos;
+    _stepPosSetAxisMask.fetch_or(axisMask, std::memory_order_release);
+
+    // Wait until applied so that the position read back is the new one
+    waitStartMs = millis();
+    while (_stepPosSetAxisMask.load(std::memory_order_acquire) && (millis() - waitStartMs < STEP_POS_SET_MAX_WAIT_MS))
+        delay(1);
+    if (_stepPosSetAxisMask.load(std::memory_order_acquire))
+        Log.warning("RampGenerator: step position change not yet applied by ISR\n");
 }
-void RampGenerator::setTotalStepPosition(int axisIdx, int32_t stepPos)
+
+// Apply a step position change requested by a task (ISR)
+void IRAM_ATTR RampGenerator::applyStepPosition()
 {
-    if ((axisIdx >= 0) && (axisIdx < RobotConsts::MAX_AXES))
-        _axisTotalSteps[axisIdx] = stepPos;
+    uint32_t axisMask = _stepPosSetAxisMask.load(std::memory_order_acquire);
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (axisMask & (1 << axisIdx))
+            _axisTotalSteps[axisIdx] = _stepPosSetVals[axisIdx];
+    _stepPosSetAxisMask.store(0, std::memory_order_release);
+    _isrSnapshotChanged = true;
+}
+
+// Get a consistent snapshot of position, rate and current block - this can be called from any task
+// Returns false if a consistent copy couldn't be made (the ISR was always writing it)
+bool RampGenerator::getMotionSnapshot(MotionSnapshot& snapshot)
+{
+    bool snapshotValid = _motionSnapshot.read(snapshot);
+    if (!snapshotValid)
+        Log.warning("RampGenerator: motion snapshot may be inconsistent\n");
+    if (_isPaused)
+        snapshot._stepRatePerTTicks = 0;
+    return snapshotValid;
+}
+
+// Publish the snapshot - called by the ISR when anything in the snapshot has changed (and from
+// setStepPosition() when the ISR isn't running)
+void IRAM_ATTR RampGenerator::publishSnapshot()
+{
+    MotionSnapshot& snapshot = _motionSnapshot.writeBegin();
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        snapshot._stepPos[axisIdx] = _axisTotalSteps[axisIdx];
+        snapshot._blockStepsTotal[axisIdx] = _pCurBlock ? _pCurBlock->_stepsTotalMaybeNeg[axisIdx] : 0;
+    }
+    snapshot._axisIdxWithMaxSteps = _pCurBlock ? _pCurBlock->_axisIdxWithMaxSteps : 0;
+    snapshot._stepRatePerTTicks = _pCurBlock ? _curStepRatePerTTicks : 0;
+    snapshot._blocksEnded = _isrBlocksEnded;
+    snapshot._numberedCmdIdx = _pCurBlock ? _pCurBlock->getNumberedCommandIndex() : RobotConsts::NUMBERED_COMMAND_NONE;
+    _motionSnapshot.writeEnd();
+    _isrSnapshotChanged = false;
 }
+
 void RampGenerator::clearEndstopReached()
 {
     _endStopReached = false;
@@ -178,112 +271,95 @@ bool IRAM_ATTR RampGenerator::handleStepEnd()
         {
             anyPinReset = true;
             _axisTotalSteps[axisIdx] += _totalStepsInc[axisIdx];
+            _isrSnapshotChanged = true;
         }
     }
+    _stepPulseActive = false;
     return anyPinReset;
 }
 
-// Setup new block - cache all the info needed to process the block and reset
-// motion accumulators to facilitate the block's execution
-void IRAM_ATTR RampGenerator::setupNewBlock(MotionBlock *pBlock)
+// Start the next step segment - returns false if there is no segment or if the segment starts
+// a block which reverses an axis (in which case stepping waits until the next tick so the
+// direction pin is set before the step pin)
+bool IRAM_ATTR RampGenerator::startSegment()
+{
+    // Discard any remaining segments of a block which has ended early (end-stop hit)
+    StepSegment *pSegment = _stepSegments.peekGet();
+    while (pSegment && !_pCurBlock && !pSegment->_blockStart)
+    {
+        _isrSegTicksStarted += pSegment->_numTicks;
+        _stepSegments.remove();
+        pSegment = _stepSegments.peekGet();
+    }
+    if (!pSegment)
+    {
+        // The next block (if any) will start from rest
+        if (!_pCurBlock)
+            _curAccumulatorStep = 0;
+        return false;
+    }
+
+    // Get the segment info
+    _curStepRatePerTTicks = pSegment->_stepRatePerTTicks;
+    _curSegTicksLeft = pSegment->_numTicks;
+    _curSegIsBlockEnd = pSegment->_blockEnd;
+    _curStepSmoothingLevel = pSegment->_stepSmoothingLevel;
+    _isrSegTicksStarted += pSegment->_numTicks;
+    _isrSnapshotChanged = true;
+
+    // Setup a new block from the setup staged with its first segment - the step accumulator
+    // carries on from the previous block so the step timing is continuous
+    bool dirnChanged = false;
+    if (pSegment->_blockStart)
+    {
+        _isrStats.notePath(MotionISRStats::ISR_PATH_NEW_BLOCK);
+        _pCurBlock = pSegment->_pBlock;
+        dirnChanged = setupNewBlock(_stepSegments.peekGetSetup());
+    }
+
+    // Free up the space in the queue
+    _stepSegments.remove();
+    return !dirnChanged;
+}
+
+// Setup new block - copy the staged info needed to process the block and reset the step counts
+// Returns true if the direction of a moving axis has changed
+bool IRAM_ATTR RampGenerator::setupNewBlock(StepBlockSetup *pSetup)
 {
-    // Setup step counts, direction and endstops for each axis
-    _endStopCheckNum = 0;
+    // Setup step counts and direction for each axis
+    bool dirnChanged = false;
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
     {
         // Total steps
-        int32_t stepsTotal = pBlock->_stepsTotalMaybeNeg[axisIdx];
-        _stepsTotalAbs[axisIdx] = abs(stepsTotal);
+        _stepsTotalAbs[axisIdx] = pSetup->_stepsTotalAbs[axisIdx];
         _curStepCount[axisIdx] = 0;
         _curAccumulatorRelative[axisIdx] = 0;
         // Set direction for the axis
-        _rampGenIO.setDirection(axisIdx, stepsTotal >= 0);
-        _totalStepsInc[axisIdx] = (stepsTotal >= 0) ? 1 : -1;
+        bool dirnPositive = (pSetup->_dirnPositiveMask & (1 << axisIdx)) != 0;
+        int32_t stepsInc = dirnPositive ? 1 : -1;
+        if ((_stepsTotalAbs[axisIdx] != 0) && (stepsInc != _totalStepsInc[axisIdx]))
+            dirnChanged = true;
+        _rampGenIO.setDirection(axisIdx, dirnPositive);
+        _totalStepsInc[axisIdx] = stepsInc;
 
         // Instrumentation
         INSTRUMENT_MOTION_ACTUATOR_STEP_DIRN
-
-        // Check if any endstops to setup
-        if (!pBlock->_endStopsToCheck.any())
-            continue;
-
-        // Check if the axis is moving in a direction which might result in hitting an active end-stop
-        for (int minMaxIdx = 0; minMaxIdx < AxisMinMaxBools::ENDSTOPS_PER_AXIS; minMaxIdx++)
-        {
-            int pinToTest = -1;
-            bool valToTestFor = false;
-
-            // See if anything to check for
-            AxisMinMaxBools::AxisMinMaxEnum minMaxType = pBlock->_endStopsToCheck.get(axisIdx, minMaxIdx);
-            if (minMaxType == AxisMinMaxBools::END_STOP_NONE)
-                continue;
-
-            // Check for towards - this is different from MAX or MIN because the axis will still move even if
-            // an endstop is hit if the movement is away from that endstop
-            if (minMaxType == AxisMinMaxBools::END_STOP_TOWARDS)
-            {
-                // Stop at max if we're heading towards max OR
-                // stop at min if we're heading towards min
-                if (!(((minMaxIdx == AxisMinMaxBools::MAX_VAL_IDX) && (stepsTotal > 0)) ||
-                        ((minMaxIdx == AxisMinMaxBools::MIN_VAL_IDX) && (stepsTotal < 0))))
-                    continue;
-            }
-            
-            // Pin for stop
-            pinToTest = (minMaxIdx == AxisMinMaxBools::MIN_VAL_IDX) ? 
-                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMin : 
-                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMax;
-
-            // Endstop test
-            valToTestFor = (minMaxType != AxisMinMaxBools::END_STOP_NOT_HIT) ? 
-                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMaxactLvl :
-                                !_rawMotionHwInfo._axis[axisIdx]._pinEndStopMaxactLvl;
-            if (pinToTest != -1)
-            {
-                _endStopChecks[_endStopCheckNum].pin = pinToTest;
-                _endStopChecks[_endStopCheckNum].val = valToTestFor;
-                _endStopCheckNum++;
-            }
-        }
     }
 
-    // Accumulator reset
-    _curAccumulatorStep = 0;
-    _curAccumulatorNS = 0;
-
-    // Step rate
-    _curStepRatePerTTicks = pBlock->_initialStepRatePerTTicks;
-}
-
-// Update millisecond accumulator to handle acceleration and deceleration
-void IRAM_ATTR RampGenerator::updateMSAccumulator(MotionBlock *pBlock)
-{
-    // Bump the millisec accumulator
-    _curAccumulatorNS += MotionBlock::TICK_INTERVAL_NS;
-
-    // Check for millisec accumulator overflow
-    if (_curAccumulatorNS >= MotionBlock::NS_IN_A_MS)
-    {
-        // Subtract from accumulator leaving remainder to combat rounding errors
-        _curAccumulatorNS -= MotionBlock::NS_IN_A_MS;
+    // End-stops
+    _endStopPinMask = pSetup->_endStopPinMask;
 
-        // Check if decelerating
-        if (_curStepCount[pBlock->_axisIdxWithMaxSteps] > pBlock->_stepsBeforeDecel)
-        {
-            if (_curStepRatePerTTicks > std::max(MIN_STEP_RATE_PER_TTICKS + pBlock->_accStepsPerTTicksPerMS,
-                                                 pBlock->_finalStepRatePerTTicks + pBlock->_accStepsPerTTicksPerMS))
-                _curStepRatePerTTicks -= pBlock->_accStepsPerTTicksPerMS;
-        }
-        else if ((_curStepRatePerTTicks < MIN_STEP_RATE_PER_TTICKS) || (_curStepRatePerTTicks < pBlock->_maxStepRatePerTTicks))
-        {
-            if (_curStepRatePerTTicks + pBlock->_accStepsPerTTicksPerMS < MotionBlock::TTICKS_VALUE)
-                _curStepRatePerTTicks += pBlock->_accStepsPerTTicksPerMS;
-        }
-    }
+    // Accumulators - the step accumulator carries on from the previous block (less any whole step
+    // held back by a step-end at the end of that block)
+    if (_curAccumulatorStep >= MotionBlock::TTICKS_VALUE)
+        _curAccumulatorStep -= MotionBlock::TTICKS_VALUE;
+    _curSubStepPos = 0;
+    _subStepsTotal = pSetup->_subStepsTotal;
+    return dirnChanged;
 }
 
 // Handle start of step on each axis
-bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
+bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlockExec *pBlock)
 {
     // Complete Flag
     bool anyAxisMoving = false;
@@ -294,7 +370,12 @@ bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
     // Subtract from accumulator leaving remainder
     _curAccumulatorStep -= MotionBlock::TTICKS_VALUE;
 
+    // Sub-steps since the last sub-step (all of them without step smoothing)
+    uint32_t subSteps = SUB_STEPS_PER_STEP - _curSubStepPos;
+    _curSubStepPos = 0;
+
     // Step the axis with the greatest step count if needed
+    _stepPulseActive = true;
     if (_curStepCount[axisIdxMaxSteps] < _stepsTotalAbs[axisIdxMaxSteps])
     {
         // Step this axis
@@ -308,17 +389,41 @@ bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
     }
 
     // Check if other axes need stepping
+    stepOtherAxes(pBlock, subSteps, anyAxisMoving);
+
+    // Return indicator of block complete
+    return anyAxisMoving;
+}
+
+// Handle a sub-step of the axis with max steps (step smoothing) - other axes step when due
+void IRAM_ATTR RampGenerator::handleSubStep(MotionBlockExec *pBlock, uint32_t subStepPos)
+{
+    uint32_t subSteps = subStepPos - _curSubStepPos;
+    _curSubStepPos = subStepPos;
+    bool anyAxisMoving = false;
+    if (stepOtherAxes(pBlock, subSteps, anyAxisMoving))
+        _stepPulseActive = true;
+}
+
+// Step axes other than the one with max steps when their relative accumulator overflows - this
+// is bumped by the axis's step count for each sub-step of the axis with max steps
+// Returns true if any axis stepped
+bool IRAM_ATTR RampGenerator::stepOtherAxes(MotionBlockExec *pBlock, uint32_t subSteps, bool &anyAxisMoving)
+{
+    int axisIdxMaxSteps = pBlock->_axisIdxWithMaxSteps;
+    bool anyStepped = false;
     for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
     {
         if ((axisIdx == axisIdxMaxSteps) || (_curStepCount[axisIdx] == _stepsTotalAbs[axisIdx]))
             continue;
 
         // Bump the relative accumulator
-        _curAccumulatorRelative[axisIdx] += _stepsTotalAbs[axisIdx];
-        if (_curAccumulatorRelative[axisIdx] >= _stepsTotalAbs[axisIdxMaxSteps])
+        _curAccumulatorRelative[axisIdx] += _stepsTotalAbs[axisIdx] * subSteps;
+        if (_curAccumulatorRelative[axisIdx] >= _subStepsTotal)
         {
             // Do the remainder calculation
-            _curAccumulatorRelative[axisIdx] -= _stepsTotalAbs[axisIdxMaxSteps];
+            _curAccumulatorRelative[axisIdx] -= _subStepsTotal;
+            anyStepped = true;
 
             // Step the axis
             _rampGenIO.stepStart(axisIdx);
@@ -330,28 +435,29 @@ bool IRAM_ATTR RampGenerator::handleStepMotion(MotionBlock *pBlock)
             INSTRUMENT_MOTION_ACTUATOR_STEP_START(axisIdx)
         }
     }
-
-    // Return indicator of block complete
-    return anyAxisMoving;
+    return anyStepped;
 }
 
-void IRAM_ATTR RampGenerator::endMotion(MotionBlock *pBlock)
+void IRAM_ATTR RampGenerator::endMotion(MotionBlockExec *pBlock)
 {
     _pMotionPipeline->remove();
     // Check if this is a numbered block - if so record its completion
     if (pBlock->getNumberedCommandIndex() != RobotConsts::NUMBERED_COMMAND_NONE)
         _lastDoneNumberedCmdIdx = pBlock->getNumberedCommandIndex();
+    // Any segments of the block still queued are discarded
+    _pCurBlock = NULL;
+    _curSegTicksLeft = 0;
+    _isrBlocksEnded++;
+    _isrSnapshotChanged = true;
 }
 
 #ifdef DEBUG_MONITOR_ISR_OPERATION
 volatile uint32_t accumStep = 0;
 volatile uint32_t stepRate = 0;
-volatile uint32_t accelacc = 0;
+volatile uint32_t segTicks = 0;
 volatile int maxstepax = -1;
-volatile uint32_t accrate = 0;
 volatile int curSteps = -1;
-volatile int befDec = -1;
-volatile int maxStepRt = -1;
+volatile int totSteps = -1;
 #endif
 
 // Function that handles ISR calls based on a timer
@@ -366,94 +472,503 @@ void IRAM_ATTR RampGenerator::isrStepperMotion()
 {    
     // Instrumentation code to time ISR execution (if enabled - see MotionInstrumentation.h)
     INSTRUMENT_MOTION_ACTUATOR_TIME_START
+    _isrStats.start();
 
-    // Do a step-end for any motor which needs one - return here to avoid too short a pulse
-    if (handleStepEnd())
-        return;
+    // Apply any step position change requested by a task
+    if (_stepPosSetAxisMask.load(std::memory_order_relaxed))
+        applyStepPosition();
 
-    // Check if paused
-    if (_isPaused)
-        return;
+    // Handle the ticks since the last call (only the last tick of an idle interval counts)
+    isrStepTicks(_isrIntervalIdle ? 1 : _isrIntervalTicks);
+    if (_isrSnapshotChanged)
+        publishSnapshot();
 
-    // Peek a MotionPipelineElem from the queue
-    MotionBlock *pBlock = _pMotionPipeline->peekGet();
-    if (!pBlock)
-        return;
+    // Output step and direction changes for all axes together
+    _rampGenIO.applyPinChanges();
 
-    // Check if the element can be executed
-    if (!pBlock->_canExecute)
-        return;
+    // With the variable step timer set the time of the next call
+    if (_stepTimerVariable)
+    {
+        uint32_t intervalTicks = isrTicksToNextEvent();
+        if (intervalTicks != _isrIntervalTicks)
+        {
+            _isrIntervalTicks = intervalTicks;
+            _pRampGenTimer->setPeriodUs(intervalTicks * DIRECT_STEP_ISR_TIMER_PERIOD_US);
+        }
+    }
 
-    // See if the block was already executing and set isExecuting if not
-    bool newBlock = !pBlock->_isExecuting;
-    pBlock->_isExecuting = true;
+    // Time execution
+    _isrStats.end(_isrIntervalTicks);
+    INSTRUMENT_MOTION_ACTUATOR_TIME_END
+}
 
-    // New block
-    if (newBlock)
-    {
-        // Setup new block
-        setupNewBlock(pBlock);
+// The ISR only executes step segments - acceleration and deceleration are handled
+// when segments are compiled (see fillSegments())
+void IRAM_ATTR RampGenerator::isrStepTicks(uint32_t elapsedTicks)
+{    
+    // Do a step-end for any motor which needs one - a step isn't started on the same
+    // tick to avoid too short a pulse
+    bool stepEnded = handleStepEnd();
 
-        // Return here to reduce the maximum time this function takes
-        // Assuming this function is called frequently (<50uS intervals say)
-        // then it will make little difference if we return now and pick up on the next tick
+    // Discard blocks and segments while a stop is in progress
+    bool pipelineClearing = _pMotionPipeline->serviceClearISR();
+    if (_stepSegments.serviceClearISR() || pipelineClearing)
+    {
+        _isrStats.notePath(MotionISRStats::ISR_PATH_CLEARING);
+        _isrSnapshotChanged |= (_pCurBlock != NULL);
+        _pCurBlock = NULL;
+        _curSegTicksLeft = 0;
+        _curAccumulatorStep = 0;
         return;
     }
 
-    // Check endstops        
-    bool endStopHit = false;
-    for (int i = 0; i < _endStopCheckNum; i++)
+    // Check if paused
+    if (_isPaused)
+        return;
+
+    // Start the next segment when the current one is complete
+    if (_curSegTicksLeft == 0)
     {
-        bool pinVal = digitalRead(_endStopChecks[i].pin);
-        if (pinVal == _endStopChecks[i].val)
-            endStopHit = true;
+        if (!startSegment())
+            return;
     }
+    _isrStats.notePath(MotionISRStats::ISR_PATH_MOVING);
 
-    // Handle end-stop hit
-    if (endStopHit)
+    // Check endstops - handle end-stop hit
+    if (_endStopPinMask.isHit())
     {
         // Cancel motion (by removing the block) as end-stop reached
+        _isrStats.notePath(MotionISRStats::ISR_PATH_END_STOP);
         _endStopReached = true;
-        endMotion(pBlock);
+        _curAccumulatorStep = 0;
+        endMotion(_pCurBlock);
+        return;
     }
 
-    // Update the millisec accumulator - this handles the process of changing speed incrementally to
-    // implement acceleration and deceleration
-    updateMSAccumulator(pBlock);
+    // Count down the segment - the last segment of a block runs on until the block's steps are complete
+    // (the variable step timer never schedules past the end of a segment)
+    if (!_curSegIsBlockEnd)
+        _curSegTicksLeft -= std::min(elapsedTicks, _curSegTicksLeft);
+    else if (_curSegTicksLeft > 1)
+        _curSegTicksLeft -= std::min(elapsedTicks, _curSegTicksLeft - 1);
 
-    // Bump the step accumulator
-    _curAccumulatorStep += std::max(_curStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
+    // Bump the step accumulator - a step which is held back by a step-end on this tick is taken
+    // on the next tick and the accumulator keeps counting so no time is lost
+    if (_curAccumulatorStep < 2 * MotionBlock::TTICKS_VALUE)
+        _curAccumulatorStep += elapsedTicks * _curStepRatePerTTicks;
 
 #ifdef DEBUG_MONITOR_ISR_OPERATION
     accumStep = _curAccumulatorStep;
     stepRate = _curStepRatePerTTicks;
-    accelacc = _curAccumulatorNS;
-    maxstepax = pBlock->_axisIdxWithMaxSteps;
-    accrate = pBlock->_accStepsPerTTicksPerMS;
-    curSteps = _curStepCount[pBlock->_axisIdxWithMaxSteps];
-    befDec =pBlock->_stepsBeforeDecel;
-    maxStepRt = pBlock->_maxStepRatePerTTicks;
+    segTicks = _curSegTicksLeft;
+    maxstepax = _pCurBlock->_axisIdxWithMaxSteps;
+    curSteps = _curStepCount[_pCurBlock->_axisIdxWithMaxSteps];
+    totSteps = _stepsTotalAbs[_pCurBlock->_axisIdxWithMaxSteps];
 #endif
 
     // Check for step accumulator overflow
+    if (stepEnded)
+        return;
     if (_curAccumulatorStep >= MotionBlock::TTICKS_VALUE)
     {
-        // Flag indicating this block is finished
-        bool anyAxisMoving = false;
-
         // Handle a step
-        anyAxisMoving = handleStepMotion(pBlock);
+        _isrStats.notePath(MotionISRStats::ISR_PATH_STEP);
+        bool anyAxisMoving = handleStepMotion(_pCurBlock);
 
         // Any axes still moving?
         if (!anyAxisMoving)
         {
             // This block is done
-            endMotion(pBlock);
+            endMotion(_pCurBlock);
         }
     }
+    else if (_curStepSmoothingLevel > 0)
+    {
+        // Check for the next sub-step at the current step smoothing level
+        uint32_t subStepShift = STEP_SMOOTHING_MAX_LEVEL - _curStepSmoothingLevel;
+        uint32_t nextSubStepPos = ((_curSubStepPos >> subStepShift) + 1) << subStepShift;
+        if (_curAccumulatorStep >= nextSubStepPos * SUB_STEP_TTICKS)
+        {
+            _isrStats.notePath(MotionISRStats::ISR_PATH_SUB_STEP);
+            handleSubStep(_pCurBlock, nextSubStepPos);
+        }
+    }
+}
 
-    // Time execution
-    INSTRUMENT_MOTION_ACTUATOR_TIME_END
+// Ticks until the ISR next needs to be called when using the variable step timer
+uint32_t IRAM_ATTR RampGenerator::isrTicksToNextEvent()
+{
+    // Step pulse to end
+    if (_stepPulseActive)
+        return 1;
+
+    // Check if idle
+    _isrIntervalIdle = _isPaused || ((_curSegTicksLeft == 0) && !_stepSegments.peekGet());
+    if (_isrIntervalIdle)
+        return STEP_TIMER_MAX_INTERVAL_TICKS;
+    if (_curSegTicksLeft == 0)
+        return 1;
+
+    // End-stops are checked every tick
+    if (_endStopPinMask.any())
+        return 1;
+
+    // Ticks until the next step or sub-step (or the end of the segment when the rate changes)
+    uint32_t nextStepAccumulator = MotionBlock::TTICKS_VALUE;
+    if (_curStepSmoothingLevel > 0)
+    {
+        uint32_t subStepShift = STEP_SMOOTHING_MAX_LEVEL - _curStepSmoothingLevel;
+        nextStepAccumulator = (((_curSubStepPos >> subStepShift) + 1) << subStepShift) * SUB_STEP_TTICKS;
+    }
+    if (_curAccumulatorStep >= nextStepAccumulator)
+        return 1;
+    uint32_t ticksToStep = (nextStepAccumulator - _curAccumulatorStep + _curStepRatePerTTicks - 1) / _curStepRatePerTTicks;
+    if (!_curSegIsBlockEnd)
+        ticksToStep = std::min(ticksToStep, _curSegTicksLeft);
+    return std::min(ticksToStep, STEP_TIMER_MAX_INTERVAL_TICKS);
+}
+
+// Clear step segments and segment compilation - only called when the ISR isn't running
+void RampGenerator::clearSegments()
+{
+    _stepSegments.clear();
+    _pCurBlock = NULL;
+    _curSegTicksLeft = 0;
+    _curSegIsBlockEnd = false;
+    _curStepRatePerTTicks = 0;
+    _curAccumulatorStep = 0;
+    _curStepSmoothingLevel = 0;
+    _curSubStepPos = 0;
+    _pSegBlock = NULL;
+    _segBlockStartPending = false;
+    _segCarryAccumulator = 0;
+    _segBlocksStarted = _isrBlocksEnded;
+    _segTicksQueued = _isrSegTicksStarted;
+}
+
+// Compile step segments from blocks in the pipeline which are ready to execute - called from the
+// main loop to keep the segment queue filled a short time ahead of the ISR
+void RampGenerator::fillSegments()
+{
+    // When stopping wait until the ISR has discarded all blocks and segments and then restart compilation
+    if (_pMotionPipeline->isClearPending() || _stepSegments.isClearPending())
+    {
+        _pSegBlock = NULL;
+        if (!_stepSegments.isClearPending())
+            _stepSegments.requestClear();
+        if (!_stepSegments.service() || _pMotionPipeline->isClearPending())
+            return;
+        _segBlocksStarted = _isrBlocksEnded;
+        _segTicksQueued = _isrSegTicksStarted;
+        _segCarryAccumulator = 0;
+    }
+
+    // Check if the block being compiled has been ended by the ISR (end-stop hit) - its
+    // remaining segments are discarded by the ISR
+    if (_pSegBlock && (_isrBlocksEnded == _segBlocksStarted))
+    {
+        _pSegBlock = NULL;
+        _segCarryAccumulator = 0;
+    }
+
+    // Compile segments until far enough ahead
+    while (_stepSegments.canPut() && (_segTicksQueued - _isrSegTicksStarted < STEP_SEGMENT_AHEAD_MS * TICKS_PER_MS))
+    {
+        // Check if a block needs to be started
+        if (!_pSegBlock)
+        {
+            // Blocks which have been started are executing so find the first that isn't
+            MotionBlockExec *pBlock = NULL;
+            for (unsigned int blockIdx = 0; ; blockIdx++)
+            {
+                pBlock = _pMotionPipeline->peekExecNthFromGet(blockIdx);
+                if (!pBlock || !pBlock->_isExecuting)
+                    break;
+            }
+
+            // Check the block can be executed
+            if (!pBlock || !pBlock->_canExecute)
+                return;
+            startSegmentBlock(pBlock);
+        }
+
+        // Add a segment
+        compileSegment();
+    }
+}
+
+// Start compiling a block - once started the block can't be changed by the planner
+void RampGenerator::startSegmentBlock(MotionBlockExec *pBlock)
+{
+    pBlock->_isExecuting = true;
+    _pSegBlock = pBlock;
+    _segBlocksStarted++;
+    _segBlockStartPending = true;
+
+    // Ramp starts at the initial rate and (for the jerk-limited profile) zero acceleration
+    _segStepCount = 0;
+    _segAccumulatorStep = _segCarryAccumulator;
+    _segCarryAccumulator = 0;
+    _segStepRatePerTTicks = pBlock->getInitialStepRatePerTTicks();
+    _segMaxStepRatePerTTicks = pBlock->getMaxStepRatePerTTicks();
+    _segFinalStepRatePerTTicks = pBlock->getExitStepRatePerTTicks();
+    _segAccPerTTicksPerMS = 0;
+    _segRampPhaseMs = 0;
+    _segRampDecelerating = false;
+
+    // Jerk-limited profile
+    _segAccelJerkPerTTicksPerMS2 = 0;
+    _segDecelJerkPerTTicksPerMS2 = 0;
+    _segAccelHalfMs = 0;
+    _segDecelHalfMs = 0;
+    if (pBlock->_jerkLimited)
+    {
+        uint32_t maxRate = _segMaxStepRatePerTTicks;
+        calcJerkPhase(maxRate > _segStepRatePerTTicks ? maxRate - _segStepRatePerTTicks : 0,
+                    pBlock->_accStepsPerTTicksPerMS, _segAccelJerkPerTTicksPerMS2, _segAccelHalfMs);
+        calcJerkPhase(maxRate > _segFinalStepRatePerTTicks ? maxRate - _segFinalStepRatePerTTicks : 0,
+                    pBlock->_accStepsPerTTicksPerMS, _segDecelJerkPerTTicksPerMS2, _segDecelHalfMs);
+    }
+
+    // Step smoothing is only needed when more than one axis moves
+    int axesMoving = 0;
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (pBlock->_stepsTotalMaybeNeg[axisIdx] != 0)
+            axesMoving++;
+    _segStepSmoothing = _stepSmoothing && (axesMoving > 1);
+}
+
+// Stage the setup of the block being compiled for the ISR
+void RampGenerator::stageBlockSetup(MotionBlockExec *pBlock, StepBlockSetup *pSetup)
+{
+    // Step counts and direction for each axis
+    pSetup->_dirnPositiveMask = 0;
+    pSetup->_endStopPinMask.clear();
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+    {
+        int32_t stepsTotal = pBlock->_stepsTotalMaybeNeg[axisIdx];
+        pSetup->_stepsTotalAbs[axisIdx] = abs(stepsTotal);
+        if (stepsTotal >= 0)
+            pSetup->_dirnPositiveMask |= (1 << axisIdx);
+
+        // Check if any endstops to setup
+        if (!pBlock->_endStopsToCheck.any())
+            continue;
+
+        // Check if the axis is moving in a direction which might result in hitting an active end-stop
+        for (int minMaxIdx = 0; minMaxIdx < AxisMinMaxBools::ENDSTOPS_PER_AXIS; minMaxIdx++)
+        {
+            int pinToTest = -1;
+            bool valToTestFor = false;
+
+            // See if anything to check for
+            AxisMinMaxBools::AxisMinMaxEnum minMaxType = pBlock->_endStopsToCheck.get(axisIdx, minMaxIdx);
+            if (minMaxType == AxisMinMaxBools::END_STOP_NONE)
+                continue;
+
+            // Check for towards - this is different from MAX or MIN because the axis will still move even if
+            // an endstop is hit if the movement is away from that endstop
+            if (minMaxType == AxisMinMaxBools::END_STOP_TOWARDS)
+            {
+                // Stop at max if we're heading towards max OR
+                // stop at min if we're heading towards min
+                if (!(((minMaxIdx == AxisMinMaxBools::MAX_VAL_IDX) && (stepsTotal > 0)) ||
+                        ((minMaxIdx == AxisMinMaxBools::MIN_VAL_IDX) && (stepsTotal < 0))))
+                    continue;
+            }
+            
+            // Pin for stop
+            pinToTest = (minMaxIdx == AxisMinMaxBools::MIN_VAL_IDX) ? 
+                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMin : 
+                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMax;
+
+            // Endstop test
+            valToTestFor = (minMaxType != AxisMinMaxBools::END_STOP_NOT_HIT) ? 
+                                _rawMotionHwInfo._axis[axisIdx]._pinEndStopMaxactLvl :
+                                !_rawMotionHwInfo._axis[axisIdx]._pinEndStopMaxactLvl;
+            if (pinToTest != -1)
+                pSetup->_endStopPinMask.add(pinToTest, valToTestFor);
+        }
+    }
+    pSetup->_subStepsTotal = pSetup->_stepsTotalAbs[pBlock->_axisIdxWithMaxSteps] * SUB_STEPS_PER_STEP;
+}
+
+// Compile the next segment of the block - this follows the block's ramp in the same way as the
+// ISR will so the step count (and hence the start of deceleration) is known at each ms
+void RampGenerator::compileSegment()
+{
+    MotionBlockExec *pBlock = _pSegBlock;
+    uint32_t stepsTotal = abs(pBlock->_stepsTotalMaybeNeg[pBlock->_axisIdxWithMaxSteps]);
+
+    // Segment rate and duration - the rate changes every ms when accelerating or decelerating
+    uint32_t stepRate = std::max(_segStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
+    uint32_t segMs = segmentConstantRateMs();
+    uint64_t segTicks = segMs * TICKS_PER_MS;
+
+    // Check if the block's steps complete within the segment
+    uint64_t ticksToEnd = ((uint64_t)(stepsTotal - _segStepCount) * MotionBlock::TTICKS_VALUE - _segAccumulatorStep + stepRate - 1) / stepRate;
+    bool blockEnd = ticksToEnd <= segTicks;
+    if (blockEnd)
+        segTicks = ticksToEnd;
+
+    // Stage the block setup with the first segment of the block
+    if (_segBlockStartPending)
+        stageBlockSetup(pBlock, _stepSegments.putSetup());
+
+    // Queue the segment
+    StepSegment segment;
+    segment._pBlock = pBlock;
+    segment._stepRatePerTTicks = stepRate;
+    segment._numTicks = segTicks;
+    segment._blockStart = _segBlockStartPending;
+    segment._blockEnd = blockEnd;
+    segment._stepSmoothingLevel = segmentStepSmoothingLevel(stepRate);
+    _stepSegments.put(segment);
+    _segTicksQueued += segTicks;
+    _segBlockStartPending = false;
+    if (blockEnd)
+    {
+        // The accumulator remainder after the last step carries into the next block
+        _segCarryAccumulator = _segAccumulatorStep + segTicks * stepRate -
+                    (uint64_t)(stepsTotal - _segStepCount) * MotionBlock::TTICKS_VALUE;
+        _pSegBlock = NULL;
+        return;
+    }
+
+    // Advance the step count and accumulator as the ISR will
+    uint64_t accumulator = _segAccumulatorStep + segTicks * stepRate;
+    _segStepCount += accumulator / MotionBlock::TTICKS_VALUE;
+    _segAccumulatorStep = accumulator % MotionBlock::TTICKS_VALUE;
+
+    // Update the rate at the end of the segment (ms which are merged into a single segment
+    // don't change the rate)
+    _segRampPhaseMs += segMs - 1;
+    updateSegmentRate(pBlock);
+}
+
+// Number of ms for which the rate of the block being compiled will remain constant
+uint32_t RampGenerator::segmentConstantRateMs()
+{
+    MotionBlockExec *pBlock = _pSegBlock;
+
+    // Check if accelerating or decelerating
+    if (_segStepCount > pBlock->_stepsBeforeDecel)
+        return 1;
+    if (pBlock->_jerkLimited)
+    {
+        if ((_segRampPhaseMs < 2 * _segAccelHalfMs) || (_segAccPerTTicksPerMS != 0) ||
+                    (_segStepRatePerTTicks < _segMaxStepRatePerTTicks))
+            return 1;
+    }
+    else if ((_segStepRatePerTTicks < MIN_STEP_RATE_PER_TTICKS) || (_segStepRatePerTTicks < _segMaxStepRatePerTTicks))
+    {
+        return 1;
+    }
+
+    // Running at max rate until the ms in which the step count passes the start of deceleration
+    uint32_t stepRate = std::max(_segStepRatePerTTicks, MIN_STEP_RATE_PER_TTICKS);
+    uint64_t ticksToDecel = ((uint64_t)(pBlock->_stepsBeforeDecel + 1 - _segStepCount) * MotionBlock::TTICKS_VALUE - _segAccumulatorStep + stepRate - 1) / stepRate;
+    uint64_t msToDecel = (ticksToDecel + TICKS_PER_MS - 1) / TICKS_PER_MS;
+    return (uint32_t) std::max((uint64_t)1, std::min(msToDecel, (uint64_t)STEP_SEGMENT_MAX_MS));
+}
+
+// Step smoothing level for a segment - the highest level at which sub-steps of the axis with max steps
+// occur no more often than STEP_SMOOTHING_MAX_RATE_PER_TTICKS (so at high step rates this is 0 and the
+// ISR does no extra work)
+uint32_t RampGenerator::segmentStepSmoothingLevel(uint32_t stepRate)
+{
+    uint32_t level = 0;
+    if (!_segStepSmoothing)
+        return level;
+    while ((level < STEP_SMOOTHING_MAX_LEVEL) && ((uint64_t)stepRate << (level + 1)) <= STEP_SMOOTHING_MAX_RATE_PER_TTICKS)
+        level++;
+    return level;
+}
+
+// Update the rate of the block being compiled (called for each ms) to handle acceleration and deceleration
+void RampGenerator::updateSegmentRate(MotionBlockExec *pBlock)
+{
+    // Jerk-limited profile
+    if (pBlock->_jerkLimited)
+    {
+        updateSegmentJerkLimitedRate(pBlock);
+        return;
+    }
+
+    // Check if decelerating
+    if (_segStepCount > pBlock->_stepsBeforeDecel)
+    {
+        if (_segStepRatePerTTicks > std::max(MIN_STEP_RATE_PER_TTICKS + pBlock->_accStepsPerTTicksPerMS,
+                                             _segFinalStepRatePerTTicks + pBlock->_accStepsPerTTicksPerMS))
+            _segStepRatePerTTicks -= pBlock->_accStepsPerTTicksPerMS;
+    }
+    else if ((_segStepRatePerTTicks < MIN_STEP_RATE_PER_TTICKS) || (_segStepRatePerTTicks < _segMaxStepRatePerTTicks))
+    {
+        if (_segStepRatePerTTicks + pBlock->_accStepsPerTTicksPerMS < MotionBlock::TTICKS_VALUE)
+            _segStepRatePerTTicks += pBlock->_accStepsPerTTicksPerMS;
+    }
+}
+
+// Update the step rate (called once per ms) for the jerk-limited profile - in each of the
+// acceleration and deceleration phases the acceleration rises linearly for halfMs and then
+// falls linearly back to zero
+void RampGenerator::updateSegmentJerkLimitedRate(MotionBlockExec *pBlock)
+{
+    // Check for the start of deceleration
+    bool decelerating = _segStepCount > pBlock->_stepsBeforeDecel;
+    if (decelerating != _segRampDecelerating)
+    {
+        _segRampDecelerating = decelerating;
+        _segRampPhaseMs = 0;
+        _segAccPerTTicksPerMS = 0;
+    }
+
+    // Update acceleration
+    uint32_t halfMs = decelerating ? _segDecelHalfMs : _segAccelHalfMs;
+    uint32_t jerk = decelerating ? _segDecelJerkPerTTicksPerMS2 : _segAccelJerkPerTTicksPerMS2;
+    bool phaseComplete = _segRampPhaseMs >= 2 * halfMs;
+    if (_segRampPhaseMs < halfMs)
+        _segAccPerTTicksPerMS += jerk;
+    else if (_segAccPerTTicksPerMS > jerk)
+        _segAccPerTTicksPerMS -= jerk;
+    else
+        _segAccPerTTicksPerMS = 0;
+    _segRampPhaseMs++;
+
+    // Update step rate
+    if (decelerating)
+    {
+        uint32_t minRate = std::max(MIN_STEP_RATE_PER_TTICKS, _segFinalStepRatePerTTicks);
+        if (_segStepRatePerTTicks > minRate + _segAccPerTTicksPerMS)
+            _segStepRatePerTTicks -= _segAccPerTTicksPerMS;
+        else if (_segStepRatePerTTicks > minRate)
+            _segStepRatePerTTicks = minRate;
+    }
+    else if (phaseComplete)
+    {
+        // Take up any rounding in the jerk calculation
+        _segStepRatePerTTicks = std::max(_segStepRatePerTTicks, _segMaxStepRatePerTTicks);
+    }
+    else
+    {
+        _segStepRatePerTTicks = std::min(_segStepRatePerTTicks + _segAccPerTTicksPerMS, _segMaxStepRatePerTTicks);
+    }
+}
+
+// Calculate jerk for a change of step rate which would take rateChange / accPerMS milliseconds at
+// constant acceleration - the acceleration rises by jerk each ms for halfMs and then falls for halfMs
+// giving a total rate change of jerk * halfMs^2
+void RampGenerator::calcJerkPhase(uint32_t rateChange, uint32_t accPerMS, uint32_t &jerkPerMS2, uint32_t &halfMs)
+{
+    jerkPerMS2 = 0;
+    halfMs = 0;
+    if ((rateChange == 0) || (accPerMS == 0))
+        return;
+    uint32_t phaseMs = (rateChange + accPerMS - 1) / accPerMS;
+    halfMs = (phaseMs + 1) / 2;
+    jerkPerMS2 = rateChange / (halfMs * halfMs);
+    if (jerkPerMS2 == 0)
+        jerkPerMS2 = 1;
 }
 
 // Process method called by main program loop
@@ -465,10 +980,12 @@ void RampGenerator::process()
     // If using a controller with a ramp generator then service the block handling
     if (_rampGenEnabled)
     {
-        // If not using ISR call _isrStepperMotion on every process call
-#ifndef USE_ESP32_TIMER_ISR
-        _isrStepperMotion();
-#endif
+        // Compile step segments for the ISR
+        fillSegments();
+
+        // If not using a timer call isrStepperMotion on every process call
+        if (!_pRampGenTimer)
+            isrStepperMotion();
     }
 
     // Instrumentation - used to collect test information about operation of RampGenerator
@@ -484,14 +1001,23 @@ String RampGenerator::getDebugStr()
 #endif
 #ifdef DEBUG_MONITOR_ISR_OPERATION
     char dbg[200];
-    sprintf(dbg, "accum %d rate %d accacc %d maxstepidx %d accrate %d cursteps %d befDec %d maxRt %d",
-            accumStep, stepRate, accelacc, maxstepax, accrate, curSteps, befDec, maxStepRt);
+    sprintf(dbg, "accum %d rate %d segTicks %d maxstepidx %d cursteps %d totSteps %d segs %d",
+            accumStep, stepRate, segTicks, maxstepax, curSteps, totSteps, _stepSegments.count());
     anymov = 6;
     return dbg;
 #endif
     return "";
 }
 
+// ISR timing statistics as JSON - optionally resetting them
+String RampGenerator::getISRStatsJSON(bool reset)
+{
+    String statsJson = _isrStats.toJSON();
+    if (reset)
+        _isrStats.requestReset();
+    return statsJson;
+}
+
 void RampGenerator::showDebug()
 {
 #ifdef INSTRUMENT_MOTION_ACTUATOR_ENABLE
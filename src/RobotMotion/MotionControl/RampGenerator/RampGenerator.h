@@ -10,7 +10,13 @@
 #include <ArduinoLog.h>
 #include "MotionInstrumentation.h"
 #include "../MotionBlock.h"
+#include "../../AxisPosition.h"
 #include "RampGenIO.h"
+#include "StepSegment.h"
+#include "RampGenTimer.h"
+#include "EndStopPinMask.h"
+#include "MotionSnapshot.h"
+#include "MotionISRStats.h"
 
 class MotionPipeline;
 
@@ -24,12 +30,25 @@ private:
     volatile bool _isPaused;
 
     // Steps moved in total and increment based on direction
-    volatile int32_t _axisTotalSteps[RobotConsts::MAX_AXES];
+    volatile int64_t _axisTotalSteps[RobotConsts::MAX_AXES];
     volatile int32_t _totalStepsInc[RobotConsts::MAX_AXES];
 
+    // Snapshot of position, rate and block published by the ISR (when changed) for other tasks
+    MotionSnapshotSeqLock _motionSnapshot;
+    bool _isrSnapshotChanged;
+
+    // Step position change requested by a task - while the ISR is running it applies the change
+    // itself so that it stays the only writer of the step position and the snapshot
+    std::atomic<uint32_t> _stepPosSetAxisMask;
+    int64_t _stepPosSetVals[RobotConsts::MAX_AXES];
+    static constexpr uint32_t STEP_POS_SET_MAX_WAIT_MS = 10;
+
     // Pipeline of blocks to be processed
     MotionPipeline* _pMotionPipeline;
 
+    // Step segments compiled from the pipeline blocks for the ISR to execute
+    StepSegmentQueue _stepSegments;
+
     // Motors and endstops
     RampGenIO _rampGenIO;
 
@@ -41,22 +60,52 @@ private:
     static constexpr uint32_t MIN_STEP_RATE_PER_SEC = 10;
     static constexpr uint32_t MIN_STEP_RATE_PER_TTICKS = uint32_t((MIN_STEP_RATE_PER_SEC * 1.0 * MotionBlock::TTICKS_VALUE) / MotionBlock::TICKS_PER_SEC);
 
+    // Step segments - the queue length must cover the time the main loop may be
+    // busy elsewhere and during acceleration a segment is generated for each ms
+    static constexpr int STEP_SEGMENT_QUEUE_LEN = 64;
+    // Segments are compiled ahead of the ISR by this time - blocks which are being compiled
+    // can't be changed by the planner so this shouldn't be longer than necessary
+    static constexpr uint32_t STEP_SEGMENT_AHEAD_MS = 40;
+    // Max duration of a single segment (when running at constant speed)
+    static constexpr uint32_t STEP_SEGMENT_MAX_MS = 10;
+    static constexpr uint32_t TICKS_PER_MS = MotionBlock::NS_IN_A_MS / MotionBlock::TICK_INTERVAL_NS;
+
+    // Step smoothing - at low step rates the other axes are stepped at sub-steps of the axis with max
+    // steps rather than only when it steps - each level halves the sub-step interval and the level is
+    // chosen for each segment so that sub-steps occur no more often than every 4 ticks
+    bool _stepSmoothing;
+    static constexpr uint32_t STEP_SMOOTHING_MAX_LEVEL = 3;
+    static constexpr uint32_t SUB_STEPS_PER_STEP = 1 << STEP_SMOOTHING_MAX_LEVEL;
+    static constexpr uint32_t SUB_STEP_TTICKS = MotionBlock::TTICKS_VALUE / SUB_STEPS_PER_STEP;
+    static constexpr uint32_t STEP_SMOOTHING_MAX_RATE_PER_TTICKS = MotionBlock::TTICKS_VALUE / 4;
+
+    // ISR timing statistics
+    MotionISRStats _isrStats;
+
 #ifdef INSTRUMENT_MOTION_ACTUATOR_ENABLE
     // Test code
     MotionInstrumentation *_pMotionInstrumentation;
 #endif
 
+    // ISR based interval timer - with a variable step timer the period is set on each call of the
+    // ISR to the time of the next step edge (in whole ticks) rather than always being one tick
 #ifdef USE_ESP32_TIMER_ISR
-    // ISR based interval timer
-    hw_timer_t *_isrMotionTimer;
-    static constexpr uint32_t CLOCK_RATE_MHZ = 80;
-    static constexpr uint32_t DIRECT_STEP_ISR_TIMER_PERIOD_US = uint32_t(MotionBlock::TICK_INTERVAL_NS / 1000l);
+    RampGenTimerESP32 _rampGenTimerESP32;
 #endif
+    RampGenTimer *_pRampGenTimer;
+    static constexpr uint32_t DIRECT_STEP_ISR_TIMER_PERIOD_US = uint32_t(MotionBlock::TICK_INTERVAL_NS / 1000l);
     bool _isrTimerStarted;
+    bool _stepTimerVariable;
+    uint32_t _isrIntervalTicks;
+    bool _isrIntervalIdle;
+    // Max interval of the variable step timer - this is the interval when idle and sets the
+    // delay before a newly queued segment starts
+    static constexpr uint32_t STEP_TIMER_MAX_INTERVAL_TICKS = 50;
 
 private:
     // Execution info for the currently executing block
     bool _isEnabled;
+    MotionBlockExec *_pCurBlock;
     // Ramp generation enabled
     bool _rampGenEnabled;
     // End-stop reached
@@ -66,27 +115,60 @@ private:
     // Steps
     uint32_t _stepsTotalAbs[RobotConsts::MAX_AXES];
     uint32_t _curStepCount[RobotConsts::MAX_AXES];
-    // Current step rate (in steps per K ticks)
+    // Current step rate (in steps per K ticks) and ticks remaining in the current segment
     uint32_t _curStepRatePerTTicks;
-    // Accumulators for stepping and acceleration increments
+    uint32_t _curSegTicksLeft;
+    bool _curSegIsBlockEnd;
+    // Step pulse started (and not yet ended)
+    bool _stepPulseActive;
+    // Accumulators for stepping - the relative accumulators count in sub-steps
     uint32_t _curAccumulatorStep;
-    uint32_t _curAccumulatorNS;
     uint32_t _curAccumulatorRelative[RobotConsts::MAX_AXES];
-
-    int _endStopCheckNum;
-    struct EndStopChecks
-    {
-        int pin;
-        bool val;
-    };
-    EndStopChecks _endStopChecks[RobotConsts::MAX_AXES];
+    // Step smoothing level of the current segment and the sub-step (of the axis with max steps) reached
+    uint32_t _curStepSmoothingLevel;
+    uint32_t _curSubStepPos;
+    uint32_t _subStepsTotal;
+    // Counts of blocks ended and segment ticks started by the ISR
+    volatile uint32_t _isrBlocksEnded;
+    volatile uint32_t _isrSegTicksStarted;
+
+    // Segment compilation (main loop) - block being compiled, blocks and ticks compiled so far
+    MotionBlockExec *_pSegBlock;
+    uint32_t _segBlocksStarted;
+    uint32_t _segTicksQueued;
+    bool _segBlockStartPending;
+    bool _segStepSmoothing;
+    // Ramp state of the block being compiled - step count and accumulator of the axis with max
+    // steps (as the ISR will see them) and the current rate
+    uint32_t _segStepCount;
+    uint32_t _segAccumulatorStep;
+    uint32_t _segStepRatePerTTicks;
+    // Max and final rates of the block being compiled (the execution record holds these in steps
+    // per second)
+    uint32_t _segMaxStepRatePerTTicks;
+    uint32_t _segFinalStepRatePerTTicks;
+    // Step accumulator carried into the next block - the ISR doesn't reset the accumulator between
+    // blocks so the step timing is continuous where blocks join
+    uint32_t _segCarryAccumulator;
+    // Jerk-limited profile - current acceleration, ms into the current phase and phase
+    uint32_t _segAccPerTTicksPerMS;
+    uint32_t _segRampPhaseMs;
+    bool _segRampDecelerating;
+    // Jerk-limited profile - jerk and half-phase durations of the block being compiled
+    uint32_t _segAccelJerkPerTTicksPerMS2;
+    uint32_t _segDecelJerkPerTTicksPerMS2;
+    uint32_t _segAccelHalfMs;
+    uint32_t _segDecelHalfMs;
+
+    // End-stops to check for the current block
+    EndStopPinMask _endStopPinMask;
 
 public:
-    RampGenerator(MotionPipeline* pMotionPipeline);
+    RampGenerator(MotionPipeline* pMotionPipeline, RampGenTimer* pRampGenTimer = NULL);
     // static void setRawMotionHwInfo(RobotConsts::RawMotionHwInfo_t &rawMotionHwInfo);
     void setInstrumentationMode(const char *testModeStr);
     void deinit();
-    void configure(bool rampGenEnabled);
+    void configure(bool rampGenEnabled, bool stepTimerVariable = false, bool stepSmoothing = true, bool isrStats = true);
     bool configureAxis(int axisIdx, const char *axisJSON)
     {
         return _rampGenIO.configureAxis(axisIdx, axisJSON);
@@ -95,8 +177,9 @@ public:
     // static void clear();
     void pause(bool pauseIt);
     void resetTotalStepPosition();
-    void getTotalStepPosition(AxisInt32s& actuatorPos);
-    void setTotalStepPosition(int axisIdx, int32_t stepPos);
+    bool getTotalStepPosition(AxisPosition& actuatorPos);
+    bool getMotionSnapshot(MotionSnapshot& snapshot);
+    void setTotalStepPosition(int axisIdx, int64_t stepPos);
     void clearEndstopReached();
     void getEndStopStatus(AxisMinMaxBools& axisEndStopVals)
     {
@@ -107,13 +190,31 @@ public:
     void process();
     String getDebugStr();
     void showDebug();
+    String getISRStatsJSON(bool reset);
 
 private:
     static void _staticISRStepperMotion();
     void isrStepperMotion();
+    void isrStepTicks(uint32_t elapsedTicks);
+    void publishSnapshot();
+    void setStepPosition(uint32_t axisMask, int64_t stepPos);
+    void applyStepPosition();
+    uint32_t isrTicksToNextEvent();
     bool handleStepEnd();
-    void setupNewBlock(MotionBlock *pBlock);
-    void updateMSAccumulator(MotionBlock *pBlock);
-    bool handleStepMotion(MotionBlock *pBlock);
-    void endMotion(MotionBlock *pBlock);
+    bool startSegment();
+    bool setupNewBlock(StepBlockSetup *pSetup);
+    bool handleStepMotion(MotionBlockExec *pBlock);
+    void handleSubStep(MotionBlockExec *pBlock, uint32_t subStepPos);
+    bool stepOtherAxes(MotionBlockExec *pBlock, uint32_t subSteps, bool &anyAxisMoving);
+    void endMotion(MotionBlockExec *pBlock);
+    void clearSegments();
+    void fillSegments();
+    void startSegmentBlock(MotionBlockExec *pBlock);
+    void stageBlockSetup(MotionBlockExec *pBlock, StepBlockSetup *pSetup);
+    void compileSegment();
+    uint32_t segmentConstantRateMs();
+    uint32_t segmentStepSmoothingLevel(uint32_t stepRate);
+    void updateSegmentRate(MotionBlockExec *pBlock);
+    void updateSegmentJerkLimitedRate(MotionBlockExec *pBlock);
+    static void calcJerkPhase(uint32_t rateChange, uint32_t accPerMS, uint32_t &jerkPerMS2, uint32_t &halfMs);
 };
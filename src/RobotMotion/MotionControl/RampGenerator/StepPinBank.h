@@ -0,0 +1,88 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef ESP32
+#include "soc/gpio_struct.h"
+#endif
+
+// Bank of output pins used for stepping
+// Pin changes requested during an ISR call are gathered into set and clear masks and then
+// applied together so all axes stepping on the same tick change at the same moment
+class StepPinBank
+{
+private:
+    // Pins are grouped in banks of 32 (on the ESP32 GPIO0..31 and GPIO32..39)
+    static constexpr int NUM_BANKS = 2;
+    static constexpr int PINS_PER_BANK = 32;
+    uint32_t _setMask[NUM_BANKS];
+    uint32_t _clearMask[NUM_BANKS];
+
+public:
+    StepPinBank()
+    {
+        clear();
+    }
+
+    // Discard pending changes
+    void IRAM_ATTR clear()
+    {
+        for (int bankIdx = 0; bankIdx < NUM_BANKS; bankIdx++)
+        {
+            _setMask[bankIdx] = 0;
+            _clearMask[bankIdx] = 0;
+        }
+    }
+
+    // Request a pin change (applied on the next call to apply())
+    void IRAM_ATTR write(int pin, bool val)
+    {
+        if ((pin < 0) || (pin >= NUM_BANKS * PINS_PER_BANK))
+            return;
+        uint32_t pinMask = 1ul << (pin % PINS_PER_BANK);
+        int bankIdx = pin / PINS_PER_BANK;
+        if (val)
+        {
+            _setMask[bankIdx] |= pinMask;
+            _clearMask[bankIdx] &= ~pinMask;
+        }
+        else
+        {
+            _clearMask[bankIdx] |= pinMask;
+            _setMask[bankIdx] &= ~pinMask;
+        }
+    }
+
+    // Apply pending changes - with one clear and one set register write per bank
+    void IRAM_ATTR apply()
+    {
+#ifdef ESP32
+        if (_clearMask[0])
+            GPIO.out_w1tc = _clearMask[0];
+        if (_clearMask[1])
+            GPIO.out1_w1tc.val = _clearMask[1];
+        if (_setMask[0])
+            GPIO.out_w1ts = _setMask[0];
+        if (_setMask[1])
+            GPIO.out1_w1ts.val = _setMask[1];
+#else
+        // Other platforms write each pin (this is also used to record pin changes when testing)
+        for (int bankIdx = 0; bankIdx < NUM_BANKS; bankIdx++)
+        {
+            if ((_clearMask[bankIdx] | _setMask[bankIdx]) == 0)
+                continue;
+            for (int bitIdx = 0; bitIdx < PINS_PER_BANK; bitIdx++)
+            {
+                if (_clearMask[bankIdx] & (1ul << bitIdx))
+                    digitalWrite(bankIdx * PINS_PER_BANK + bitIdx, false);
+                if (_setMask[bankIdx] & (1ul << bitIdx))
+                    digitalWrite(bankIdx * PINS_PER_BANK + bitIdx, true);
+            }
+        }
+#endif
+        clear();
+    }
+};
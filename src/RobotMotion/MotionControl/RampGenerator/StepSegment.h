@@ -0,0 +1,154 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include "../MotionRingBuffer.h"
+#include "../MotionBlockExec.h"
+#include "EndStopPinMask.h"
+#include <vector>
+
+// Step segment - a short run of constant-rate stepping within a block
+// Segments are compiled from the acceleration/deceleration profile of each block in the main
+// program loop so that the ISR only has to count ticks and generate steps
+class StepSegment
+{
+public:
+    // Block which the segment is part of
+    MotionBlockExec *_pBlock;
+    // Step rate (in steps per TTicks) of the axis with max steps
+    uint32_t _stepRatePerTTicks;
+    // Duration of segment in ticks (MotionBlock::TICK_INTERVAL_NS)
+    uint16_t _numTicks;
+    // Flags
+    struct
+    {
+        // First segment of the block
+        bool _blockStart : 1;
+        // Last segment of the block - this runs on until all of the block's steps are complete
+        bool _blockEnd : 1;
+        // Step smoothing level (see RampGenerator::segmentStepSmoothingLevel())
+        uint8_t _stepSmoothingLevel : 2;
+    };
+};
+
+// Setup of a block for the ISR - this is staged (in the main loop) alongside the first segment of
+// the block so the ISR can start the block on the tick after the previous block's last step
+class StepBlockSetup
+{
+public:
+    // Steps of each axis and direction (bit per axis set for positive)
+    uint32_t _stepsTotalAbs[RobotConsts::MAX_AXES];
+    uint32_t _dirnPositiveMask;
+    // Sub-steps of the axis with max steps
+    uint32_t _subStepsTotal;
+    // End-stops to check
+    EndStopPinMask _endStopPinMask;
+};
+
+// Queue of step segments between the main loop (producer) and the ISR (consumer)
+class StepSegmentQueue
+{
+private:
+    MotionRingBufferPosn _queuePosn;
+    std::vector<StepSegment> _queue;
+    // Block setups - only valid for segments which start a block
+    std::vector<StepBlockSetup> _setups;
+
+public:
+    StepSegmentQueue() : _queuePosn(0)
+    {
+    }
+
+    // Init - the size is rounded up to a power of two
+    void init(int queueSize)
+    {
+        _queuePosn.init(queueSize);
+        _queue.resize(_queuePosn.size());
+        _setups.resize(_queuePosn.size());
+    }
+
+    // Clear the queue - only when the ISR isn't running
+    void clear()
+    {
+        _queuePosn.clear();
+    }
+
+    // Request a clear (any context) - the segments are discarded by the ISR and the clear is
+    // completed by service() in the main loop - no segments can be added until then
+    void requestClear()
+    {
+        _queuePosn.requestFlush();
+    }
+
+    // Check if a clear is in progress
+    bool isClearPending()
+    {
+        return _queuePosn.isFlushPending();
+    }
+
+    // Discard all segments while a clear is in progress (ISR) - returns true if clearing
+    bool IRAM_ATTR serviceClearISR()
+    {
+        return _queuePosn.consumerFlush();
+    }
+
+    // Complete a clear once the ISR has discarded all segments (main loop) - returns true
+    // if no clear is pending
+    bool service()
+    {
+        return _queuePosn.producerFlushAck();
+    }
+
+    unsigned int count()
+    {
+        return _queuePosn.count();
+    }
+
+    // Check if ready to accept data
+    bool canPut()
+    {
+        return _queuePosn.canPut();
+    }
+
+    // Add to queue
+    bool put(StepSegment &segment)
+    {
+        // Check if full
+        if (!_queuePosn.canPut())
+            return false;
+
+        // Add the item
+        _queue[_queuePosn.putIdx()] = segment;
+        _queuePosn.hasPut();
+        return true;
+    }
+
+    // Block setup for the segment which will be put next - this must be written before put()
+    StepBlockSetup* putSetup()
+    {
+        return &(_setups[_queuePosn.putIdx()]);
+    }
+
+    // Peek the segment which would be got (if there is one)
+    StepSegment* IRAM_ATTR peekGet()
+    {
+        // Check if queue is empty
+        if (!_queuePosn.canGet())
+            return NULL;
+        return &(_queue[_queuePosn.getIdx()]);
+    }
+
+    // Peek the block setup for the segment which would be got - only valid if peekGet() succeeds
+    StepBlockSetup* IRAM_ATTR peekGetSetup()
+    {
+        return &(_setups[_queuePosn.getIdx()]);
+    }
+
+    // Remove the segment at the get position
+    void IRAM_ATTR remove()
+    {
+        if (_queuePosn.canGet())
+            _queuePosn.hasGot();
+    }
+};
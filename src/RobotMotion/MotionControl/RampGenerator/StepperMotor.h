@@ -5,6 +5,7 @@
 
 #include <Arduino.h>
 #include "RobotConsts.h"
+#include "StepPinBank.h"
 
 class StepperMotor
 {
@@ -30,12 +31,16 @@ class StepperMotor
     bool _stepCurActive;
     bool _curDirVal;
 
+    // Step and direction pin changes are gathered in the pin bank and applied at the end of the ISR
+    StepPinBank* _pStepPinBank;
+
   public:
     // For MOTOR_TYPE_DRIVER two pins are used step & direction
     StepperMotor(RobotConsts::MOTOR_TYPE motorType, int pinStep, int pinDirectionSingle, 
                 int pinDirectionMux1, int pinDirectionMux2, int pinDirectionMux3, 
-                int muxDirectionIdx, bool directionReversed)
+                int muxDirectionIdx, bool directionReversed, StepPinBank* pStepPinBank)
     {
+        _pStepPinBank = pStepPinBank;
         if (motorType == RobotConsts::MOTOR_TYPE_DRIVER)
         {
             if (pinStep != -1)
@@ -97,7 +102,7 @@ class StepperMotor
         bool dirnVal = _motorDirectionReversed ? dirn : !dirn;
         if (_pinDirectionSingle >= 0)
         {
-            digitalWrite(_pinDirectionSingle, dirnVal);
+            _pStepPinBank->write(_pinDirectionSingle, dirnVal);
         }
         else 
         {
@@ -111,7 +116,7 @@ class StepperMotor
         if (_stepCurActive)
         {
             _stepCurActive = false;
-            digitalWrite(_pinStep, false);
+            _pStepPinBank->write(_pinStep, false);
             return true;
         }
         return false;
@@ -121,6 +126,7 @@ class StepperMotor
     {
         if (_pinStep >= 0)
         {
+            // Multiplexed direction pins are written immediately so they are set up before the step
             if (_pinDirectionSingle < 0)
             {
                 if (_pinDirectionMux1 >= 0)
@@ -131,7 +137,7 @@ class StepperMotor
                     digitalWrite(_pinDirectionMux3, _curDirVal ? 1 : ((_muxDirectionIdx & 0x04) != 0));
             }
 
-            digitalWrite(_pinStep, true);
+            _pStepPinBank->write(_pinStep, true);
             _stepCurActive = true;
         }
 
@@ -6,8 +6,10 @@
 
 #include "TrinamicsController.h"
 
+#ifdef ESP32
 #include <HardwareSerial.h>
 #include <TMCStepper.h>
+#endif
 
 #include "ConfigPinMap.h"
 #include "RdJson.h"
@@ -63,6 +65,7 @@ void TrinamicsController::configure(const char* configJSON) {
         }
     }
 
+#ifdef ESP32
     // Handle CS (may be multiplexed)
     if (_isEnabled) {
         int _toff = RdJson::getDouble("driver_TOFF", 5, motionController.c_str());
@@ -149,6 +152,7 @@ void TrinamicsController::configure(const char* configJSON) {
             }
         }
     }
+#endif
 }
 
 uint32_t TrinamicsController::getUint32WithBaseFromConfig(const char* dataPath, uint32_t defaultValue, const char* pSourceStr) {
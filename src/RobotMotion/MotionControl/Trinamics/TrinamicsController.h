@@ -269,7 +269,9 @@ private:
     bool _isRampGenerator;
 
     // Timer
+#ifdef ESP32
     esp_timer_handle_t _trinamicsTimerHandle;
+#endif
     bool _trinamicsTimerStarted;
 
     // Last completed numbered command
@@ -85,6 +85,18 @@ bool RobotController::isPaused()
     return _pRobot->isPaused();
 }
 
+// Check if idle (no motion in progress or queued)
+bool RobotController::isIdle()
+{
+    return _motionHelper.isIdle();
+}
+
+// Check if homing
+bool RobotController::isHoming()
+{
+    return _motionHelper.isHoming();
+}
+
 // Service (called frequently)
 void RobotController::service()
 {
@@ -132,6 +144,19 @@ void RobotController::getCurStatus(RobotCommandArgs& args)
     _pRobot->getCurStatus(args);
 }
 
+// Get current position - uses the kinematics state so must be called from the motion task
+// (or with it locked out)
+void RobotController::getCurPositionMM(AxisFloats& curPosMM)
+{
+    _motionHelper.getCurPositionMM(curPosMM);
+}
+
+// Get motion ISR timing statistics (can be called from any task)
+String RobotController::getISRStatsJSON(bool reset)
+{
+    return _motionHelper.getISRStatsJSON(reset);
+}
+
 // Get robot attributes
 void RobotController::getRobotAttributes(String& robotAttrs)
 {
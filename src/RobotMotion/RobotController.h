@@ -28,6 +28,12 @@ public:
     // Check if paused
     bool isPaused();
 
+    // Check if idle (no motion in progress or queued)
+    bool isIdle();
+
+    // Check if homing
+    bool isHoming();
+
     // Service (called frequently)
     void service();
 
@@ -45,6 +51,12 @@ public:
     // Get status
     void getCurStatus(RobotCommandArgs& args);
 
+    // Get current position (motion task only - see WorkManager::getCurPositionMM)
+    void getCurPositionMM(AxisFloats& curPosMM);
+
+    // Get motion ISR timing statistics (can be called from any task)
+    String getISRStatsJSON(bool reset);
+
     // Get robot attributes
     void getRobotAttributes(String& robotAttrs);
 
@@ -5,6 +5,7 @@
 #include "RobotSandTableRotary.h"
 #include "../MotionControl/MotionHelper.h"
 #include "Utils.h"
+#include "FastTrig.h"
 #include "math.h"
 
 static const char* MODULE_PREFIX = "SandTableRotary: ";
@@ -16,11 +17,17 @@ static const char* MODULE_PREFIX = "SandTableRotary: ";
 //Axis 0 = ROTARY axis
 //Axis 1 = LINEAR axis!
 
+RobotSandTableRotary::KinematicsConsts RobotSandTableRotary::_kinematics;
+
 RobotSandTableRotary::RobotSandTableRotary(const char* pRobotTypeName, MotionHelper& motionHelper) :
     RobotBase(pRobotTypeName, motionHelper)
 {
+    // Kinematics constants are recalculated when the robot is configured
+    calcKinematicsConsts(_motionHelper.getAxesParams());
+
     // Set transforms
-    _motionHelper.setTransforms(ptToActuator, actuatorToPt, correctStepOverflow, convertCoords, setRobotAttributes);
+    _motionHelper.setTransforms(ptToActuator, actuatorToPt, correctStepOverflow, convertCoords, setRobotAttributes,
+                polarToActuator, actuatorToPolar, ptsToActuator);
 }
 
 RobotSandTableRotary::~RobotSandTableRotary()
@@ -71,80 +78,159 @@ bool RobotSandTableRotary::ptToActuator(AxisFloats& targetPt, AxisFloats& outAct
     return true;
 }
 
+// Convert a batch of cartesian points to actuator coordinates
+// The maths is the same as ptToActuator (cartesianToPolar, calcRelativePolar and relativePolarToSteps)
+// but the current polar position and the kinematics constants are fetched once for the whole batch
+// and the loop body has no calls other than atan2 so the compiler can pipeline it
+// Outputs are always filled in - the return value is false if any point is out of bounds (and this
+// isn't allowed)
+bool RobotSandTableRotary::ptsToActuator(const float* const ptAxes[], float* const outActuatorAxes[], int numPts,
+            AxisPosition& curAxisPositions, AxesParams& axesParams, bool allowOutOfBounds)
+{
+    // Current position in polar wrapped 0..360 degrees
+    AxisFloats curPolar;
+    actuatorToPolar(curAxisPositions._stepsFromHome, curPolar, axesParams);
+    const float curTheta = curPolar.getVal(0);
+    const float curRho = curPolar.getVal(1);
+    const float curStepsTheta = float(curAxisPositions._stepsFromHome.getVal(0));
+    const float curStepsRho = float(curAxisPositions._stepsFromHome.getVal(1));
+
+    // Constants
+    const float maxLinearMM = _kinematics._maxLinearMM;
+    const float maxLinearMMInv = _kinematics._maxLinearMMInv;
+    const float thetaStepsPerDeg = _kinematics._thetaStepsPerDeg;
+    const float rhoCouplingStepsPerDeg = _kinematics._rhoCouplingStepsPerDeg;
+    const float rhoStepsForMaxLinear = _kinematics._rhoStepsForMaxLinear;
+    static const float twoPi = float(2.0 * M_PI);
+
+    const float* pPtX = ptAxes[0];
+    const float* pPtY = ptAxes[1];
+    float* pOutTheta = outActuatorAxes[0];
+    float* pOutRho = outActuatorAxes[1];
+    bool allValid = true;
+    for (int ptIdx = 0; ptIdx < numPts; ptIdx++)
+    {
+        float x = pPtX[ptIdx];
+        float y = pPtY[ptIdx];
+
+        // Target polar (theta wrapped 0..360 degrees)
+        float distFromOrigin = sqrtf(x * x + y * y);
+        allValid &= distFromOrigin <= maxLinearMM;
+        float theta = FastTrig::atan2Rad(y, x);
+        if (theta < 0)
+            theta += twoPi;
+        theta = (theta - twoPi * floorf(theta / twoPi)) * float(180.0 / M_PI);
+        float rho = distFromOrigin * maxLinearMMInv;
+
+        // Minimum rotation for theta - points close to the origin keep the current theta
+        float thetaRel = calcRelativePolar(theta, curTheta);
+        float rhoRel = rho - curRho;
+        if ((fabsf(x) < 1) && (fabsf(y) < 1))
+        {
+            thetaRel = 0;
+            rhoRel = -curRho;
+        }
+
+        // Steps
+        float stepsRelTheta = roundf(thetaRel * thetaStepsPerDeg);
+        float stepsRelRho = roundf(thetaRel * rhoCouplingStepsPerDeg + rhoRel * rhoStepsForMaxLinear);
+        pOutTheta[ptIdx] = curStepsTheta + stepsRelTheta;
+        pOutRho[ptIdx] = curStepsRho + stepsRelRho;
+    }
+    return allValid || allowOutOfBounds;
+}
+
+// Convert a polar point to actuator coordinates - the robot is natively polar so
+// no cartesian conversion is needed to find the steps
+bool RobotSandTableRotary::polarToActuator(AxisFloats& targetPolar, AxisFloats& outActuator, AxisFloats& outPt,
+            AxisPosition& curAxisPositions, AxesParams& axesParams, bool allowOutOfBounds)
+{
+    // Check validity of position (rho cannot be greater than linear axis max length)
+    float targetTheta = AxisUtils::wrapDegrees(targetPolar.getVal(0));
+    float targetRho = targetPolar.getVal(1);
+    if ((targetRho > 1) && (!allowOutOfBounds))
+    {
+        Log.verbose("%sOut of bounds not allowed\n", MODULE_PREFIX);
+        return false;
+    }
+
+    // Current position in polar wrapped 0..360 degrees
+    AxisFloats curPolar;
+    actuatorToPolar(curAxisPositions._stepsFromHome, curPolar, axesParams);
+
+    // Equivalent cartesian point (needed by the planner)
+    float sinTheta, cosTheta;
+    FastTrig::sinCosDeg(targetTheta, sinTheta, cosTheta);
+    outPt.setVal(0, targetRho * _kinematics._maxLinearMM * cosTheta);
+    outPt.setVal(1, targetRho * _kinematics._maxLinearMM * sinTheta);
+
+    // Find the minimum rotation for theta
+    AxisFloats relativePolarSolution;
+    relativePolarSolution.setVal(0, calcRelativePolar(targetTheta, curPolar.getVal(0)));
+    relativePolarSolution.setVal(1, targetRho - curPolar.getVal(1));
+
+    // Check for points close to the origin (as ptToActuator)
+    if (AxisUtils::isApprox(outPt.getVal(0), 0, 1) && AxisUtils::isApprox(outPt.getVal(1), 0, 1))
+    {
+        // Keep the current position for theta, set rho to 0
+        relativePolarSolution.setVal(0, 0);
+        relativePolarSolution.setVal(1, curPolar.getVal(1) * -1);
+        outPt.setVal(0, 0);
+        outPt.setVal(1, 0);
+    }
+
+    // Apply this to calculate required steps
+    relativePolarToSteps(relativePolarSolution, curAxisPositions, outActuator, axesParams);
+    return true;
+}
+
 void RobotSandTableRotary::actuatorToPt(AxisInt32s& actuatorPos, AxisFloats& outPt, AxisPosition& curPos, AxesParams& axesParams)
 {
     // Get current polar
     AxisFloats curPolar;
     actuatorToPolar(actuatorPos, curPolar, axesParams);
 
-	// Calculate max linear axis
-	float maxLinear = -1;
-    axesParams.getMaxVal(1, maxLinear);
-    if(maxLinear == -1)
-        maxLinear = 100;
-
     // Compute axis positions from polar values
-    float rho = float(curPolar.getVal(1) * maxLinear);
+    float rho = curPolar.getVal(1) * _kinematics._maxLinearMM;
     float theta = curPolar.getVal(0);
 
-    float x = rho * cos(AxisUtils::d2r(theta));
-    float y = rho * sin(AxisUtils::d2r(theta));
+    float sinTheta, cosTheta;
+    FastTrig::sinCosDeg(theta, sinTheta, cosTheta);
+    float x = rho * cosTheta;
+    float y = rho * sinTheta;
 
     outPt.setVal(0, x);
     outPt.setVal(1, y);    
 }
 
+// The kinematics view of the steps is the absolute steps less a whole number of rotations
+// of the rotary axis - the linear axis is also moved by the steps it makes in a whole rotation
+// of the rotary axis (the pinion moves along the rack) so the view is exact and doesn't drift
 void RobotSandTableRotary::correctStepOverflow(AxisPosition& curPos, AxesParams& axesParams)
 {
-    int rotationStepsTheta = (int)(axesParams.getStepsPerRot(0));
-    int rotationStepsRho = (int)(axesParams.getStepsPerRot(1));
-    bool showDebug = false;
-        if (curPos._stepsFromHome.getVal(0) > rotationStepsTheta || curPos._stepsFromHome.getVal(0) <= -rotationStepsTheta)
-        {
-            Log.info("CORRECTING ax0 %d ax1 %d\n",
-                            curPos._stepsFromHome.getVal(0), curPos._stepsFromHome.getVal(1));
-            showDebug = true;
-        }
-    // Bring steps from home values back within a single rotation
-    while (curPos._stepsFromHome.getVal(0) > rotationStepsTheta) {
-        curPos._stepsFromHome.setVal(0, curPos._stepsFromHome.getVal(0) - rotationStepsTheta);
-        curPos._stepsFromHome.setVal(1, curPos._stepsFromHome.getVal(1) - rotationStepsRho);
-    }
-    while (curPos._stepsFromHome.getVal(0) <= -rotationStepsTheta) {
-        curPos._stepsFromHome.setVal(0, curPos._stepsFromHome.getVal(0) + rotationStepsTheta);
-        curPos._stepsFromHome.setVal(1, curPos._stepsFromHome.getVal(1) + rotationStepsRho);
-    }
-    
-    if (showDebug)
-        Log.info("CORRECTED ax0 %d ax1 %d\n", curPos._stepsFromHome.getVal(0), curPos._stepsFromHome.getVal(1));
+    int64_t rotationStepsTheta = _kinematics._thetaStepsPerRot;
+    int64_t rotationStepsRho = _kinematics._rhoStepsPerRot;
+    if (rotationStepsTheta <= 0)
+        return;
+    int64_t rotations = curPos._absStepsFromHome[0] / rotationStepsTheta;
+    curPos._stepsFromHome.setVal(0, int32_t(curPos._absStepsFromHome[0] - rotations * rotationStepsTheta));
+    curPos._stepsFromHome.setVal(1, int32_t(curPos._absStepsFromHome[1] - rotations * rotationStepsRho));
 }
 
 bool RobotSandTableRotary::cartesianToPolar(AxisFloats& targetPt, AxisFloats& targetSoln1, AxesParams& axesParams)
 {
-	// Calculate arm lengths
-	// The maxVal for axis0 and axis1 are used to determine the arm lengths
-	// The radius of the machine is the sum of these two lengths
-	float linearLength = 0;
-
-	bool axis1MaxValid = axesParams.getMaxVal(1, linearLength);
-
-    //  If not valid set to some values to avoid arithmetic errors
-
-	if (!axis1MaxValid)
-		linearLength = 100;
-
 	// Calculate distance from origin to pt (forms one side of triangle where arm segments form other sides)
-	float distFromOrigin = sqrt(pow(targetPt._pt[0], 2) + pow(targetPt._pt[1], 2));
+	float distFromOrigin = sqrtf(targetPt._pt[0] * targetPt._pt[0] + targetPt._pt[1] * targetPt._pt[1]);
 	// Check validity of position (distance from origin cannot be greater than linear axis max length)
-	bool posValid = distFromOrigin <= linearLength;
+	bool posValid = distFromOrigin <= _kinematics._maxLinearMM;
 
 	// Calculate theta. Will always be POSITIVE (0 -> 2PI)
-	float theta = atan2(targetPt._pt[1], targetPt._pt[0]);
+	float theta = FastTrig::atan2Rad(targetPt._pt[1], targetPt._pt[0]);
 	if (theta < 0)
-		theta += M_PI * 2;
+		theta += float(M_PI * 2);
 
 	// Calculate required radius
-	float rho = float(distFromOrigin / linearLength);
+	float rho = distFromOrigin * _kinematics._maxLinearMMInv;
 
 	//Return theta in DEGREES and rho.
 	targetSoln1.setVal(0, AxisUtils::r2d(AxisUtils::wrapRadians(theta)));
@@ -170,26 +256,17 @@ float RobotSandTableRotary::calcRelativePolar(float targetRotation, float curRot
 void RobotSandTableRotary::relativePolarToSteps(AxisFloats& relativePolar, AxisPosition& curAxisPositions, 
             AxisFloats& outActuator, AxesParams& axesParams)
 {
-    float maxLinear = -1;
-    axesParams.getMaxVal(1, maxLinear);
-    if(maxLinear == -1)
-        maxLinear = 100;
-
     // Convert relative polar to steps
-
-    float fractionalRotation = float(relativePolar.getVal(0) / float(360));
-    int32_t stepsRelTheta = int32_t(roundf(float(fractionalRotation * float(axesParams.getStepsPerRot(0)))));
+    int32_t stepsRelTheta = int32_t(roundf(relativePolar.getVal(0) * _kinematics._thetaStepsPerDeg));
 
     //Rho axis is a special one! Step it to rotate the gear the same degree as the theta.
     //Theta is moving relativePolar.getVal(0) degrees, therefore rho would be moving 
-    //relativePolar.getVal(0) * axesParams.getStepsPerRot(1) steps.
-    float rhoCounteractSteps = float(fractionalRotation * float(axesParams.getStepsPerRot(1)));
+    //relativePolar.getVal(0) / 360 * axesParams.getStepsPerRot(1) steps.
+    float rhoCounteractSteps = relativePolar.getVal(0) * _kinematics._rhoCouplingStepsPerDeg;
 
     //Then, rho really NEEDS to move relPolar[1] * maxLinear in mm.
     //which, mm -> steps is (mm / mm/rot) * stepsPerRot
-    
-    float rhoMM = relativePolar.getVal(1) * maxLinear;
-    float rhoActiveSteps = rhoMM * axesParams.getStepsPerUnit(1);
+    float rhoActiveSteps = relativePolar.getVal(1) * _kinematics._rhoStepsForMaxLinear;
 
     int32_t stepsRelRho = int32_t(roundf(rhoCounteractSteps + rhoActiveSteps));
 
@@ -201,20 +278,14 @@ void RobotSandTableRotary::relativePolarToSteps(AxisFloats& relativePolar, AxisP
 void RobotSandTableRotary::actuatorToPolar(AxisInt32s& actuatorCoords, AxisFloats& polarCoords, AxesParams& axesParams)
     {
         // Calculate azimuth
-        double currentTheta = AxisUtils::wrapDegrees(actuatorCoords.getVal(0) * 360 / axesParams.getStepsPerRot(0));
+        float currentTheta = AxisUtils::wrapDegrees(actuatorCoords.getVal(0) * _kinematics._thetaDegsPerStep);
         polarCoords.setVal(0, currentTheta);
 
-        float maxLinear = -1;
-        axesParams.getMaxVal(1, maxLinear);
-        if(maxLinear == -1)
-            maxLinear = 100;
-
         // Calculate linear position (note that this robot has interaction between azimuth and linear motion as the rack moves
         // if the pinion gear remains still and the arm assembly moves around it) - so the required linear calculation uses the
         // difference in linear and arm rotation steps
-        long linearStepsFromHome = actuatorCoords.getVal(1) - (float(actuatorCoords.getVal(0)) * float(axesParams.getStepsPerRot(1)/axesParams.getStepsPerRot(0)));
-        int32_t maxStepsRho = maxLinear * axesParams.getStepsPerUnit(1);
-        float currentRho = float(linearStepsFromHome) / float(maxStepsRho);
+        long linearStepsFromHome = actuatorCoords.getVal(1) - (float(actuatorCoords.getVal(0)) * _kinematics._rhoCouplingStepsPerThetaStep);
+        float currentRho = float(linearStepsFromHome) * _kinematics._rhoStepsForMaxLinearIntInv;
         polarCoords.setVal(1, currentRho);
     }
 
@@ -226,20 +297,45 @@ void RobotSandTableRotary::convertCoords(RobotCommandArgs& cmdArgs, AxesParams&
 
 void RobotSandTableRotary::setRobotAttributes(AxesParams& axesParams, String& robotAttributes)
 {
+    // The first axis is rotary (theta)
+    axesParams.setAxisRotary(0);
+
+    // Axis parameters have changed so recalculate kinematics constants
+    calcKinematicsConsts(axesParams);
+
     // Calculate max and min cartesian size of robot
-	// Calculate arm lengths
-	// The maxVal for axis0 and axis1 are used to determine the arm lengths
-	// The radius of the machine is the sum of these two lengths
-	float maxLinear = -1;
-    axesParams.getMaxVal(1, maxLinear);
-    if(maxLinear == -1)
-        maxLinear = 100;
+    float maxLinear = _kinematics._maxLinearMM;
 
     // Set attributes
     constexpr int MAX_ATTR_STR_LEN = 400;
     char attrStr[MAX_ATTR_STR_LEN];
-    sprintf(attrStr, "{\"sizeX\":%0.2f,\"sizeY\":%0.2f,\"sizeZ\":%0.2f,\"originX\":%0.2f,\"originY\":%0.2f,\"originZ\":%0.2f}",
+    sprintf(attrStr, "{\"sizeX\":%0.2f,\"sizeY\":%0.2f,\"sizeZ\":%0.2f,\"originX\":%0.2f,\"originY\":%0.2f,\"originZ\":%0.2f,\"polarMoves\":1}",
             maxLinear*2, maxLinear*2, 0.0,
             maxLinear, maxLinear, 0.0);
     robotAttributes = attrStr;
 }
+
+void RobotSandTableRotary::calcKinematicsConsts(AxesParams& axesParams)
+{
+    // The radius of the machine is the length of the linear axis
+    float maxLinear = -1;
+    axesParams.getMaxVal(1, maxLinear);
+    if (maxLinear <= 0)
+        maxLinear = 100;
+    _kinematics._maxLinearMM = maxLinear;
+    _kinematics._maxLinearMMInv = 1 / maxLinear;
+
+    // Steps
+    _kinematics._rhoStepsPerMM = axesParams.getStepsPerUnit(1);
+    _kinematics._rhoStepsForMaxLinear = maxLinear * _kinematics._rhoStepsPerMM;
+    int32_t maxStepsRho = int32_t(_kinematics._rhoStepsForMaxLinear);
+    _kinematics._rhoStepsForMaxLinearIntInv = maxStepsRho != 0 ? 1.0f / maxStepsRho : 0;
+    float thetaStepsPerRot = axesParams.getStepsPerRot(0);
+    float rhoStepsPerRot = axesParams.getStepsPerRot(1);
+    _kinematics._thetaStepsPerDeg = thetaStepsPerRot / 360;
+    _kinematics._thetaDegsPerStep = 360 / thetaStepsPerRot;
+    _kinematics._rhoCouplingStepsPerDeg = rhoStepsPerRot / 360;
+    _kinematics._rhoCouplingStepsPerThetaStep = rhoStepsPerRot / thetaStepsPerRot;
+    _kinematics._thetaStepsPerRot = int32_t(thetaStepsPerRot);
+    _kinematics._rhoStepsPerRot = int32_t(rhoStepsPerRot);
+}
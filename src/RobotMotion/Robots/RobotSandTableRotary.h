@@ -42,11 +42,21 @@ private:
     static bool ptToActuator(AxisFloats& targetPt, AxisFloats& outActuator, 
                 AxisPosition& curPos, AxesParams& axesParams, bool allowOutOfBounds);
 
+    // Convert a batch of cartesian points (one array per axis) to actuator coordinates - each point is
+    // converted relative to curPos exactly as ptToActuator would so the points are independent
+    static bool ptsToActuator(const float* const ptAxes[], float* const outActuatorAxes[], int numPts,
+                AxisPosition& curPos, AxesParams& axesParams, bool allowOutOfBounds);
+
+    // Convert a polar point (theta degrees, rho fraction of max) to actuator coordinates
+    // and also return the equivalent cartesian point
+    static bool polarToActuator(AxisFloats& targetPolar, AxisFloats& outActuator, AxisFloats& outPt,
+                AxisPosition& curPos, AxesParams& axesParams, bool allowOutOfBounds);
+
     // Convert actuator values to cartesian point
     static void actuatorToPt(AxisInt32s& targetActuator, AxisFloats& outPt,
                 AxisPosition& curPos, AxesParams& axesParams);
 
-    // Correct overflow (necessary for continuous rotation robots)
+    // Calculate the kinematics view of the steps from the absolute steps (removing whole rotations)
     static void correctStepOverflow(AxisPosition& curPos, AxesParams& axesParams);
 
     // Convert coordinates in place
@@ -56,6 +66,31 @@ private:
     static void setRobotAttributes(AxesParams& axesParams, String& robotAttributes);
 
 private:
+    // Constants used by the kinematics - these are derived from the axis parameters when the robot is
+    // configured (see setRobotAttributes) so conversions don't need to look up axis parameters or divide
+    struct KinematicsConsts
+    {
+        // Length of the linear axis in mm (and inverse)
+        float _maxLinearMM;
+        float _maxLinearMMInv;
+        // Linear axis steps per mm and steps for the full length of the linear axis
+        float _rhoStepsPerMM;
+        float _rhoStepsForMaxLinear;
+        float _rhoStepsForMaxLinearIntInv;
+        // Rotary axis steps per degree (and inverse)
+        float _thetaStepsPerDeg;
+        float _thetaDegsPerStep;
+        // Linear axis steps needed to hold rho constant when the rotary axis moves (the pinion
+        // moves along the rack as the arm rotates) - per degree and per rotary axis step
+        float _rhoCouplingStepsPerDeg;
+        float _rhoCouplingStepsPerThetaStep;
+        // Steps per rotation of each axis
+        int32_t _thetaStepsPerRot;
+        int32_t _rhoStepsPerRot;
+    };
+    static KinematicsConsts _kinematics;
+    static void calcKinematicsConsts(AxesParams& axesParams);
+
     static bool cartesianToPolar(AxisFloats& targetPt, AxisFloats& targetSoln1, AxesParams& axesParams);
     static float calcRelativePolar(float targetRotation, float curRotation);
     static void relativePolarToSteps(AxisFloats& relativePolar, AxisPosition& curAxisPositions, 
@@ -58,6 +58,14 @@ bool EvaluatorGCode::getGcodeCmdArgs(const char* pArgStr, RobotCommandArgs& cmdA
                 cmdArgs.setAxisValMM(2, strtod(++pStr, &pEndStr), true);
                 pStr = pEndStr;
                 break;
+            case 'I':
+                cmdArgs.setArcCentreOffset(0, strtod(++pStr, &pEndStr));
+                pStr = pEndStr;
+                break;
+            case 'J':
+                cmdArgs.setArcCentreOffset(1, strtod(++pStr, &pEndStr));
+                pStr = pEndStr;
+                break;
             case 'E':
                 cmdArgs.setExtrude(strtod(++pStr, &pEndStr));
                 pStr = pEndStr;
@@ -121,6 +129,14 @@ bool EvaluatorGCode::interpG(String& cmdStr, RobotController* pRobotController,
                 pRobotController->moveTo(cmdArgs);
             }
             return true;
+        case 2: // Arc clockwise
+        case 3: // Arc anticlockwise
+            if (takeAction)
+            {
+                cmdArgs.setArc(cmdNum == 2);
+                pRobotController->moveTo(cmdArgs);
+            }
+            return true;
         case 6: // Direct stepper move
             if (takeAction)
             {
@@ -6,6 +6,7 @@
 #include "EvaluatorThetaRhoLine.h"
 #include "RdJson.h"
 #include "Utils.h"
+#include "FastTrig.h"
 #include "../WorkManager.h"
 
 // #define THETA_RHO_DEBUG 1
@@ -19,8 +20,12 @@ EvaluatorThetaRhoLine::EvaluatorThetaRhoLine(WorkManager& workManager) :
     _curStep = 0;
     _stepAngle = AxisUtils::r2d(DEFAULT_STEP_ANGLE);
     _stepAdaptation = true;
-    _curTheta = 0;
-    _curRho = 0;
+    _lineStartTheta = 0;
+    _lineStartRho = 0;
+    _interpolateSteps = 0;
+    _thetaInc = 0;
+    _rhoInc = 0;
+    _thetaStartOffset = 0;
     _continueFromPrevious = true;
     _prevTheta = 0;
     _prevRho = 0;
@@ -28,6 +33,8 @@ EvaluatorThetaRhoLine::EvaluatorThetaRhoLine(WorkManager& workManager) :
     _centreOffsetX = 0;
     _centreOffsetY = 0;
     _isInterpolating = false;
+    _polarMoves = false;
+    _polarLastRho = 0;
 }
 
 void EvaluatorThetaRhoLine::setConfig(const char *configStr, const char* robotAttributes)
@@ -37,10 +44,10 @@ void EvaluatorThetaRhoLine::setConfig(const char *configStr, const char* robotAt
     _stepAdaptation = RdJson::getLong("thrStepAdaptation", 1, configStr) != 0;
     _continueFromPrevious = RdJson::getLong("thrContinue", 1, configStr) != 0;
     // Set the size of the max radius
-    double sizeX = RdJson::getDouble("sizeX", 0, robotAttributes);
-    double sizeY = RdJson::getDouble("sizeY", 0, robotAttributes);
-    double originX = RdJson::getDouble("originX", 0, robotAttributes);
-    double originY = RdJson::getDouble("originY", 0, robotAttributes);
+    float sizeX = RdJson::getDouble("sizeX", 0, robotAttributes);
+    float sizeY = RdJson::getDouble("sizeY", 0, robotAttributes);
+    float originX = RdJson::getDouble("originX", 0, robotAttributes);
+    float originY = RdJson::getDouble("originY", 0, robotAttributes);
     
     _thetaMirrored = RdJson::getLong("thrThetaMirrored", 1, configStr) != 0;
     _thetaOffsetAngle = RdJson::getLong("thrThetaOffsetAngle", 1, configStr);
@@ -48,6 +55,11 @@ void EvaluatorThetaRhoLine::setConfig(const char *configStr, const char* robotAt
     _bedRadiusMM = std::min(sizeX, sizeY) / 2;
     _centreOffsetX = sizeX / 2 - originX;
     _centreOffsetY = sizeY / 2 - originY;
+
+    // Use polar moves if the robot supports them (only valid when the bed is centred on the origin)
+    _polarMoves = (RdJson::getLong("polarMoves", 0, robotAttributes) != 0) &&
+                (RdJson::getLong("thrPolarMoves", 1, configStr) != 0) &&
+                AxisUtils::isApprox(_centreOffsetX, 0, 0.01) && AxisUtils::isApprox(_centreOffsetY, 0, 0.01);
 }
 
 // Is Busy
@@ -70,12 +82,12 @@ bool EvaluatorThetaRhoLine::isValid(WorkItem &workItem)
     return cmdStr.startsWith("_THRLINE");
 }
 
-double EvaluatorThetaRhoLine::getLineProgress() {
+float EvaluatorThetaRhoLine::getLineProgress() {
     if(!_isInterpolating) {
-        return 0.50;
+        return 0.50f;
     }
 
-    return (double) (1.00 / (double) _interpolateSteps) * (double) _curStep;
+    return float(_curStep) / _interpolateSteps;
 }
 
 // Process WorkItem
@@ -86,21 +98,15 @@ bool EvaluatorThetaRhoLine::execWorkItem(WorkItem &workItem)
     String rhoStr = Utils::getNthField(workItem.getCString(), 2, '/');
     double mirrored = _thetaMirrored ? -1.00 : 1.00;
     double newTheta = atof(thetaStr.c_str()) * mirrored + (M_PI * (_thetaOffsetAngle / 180));
-    double newRho = atof(rhoStr.c_str());
+    float newRho = atof(rhoStr.c_str());
 
     // Check for an uninterpolated line
     if (workItem.getString().startsWith("_THRLINE_"))
     {
         _isInterpolating = false;
-        // Next iteration
-        char lineBuf[100];
-        // Calculate coords
-        double x,y;
-        calcXYPos(newTheta, newRho, x, y);
-        sprintf(lineBuf, "G0 X%0.3f Y%0.3f", x, y);
-        String retStr;
-        WorkItem workItem(lineBuf);
-        _workManager.addWorkItem(workItem, retStr);
+        // Move directly to the point (after a move to the centre if needed)
+        if (!addMove(wrapThetaToTurn(newTheta), newRho))
+            addMove(wrapThetaToTurn(newTheta), newRho);
         return true;
     }
 
@@ -122,18 +128,18 @@ bool EvaluatorThetaRhoLine::execWorkItem(WorkItem &workItem)
     }
 
     // Must be a _THRLINEN_ then
-    double deltaTheta = newTheta - _thetaStartOffset - _prevTheta;
-    double absDeltaTheta = abs(deltaTheta);
-    double adaptedStepAngle = _stepAngle;
+    float deltaTheta = newTheta - _thetaStartOffset - _prevTheta;
+    float absDeltaTheta = fabsf(deltaTheta);
+    float adaptedStepAngle = _stepAngle;
     if (_stepAdaptation)
     {
-        double avgRho = std::max(fabs(newRho), fabs(_prevRho));
+        float avgRho = std::max(fabsf(newRho), fabsf(_prevRho));
         if (avgRho > 1)
             avgRho = 1;
-        double maxStepAngle = _stepAngle * 16;
-        if (maxStepAngle > M_PI / 2)
-            maxStepAngle = M_PI / 2;
-        double minStepAngle = _stepAngle / 4;
+        float maxStepAngle = _stepAngle * 16;
+        if (maxStepAngle > float(M_PI / 2))
+            maxStepAngle = float(M_PI / 2);
+        float minStepAngle = _stepAngle / 4;
         if (avgRho > RHO_AT_DEFAULT_STEP_ANGLE)
         {
             adaptedStepAngle = ((avgRho - RHO_AT_DEFAULT_STEP_ANGLE) / (1 - RHO_AT_DEFAULT_STEP_ANGLE)) * 
@@ -146,7 +152,7 @@ bool EvaluatorThetaRhoLine::execWorkItem(WorkItem &workItem)
         }
     }
     _thetaInc = deltaTheta >= 0 ? adaptedStepAngle : -adaptedStepAngle;
-    double deltaRho = newRho - _prevRho;
+    float deltaRho = newRho - _prevRho;
     if (absDeltaTheta < adaptedStepAngle)
     {
         _thetaInc = deltaTheta;
@@ -155,13 +161,13 @@ bool EvaluatorThetaRhoLine::execWorkItem(WorkItem &workItem)
     }
     else
     {
-        _interpolateSteps = int(floor(absDeltaTheta / adaptedStepAngle));
+        _interpolateSteps = int(floorf(absDeltaTheta / adaptedStepAngle));
         if (_interpolateSteps < 1)
             return true;
         _rhoInc = deltaRho * adaptedStepAngle / absDeltaTheta;
     }
-    _curTheta = _prevTheta;
-    _curRho = _prevRho;
+    _lineStartTheta = wrapThetaToTurn(_prevTheta);
+    _lineStartRho = _prevRho;
     _prevTheta = newTheta;
     _prevRho = newRho;
     _curStep = 0;
@@ -196,19 +202,10 @@ void EvaluatorThetaRhoLine::service()
         // Step
         _curStep++;
 
-        // Inc
-        _curTheta += _thetaInc;
-        _curRho += _rhoInc;
-
-        // Next iteration
-        char lineBuf[100];
-        // Calculate coords
-        double x,y;
-        calcXYPos(_curTheta, _curRho, x, y);
-        sprintf(lineBuf, "G0 X%0.3f Y%0.3f", x, y);
-        String retStr;
-        WorkItem workItem(lineBuf);
-        _workManager.addWorkItem(workItem, retStr);
+        // Next iteration - if a move to the centre was needed first then this point is added
+        // next time round
+        if (!addMove(_lineStartTheta + _curStep * _thetaInc, _lineStartRho + _curStep * _rhoInc))
+            _curStep--;
     }
 }
 
@@ -217,8 +214,51 @@ void EvaluatorThetaRhoLine::stop()
     _inProgress = false;
 }
 
-void EvaluatorThetaRhoLine::calcXYPos(double theta, double rho, double& x, double& y)
+// Returns false if a move to the centre was added instead of the point
+bool EvaluatorThetaRhoLine::addMove(float theta, float rho)
 {
-    x = sin(theta) * rho * _bedRadiusMM + _centreOffsetX;
-    y = cos(theta) * rho * _bedRadiusMM + _centreOffsetY;
-}
\ No newline at end of file
+    // Queue a typed rapid move (equivalent to G0 X Y) to avoid formatting and re-parsing GCode
+    RobotCommandArgs moveArgs;
+    bool pointAdded = true;
+    if (_polarMoves)
+    {
+        // A line which crosses the centre must go through it as the robot would otherwise
+        // interpolate round the centre between points on opposite sides
+        if (((_polarLastRho > 0) && (rho < 0)) || ((_polarLastRho < 0) && (rho > 0)))
+        {
+            rho = 0;
+            pointAdded = false;
+        }
+        _polarLastRho = rho;
+
+        // Theta-rho files measure theta clockwise from the Y axis (see calcXYPos) whereas
+        // the robot measures it anticlockwise from the X axis - negative rho is on the opposite side
+        float thetaDegs = AxisUtils::r2d(float(M_PI / 2) - theta);
+        if (rho < 0)
+        {
+            rho = -rho;
+            thetaDegs += 180;
+        }
+        moveArgs.setPointPolar(AxisUtils::wrapDegrees(thetaDegs), rho);
+    }
+    else
+    {
+        // Calculate coords
+        float x,y;
+        calcXYPos(theta, rho, x, y);
+        moveArgs.setAxisValMM(0, x, true);
+        moveArgs.setAxisValMM(1, y, true);
+    }
+    moveArgs.setMoveRapid(true);
+    String retStr;
+    _workManager.addMoveWorkItem(moveArgs, retStr);
+    return pointAdded;
+}
+
+void EvaluatorThetaRhoLine::calcXYPos(float theta, float rho, float& x, float& y)
+{
+    float sinTheta, cosTheta;
+    FastTrig::sinCosRad(theta, sinTheta, cosTheta);
+    x = sinTheta * rho * _bedRadiusMM + _centreOffsetX;
+    y = cosTheta * rho * _bedRadiusMM + _centreOffsetY;
+}
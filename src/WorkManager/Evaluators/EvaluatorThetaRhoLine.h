@@ -27,23 +27,34 @@ public:
     // Call frequently
     void service();
 
-    double getLineProgress();
+    float getLineProgress();
 
     // Control
     void stop();
 
+    // Wrap theta (which can be many turns from zero) to a single turn - this is done in double (once per
+    // line of the file) so the result is accurate to float precision
+    static float wrapThetaToTurn(double theta)
+    {
+        return float(theta - 2 * M_PI * floor(theta / (2 * M_PI)));
+    }
+
 private:
     // Config
-    const double DEFAULT_STEP_ANGLE = M_PI / 64;
-    const double RHO_AT_DEFAULT_STEP_ANGLE = 0.5;
-    double _stepAngle;
+    const float DEFAULT_STEP_ANGLE = float(M_PI / 64);
+    const float RHO_AT_DEFAULT_STEP_ANGLE = 0.5f;
+    float _stepAngle;
     bool _stepAdaptation;
     bool _continueFromPrevious;
-    double _bedRadiusMM;
-    double _centreOffsetX;
-    double _centreOffsetY;
-    double _thetaOffsetAngle;
+    float _bedRadiusMM;
+    float _centreOffsetX;
+    float _centreOffsetY;
+    float _thetaOffsetAngle;
     bool _thetaMirrored;
+    // Send theta-rho to the robot without conversion to cartesian
+    bool _polarMoves;
+    // Rho (signed) of the last polar move
+    float _polarLastRho;
 
     // Work manager
     WorkManager& _workManager;
@@ -51,21 +62,25 @@ private:
     // Pattern in progress
     bool _inProgress;
 
-    // Pattern vars
+    // Pattern vars - theta from the file grows without limit through a pattern so it is kept in double
+    // but this is only used once per line of the file - points interpolated along a line are calculated
+    // in float from the start of the line (wrapped to one turn) and the step number so errors don't
+    // accumulate from point to point
     bool _isInterpolating;
-    double _curTheta;
-    double _curRho;
+    float _lineStartTheta;
+    float _lineStartRho;
     int _interpolateSteps;
     int _curStep;
-    double _thetaInc;
-    double _rhoInc;
+    float _thetaInc;
+    float _rhoInc;
     double _thetaStartOffset;
     double _prevTheta;
-    double _prevRho;
+    float _prevRho;
 
     // Process steps per service
     static const int PROCESS_STEPS_PER_SERVICE = 20;
 
-    void calcXYPos(double theta, double rho, double& x, double& y);
+    void calcXYPos(float theta, float rho, float& x, float& y);
+    bool addMove(float theta, float rho);
 
 };
\ No newline at end of file
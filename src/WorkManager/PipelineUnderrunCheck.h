@@ -0,0 +1,46 @@
+// RBotFirmware
+// Rob Dobson 2016-2018
+
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Counts pipeline underruns - motion stopping while there is still work to do
+// The motion pipeline also empties between the moves of a homing sequence (the next homing move
+// isn't added until the previous one has completed) while the work queue holds everything queued
+// behind the home command - these gaps aren't underruns so they aren't counted
+class PipelineUnderrunCheck
+{
+private:
+    bool _robotWasIdle;
+    bool _robotWasHoming;
+    std::atomic<uint32_t> _underrunCount;
+
+public:
+    PipelineUnderrunCheck()
+    {
+        _robotWasIdle = true;
+        _robotWasHoming = false;
+        _underrunCount = 0;
+    }
+
+    // Call after each service of the robot - returns true if an underrun has just occurred
+    bool check(bool robotIdle, bool robotHoming, bool workPending)
+    {
+        // Homing ends in the service in which its last move completes so the previous state
+        // is checked too
+        bool underrun = robotIdle && !_robotWasIdle && !robotHoming && !_robotWasHoming && workPending;
+        if (underrun)
+            _underrunCount++;
+        _robotWasIdle = robotIdle;
+        _robotWasHoming = robotHoming;
+        return underrun;
+    }
+
+    // Get count (can be called from any task)
+    uint32_t getCount()
+    {
+        return _underrunCount;
+    }
+};
@@ -3,10 +3,18 @@
 
 #pragma once
 
+#include <memory>
+#include "RobotCommandArgs.h"
+
 class WorkItem
 {
 private:
     String _str;
+    // Move items carry their target directly so that evaluators which generate
+    // many points (e.g. theta-rho) don't need to format and re-parse GCode - the
+    // args are held out of line so that text items (and the work item queue) stay
+    // small and copies of a move item (e.g. when peeking the queue) share them
+    std::shared_ptr<RobotCommandArgs> _pMoveArgs;
 
 public:
     WorkItem()
@@ -24,6 +32,11 @@ public:
         _str = cmdStr;
     }
 
+    WorkItem(const RobotCommandArgs& moveArgs) : _pMoveArgs(std::make_shared<RobotCommandArgs>(moveArgs))
+    {
+        _str = "";
+    }
+
     const char* getCString()
     {
         return _str.c_str();
@@ -33,4 +46,15 @@ public:
     {
         return _str;
     }
+
+    bool isMove()
+    {
+        return _pMoveArgs != nullptr;
+    }
+
+    // Only valid for move items
+    RobotCommandArgs& getMoveArgs()
+    {
+        return *_pMoveArgs;
+    }
 };
@@ -59,6 +59,12 @@ public:
 
     // Add to queue
     bool add(const char* pWorkItemStr)
+    {
+        return add(WorkItem(pWorkItemStr));
+    }
+
+    // Add to queue
+    bool add(const WorkItem& workItem)
     {
         // Check if queue is full
         if (_workItemQueue.size() >= _workItemQueueMaxLen)
@@ -68,7 +74,7 @@ public:
         }
 
         // Queue up the item
-        _workItemQueue.push(WorkItem(pWorkItemStr));
+        _workItemQueue.push(workItem);
         return true;
     }
 
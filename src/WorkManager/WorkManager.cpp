@@ -11,6 +11,10 @@
 
 static const char *MODULE_PREFIX = "WorkManager: ";
 
+// Commands which are executed immediately rather than being queued as work items
+static const char *IMMEDIATE_COMMANDS[] = {"pause",    "sleep",          "resume",          "playpause",     "stop",          "seq_next",
+                                           "seq_prev", "seq_shuffle_on", "seq_shuffle_off", "seq_repeat_on", "seq_repeat_off"};
+
 WorkManager::WorkManager(ConfigBase &mainConfig, ConfigBase &robotConfig, RobotController &robotController, LedStrip &ledStrip, WireGuardManager &wireGuardManager,
                          RestAPISystem &restAPISystem, FileManager &fileManager)
     : _systemConfig(mainConfig),
@@ -25,11 +29,30 @@ WorkManager::WorkManager(ConfigBase &mainConfig, ConfigBase &robotConfig, RobotC
       _evaluatorThetaRhoLine(*this) {
     _statusReportLastCheck = 0;
     _statusLastHashVal = 0;
+    _motionTaskHandle = NULL;
+    _commandQueue = xQueueCreate(COMMAND_QUEUE_LEN, sizeof(CommandQueueMsg));
+    _immediateCommandQueue = xQueueCreate(IMMEDIATE_COMMAND_QUEUE_LEN, sizeof(CommandQueueMsg));
+    _motionTaskMutex = xSemaphoreCreateMutex();
+    _commandSeq = 0;
+    _commandCurSeq = 0;
+    _commandDiscardBeforeSeq = 0;
 #ifdef DEBUG_WORK_ITEM_SERVICE
     _debugLastWorkServiceMs = 0;
 #endif
 }
 
+void WorkManager::queryISRStats(String &respStr, bool reset) {
+    respStr = "\"isr\":" + _robotController.getISRStatsJSON(reset);
+    respStr += ",\"underruns\":" + String(_pipelineUnderrunCheck.getCount());
+}
+
+void WorkManager::getCurPositionMM(AxisFloats &curPosMM) {
+    // The conversion to mm uses the kinematics state of the motion task
+    motionTaskLock();
+    _robotController.getCurPositionMM(curPosMM);
+    motionTaskUnlock();
+}
+
 void WorkManager::queryStatus(String &respStr) {
     String innerJsonStr;
     int hashUsedBits = 0;
@@ -39,8 +62,10 @@ void WorkManager::queryStatus(String &respStr) {
     if ((innerJsonStr.length() > 0) && (healthStrSystem.length() > 0)) innerJsonStr += ",";
     innerJsonStr += healthStrSystem;
     // Robot info
+    motionTaskLock();
     RobotCommandArgs cmdArgs;
     _robotController.getCurStatus(cmdArgs);
+    motionTaskUnlock();
     String healthStrRobot = cmdArgs.toJSON(false);
     if ((innerJsonStr.length() > 0) && (healthStrRobot.length() > 0)) innerJsonStr += ",";
     innerJsonStr += healthStrRobot;
@@ -61,6 +86,7 @@ void WorkManager::queryStatus(String &respStr) {
         innerJsonStr += timeJsonStr;
     }
 
+    motionTaskLock();
     if (_evaluatorSequences.isBusy()) {
         innerJsonStr += ",\"playlist\": true, \"playlistName\": \"";
         innerJsonStr += _evaluatorSequences.fileName();
@@ -90,14 +116,28 @@ void WorkManager::queryStatus(String &respStr) {
         innerJsonStr += ",\"fileLen\": ";
         innerJsonStr += String(_evaluatorFiles.getTotalFileLength());
     }
+    motionTaskUnlock();
+
+    innerJsonStr += ",\"underruns\":";
+    innerJsonStr += String(_pipelineUnderrunCheck.getCount());
 
     // System information
     respStr = "{" + innerJsonStr + "}";
 }
 
-bool WorkManager::canAcceptWorkItem() { return !_workItemQueue.isFull(); }
+bool WorkManager::canAcceptWorkItem() {
+    motionTaskLock();
+    bool canAccept = !_workItemQueue.isFull();
+    motionTaskUnlock();
+    return canAccept;
+}
 
-bool WorkManager::queueIsEmpty() { return _workItemQueue.isEmpty(); }
+bool WorkManager::queueIsEmpty() {
+    motionTaskLock();
+    bool isEmpty = _workItemQueue.isEmpty();
+    motionTaskUnlock();
+    return isEmpty && (uxQueueMessagesWaiting(_commandQueue) == 0);
+}
 
 void WorkManager::getRobotConfig(String &respStr) { respStr = _robotConfig.getConfigString(); }
 
@@ -131,10 +171,35 @@ bool WorkManager::setRobotConfig(const uint8_t *pData, int len) {
 }
 
 void WorkManager::processSingle(const char *pCmdStr, String &retStr) {
-    const char *okRslt = "{\"rslt\":\"ok\"}";
     retStr = "{\"rslt\":\"none\"}";
 
+    // Commands from other tasks are passed to the motion task
+    if (!inMotionTask()) {
+        if (strlen(pCmdStr) != 0) {
+            WorkItem workItem(pCmdStr);
+            commandQueuePost(workItem, retStr);
+        }
+        return;
+    }
+
     // Check if this is an immediate command
+    if (execImmediateCommand(pCmdStr, retStr)) return;
+
+    // Send the line to the workflow manager
+    if (strlen(pCmdStr) != 0) {
+        bool rslt = _workItemQueue.add(pCmdStr);
+        if (!rslt) {
+            retStr = "{\"rslt\":\"busy\"}";
+            Log.verbose("%sprocessSingle failed to add\n", MODULE_PREFIX);
+        } else {
+            retStr = "{\"rslt\":\"ok\"}";
+        }
+    }
+    // Log.verbose("%sprocSingle rslt %s\n", MODULE_PREFIX, retStr.c_str());
+}
+
+bool WorkManager::execImmediateCommand(const char *pCmdStr, String &retStr) {
+    const char *okRslt = "{\"rslt\":\"ok\"}";
     if (strcasecmp(pCmdStr, "pause") == 0) {
         _robotController.pause(true);
         retStr = okRslt;
@@ -153,6 +218,7 @@ void WorkManager::processSingle(const char *pCmdStr, String &retStr) {
     } else if (strcasecmp(pCmdStr, "stop") == 0) {
         _robotController.stop();
         _workItemQueue.clear();
+        _commandDiscardBeforeSeq = _commandCurSeq;
         evaluatorsStop();
         retStr = okRslt;
     } else if (strcasecmp(pCmdStr, "seq_next") == 0) {
@@ -161,6 +227,7 @@ void WorkManager::processSingle(const char *pCmdStr, String &retStr) {
             _evaluatorThetaRhoLine.stop();
             _evaluatorFiles.stop();
             _workItemQueue.clear();
+            _commandDiscardBeforeSeq = _commandCurSeq;
             retStr = okRslt;
         }
     } else if (strcasecmp(pCmdStr, "seq_prev") == 0) {
@@ -169,6 +236,7 @@ void WorkManager::processSingle(const char *pCmdStr, String &retStr) {
             _evaluatorThetaRhoLine.stop();
             _evaluatorFiles.stop();
             _workItemQueue.clear();
+            _commandDiscardBeforeSeq = _commandCurSeq;
             _evaluatorSequences.loadPrevious();
             retStr = okRslt;
         }
@@ -193,18 +261,59 @@ void WorkManager::processSingle(const char *pCmdStr, String &retStr) {
             retStr = okRslt;
         }
     } else {
-        // Send the line to the workflow manager
-        if (strlen(pCmdStr) != 0) {
-            bool rslt = _workItemQueue.add(pCmdStr);
-            if (!rslt) {
-                retStr = "{\"rslt\":\"busy\"}";
-                Log.verbose("%sprocessSingle failed to add\n", MODULE_PREFIX);
-            } else {
-                retStr = okRslt;
-            }
+        return false;
+    }
+    return true;
+}
+
+bool WorkManager::isImmediateCommand(WorkItem &workItem) {
+    if (workItem.isMove()) return false;
+    for (const char *pImmCmd : IMMEDIATE_COMMANDS)
+        if (strcasecmp(workItem.getCString(), pImmCmd) == 0) return true;
+    return false;
+}
+
+void WorkManager::commandQueuePost(WorkItem &workItem, String &retStr) {
+    // The motion task takes ownership of the work item
+    CommandQueueMsg msg;
+    msg.pWorkItem = new WorkItem(workItem);
+    if (!msg.pWorkItem) return;
+    msg.seq = ++_commandSeq;
+    QueueHandle_t queue = isImmediateCommand(workItem) ? _immediateCommandQueue : _commandQueue;
+    if (xQueueSendToBack(queue, &msg, 0) != pdTRUE) {
+        delete msg.pWorkItem;
+        retStr = "{\"rslt\":\"busy\"}";
+        Log.verbose("%scommandQueuePost failed to add\n", MODULE_PREFIX);
+        return;
+    }
+    retStr = "{\"rslt\":\"ok\"}";
+}
+
+void WorkManager::commandQueueService() {
+    // Immediate commands
+    CommandQueueMsg msg;
+    String retStr;
+    while (xQueueReceive(_immediateCommandQueue, &msg, 0) == pdTRUE) {
+        _commandCurSeq = msg.seq;
+        processSingle(msg.pWorkItem->getCString(), retStr);
+        delete msg.pWorkItem;
+    }
+
+    // Other commands wait in the queue while the work item queue is full - those queued before
+    // a stop are discarded
+    while (xQueuePeek(_commandQueue, &msg, 0) == pdTRUE) {
+        bool discard = (int32_t)(msg.seq - _commandDiscardBeforeSeq) < 0;
+        if (!discard && _workItemQueue.isFull()) break;
+        xQueueReceive(_commandQueue, &msg, 0);
+        if (!discard) {
+            _commandCurSeq = msg.seq;
+            if (msg.pWorkItem->isMove())
+                addMoveWorkItem(msg.pWorkItem->getMoveArgs(), retStr);
+            else
+                processSingle(msg.pWorkItem->getCString(), retStr);
         }
+        delete msg.pWorkItem;
     }
-    // Log.verbose("%sprocSingle rslt %s\n", MODULE_PREFIX, retStr.c_str());
 }
 
 void WorkManager::addWorkItem(WorkItem &workItem, String &retStr, int cmdIdx) {
@@ -246,7 +355,27 @@ void WorkManager::addWorkItem(WorkItem &workItem, String &retStr, int cmdIdx) {
     }
 }
 
+void WorkManager::addMoveWorkItem(RobotCommandArgs &moveArgs, String &retStr) {
+    // Moves from other tasks are passed to the motion task
+    if (!inMotionTask()) {
+        WorkItem workItem(moveArgs);
+        commandQueuePost(workItem, retStr);
+        return;
+    }
+
+    // Queue the move in order with any other work items
+    if (!_workItemQueue.add(WorkItem(moveArgs))) {
+        retStr = "{\"rslt\":\"busy\"}";
+        Log.verbose("%saddMoveWorkItem failed to add\n", MODULE_PREFIX);
+        return;
+    }
+    retStr = "{\"rslt\":\"ok\"}";
+}
+
 bool WorkManager::canBeProcessed(WorkItem &workItem) {
+    // Moves go straight to the robot
+    if (workItem.isMove()) return _robotController.canAcceptCommand();
+
     // See if it is a theta-rho evaluator work item
     if (_evaluatorThetaRhoLine.isValid(workItem)) return !_evaluatorThetaRhoLine.isBusy();
 
@@ -284,6 +413,9 @@ bool WorkManager::execWorkItem(WorkItem &workItem) {
 }
 
 void WorkManager::service() {
+    // Handle commands from other tasks
+    commandQueueService();
+
     // Pump the workflow here
     // Check if the RobotController can accept more
     if (_robotController.canAcceptCommand()) {
@@ -295,11 +427,16 @@ void WorkManager::service() {
             if (canBeProcessed(workItem)) {
                 rslt = _workItemQueue.get(workItem);
                 if (rslt) {
-                    // Check for extended commands
-                    rslt = execWorkItem(workItem);
-
-                    // Check for GCode
-                    if (!rslt) EvaluatorGCode::interpretGcode(workItem, &_robotController, true);
+                    // Typed moves don't need interpreting
+                    if (workItem.isMove()) {
+                        _robotController.moveTo(workItem.getMoveArgs());
+                    } else {
+                        // Check for extended commands
+                        rslt = execWorkItem(workItem);
+
+                        // Check for GCode
+                        if (!rslt) EvaluatorGCode::interpretGcode(workItem, &_robotController, true);
+                    }
                 }
             }
         }
@@ -307,6 +444,48 @@ void WorkManager::service() {
 
     // Service evaluators
     evaluatorsService();
+
+    // Service the robot
+    _robotController.service();
+
+    // Check for a pipeline underrun - motion stopping while there is more work to do
+    if (_pipelineUnderrunCheck.check(_robotController.isIdle(), _robotController.isHoming(),
+                                     evaluatorsBusy(true) || !_workItemQueue.isEmpty())) {
+        Log.notice("%spipeline underrun count %d\n", MODULE_PREFIX, _pipelineUnderrunCheck.getCount());
+    }
+}
+
+void WorkManager::startMotionTask() {
+    if (_motionTaskHandle) return;
+    xTaskCreatePinnedToCore(motionTaskFn, "Motion", MOTION_TASK_STACK_SIZE, this, MOTION_TASK_PRIORITY, &_motionTaskHandle,
+                            MOTION_TASK_CORE_NUM);
+    Log.notice("%smotion task started core %d priority %d\n", MODULE_PREFIX, MOTION_TASK_CORE_NUM, MOTION_TASK_PRIORITY);
+}
+
+void WorkManager::motionTaskFn(void *pParam) {
+    WorkManager *pWorkManager = (WorkManager *)pParam;
+    for (;;) {
+        for (int i = 0; i < MOTION_TASK_SERVICE_LOOPS; i++) {
+            xSemaphoreTake(pWorkManager->_motionTaskMutex, portMAX_DELAY);
+            pWorkManager->service();
+            xSemaphoreGive(pWorkManager->_motionTaskMutex);
+        }
+        // Let lower priority tasks run
+        vTaskDelay(1);
+    }
+}
+
+bool WorkManager::inMotionTask() {
+    // Before the motion task is started everything runs in the main task
+    return (_motionTaskHandle == NULL) || (xTaskGetCurrentTaskHandle() == _motionTaskHandle);
+}
+
+void WorkManager::motionTaskLock() {
+    if (!inMotionTask()) xSemaphoreTake(_motionTaskMutex, portMAX_DELAY);
+}
+
+void WorkManager::motionTaskUnlock() {
+    if (!inMotionTask()) xSemaphoreGive(_motionTaskMutex);
 }
 
 void WorkManager::reconfigure() {
@@ -336,12 +515,14 @@ void WorkManager::reconfigure() {
     }
 
     // Init robot controller and workflow manager
+    motionTaskLock();
     _robotController.init(robotConfigStr.c_str());
     _workItemQueue.init(robotConfigStr.c_str(), "workItemQueue");
     // Set config into evaluators
     String robotAttributes;
     _robotController.getRobotAttributes(robotAttributes);
     evaluatorsSetConfig(robotConfigStr.c_str(), "evaluators", robotAttributes.c_str());
+    motionTaskUnlock();
 }
 
 void WorkManager::handleStartupCommands() {
@@ -414,8 +595,10 @@ bool WorkManager::checkStatusChanged() {
     _restAPISystem.reportHealth(0, &statusNewHash, NULL);
 
     // Check for robot status changes
+    motionTaskLock();
     RobotCommandArgs cmdArgs;
     _robotController.getCurStatus(cmdArgs);
+    motionTaskUnlock();
 
     // Check if anything changed
     statusChanged |= (_statusLastHashVal != statusNewHash) | (_statusLastCmdArgs != cmdArgs);
@@ -429,7 +612,11 @@ bool WorkManager::checkStatusChanged() {
 }
 
 String WorkManager::getDebugStr() {
+    motionTaskLock();
     String returnStr = (_workItemQueue.isFull() ? " QFULL:" : " QOK:");
     returnStr += _workItemQueue.size();
+    motionTaskUnlock();
+    returnStr += " UNDERRUNS:";
+    returnStr += String(_pipelineUnderrunCheck.getCount());
     return returnStr;
 }
@@ -6,6 +6,7 @@
 // #define DEBUG_WORK_ITEM_SERVICE 1
 
 #include <Arduino.h>
+#include <atomic>
 
 #include "Evaluators/EvaluatorFiles.h"
 #include "Evaluators/EvaluatorSequences.h"
@@ -13,6 +14,7 @@
 #include "LedStrip.h"
 #include "RobotCommandArgs.h"
 #include "WorkItemQueue.h"
+#include "PipelineUnderrunCheck.h"
 #include "WireGuardManager.h"
 
 class ConfigBase;
@@ -47,6 +49,43 @@ class WorkManager {
     // A status update will always be sent (even if no change) after this time
     const unsigned long STATUS_ALWAYS_UPDATE_MS = 10000;
 
+    // Motion task - work items, evaluators and the robot controller are serviced in a high priority
+    // task so that slow processing in the main loop (WiFi, status reports, etc) can't starve the
+    // motion pipeline - other tasks pass commands to the motion task through queues (immediate
+    // commands such as stop have their own queue so they aren't held up behind other commands)
+    TaskHandle_t _motionTaskHandle;
+    QueueHandle_t _commandQueue;
+    QueueHandle_t _immediateCommandQueue;
+    SemaphoreHandle_t _motionTaskMutex;
+    // The motion task shares core 1 with loop() and preempts it (loop() runs at priority 1) - core 0
+    // runs the WiFi and TCP/IP tasks at higher priorities than any application task so the motion
+    // task would be preempted by network traffic there - define MOTION_TASK_CORE to override
+#ifdef MOTION_TASK_CORE
+    static const int MOTION_TASK_CORE_NUM = MOTION_TASK_CORE;
+#else
+    static const int MOTION_TASK_CORE_NUM = 1;
+#endif
+    static const int MOTION_TASK_PRIORITY = 3;
+    static const int MOTION_TASK_STACK_SIZE = 8192;
+    // Number of services between each task delay (of one tick)
+    static const int MOTION_TASK_SERVICE_LOOPS = 10;
+    static const int COMMAND_QUEUE_LEN = 20;
+    static const int IMMEDIATE_COMMAND_QUEUE_LEN = 10;
+
+    // Commands passed through the queues - the sequence number is used to discard commands
+    // which were queued before a stop
+    struct CommandQueueMsg
+    {
+        WorkItem* pWorkItem;
+        uint32_t seq;
+    };
+    std::atomic<uint32_t> _commandSeq;
+    uint32_t _commandCurSeq;
+    uint32_t _commandDiscardBeforeSeq;
+
+    // Pipeline underruns - motion stopped while there was still work to do
+    PipelineUnderrunCheck _pipelineUnderrunCheck;
+
     // Debug
 #ifdef DEBUG_WORK_ITEM_SERVICE
     uint32_t _debugLastWorkServiceMs;
@@ -57,15 +96,24 @@ class WorkManager {
     WorkManager(ConfigBase& mainConfig, ConfigBase& robotConfig, RobotController& robotController, LedStrip& ledStrip, WireGuardManager &wireGuardManager, RestAPISystem& restAPISystem,
                 FileManager& fileManager);
 
-    // Check if queue can accept a work item
+    // Check if queue can accept a work item (can be called from any task)
     bool canAcceptWorkItem();
 
-    // Queue info
+    // Queue info (can be called from any task)
     bool queueIsEmpty();
 
-    // Call frequently to pump the queue
+    // Call frequently to pump the queue - this is called from the motion task once started
     void service();
 
+    // Start the motion task
+    void startMotionTask();
+
+    // Pipeline underruns
+    uint32_t getPipelineUnderrunCount()
+    {
+        return _pipelineUnderrunCheck.getCount();
+    }
+
     // Configuration of the robot
     void getRobotConfig(String& respStr);
     void getLedStripConfig(String& respStr);
@@ -81,9 +129,18 @@ class WorkManager {
     // Get status report
     void queryStatus(String& respStr);
 
+    // Get motion ISR timing statistics
+    void queryISRStats(String& respStr, bool reset);
+
+    // Get current position in mm
+    void getCurPositionMM(AxisFloats& curPosMM);
+
     // Add a work item to the queue
     void addWorkItem(WorkItem& workItem, String& retStr, int cmdIdx = -1);
 
+    // Add a move to the queue (bypasses GCode formatting and parsing)
+    void addMoveWorkItem(RobotCommandArgs& moveArgs, String& retStr);
+
     // Check status changed
     bool checkStatusChanged();
 
@@ -91,6 +148,22 @@ class WorkManager {
     String getDebugStr();
 
    private:
+    // Motion task
+    static void motionTaskFn(void* pParam);
+    bool inMotionTask();
+
+    // Lock out the motion task while accessing the robot and evaluators from another task
+    void motionTaskLock();
+    void motionTaskUnlock();
+
+    // Command queues
+    void commandQueuePost(WorkItem& workItem, String& retStr);
+    void commandQueueService();
+    static bool isImmediateCommand(WorkItem& workItem);
+
+    // Execute an immediate command (e.g. pause, stop) - returns false if not an immediate command
+    bool execImmediateCommand(const char* pCmdStr, String& retStr);
+
     // Execute an item of work
     bool execWorkItem(WorkItem& workItem);
 
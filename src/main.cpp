@@ -266,6 +266,9 @@ void setup() {
     // Handle statup commands
     _workManager.handleStartupCommands();
 
+    // Motion (work items, evaluators and robot control) runs in its own task from here on
+    _workManager.startMotionTask();
+
     // Service LED strip.
     xTaskCreatePinnedToCore(ledTaskFunc, /* Function to implement the task */
                             "Task1",     /* Name of the task */
@@ -294,20 +297,17 @@ void loop() {
     if (_workManager.checkStatusChanged()) {
         // Send changed status
         String newStatus;
-        _workManager.queueIsEmpty();
         _workManager.queryStatus(newStatus);
         webServer.webSocketSend((uint8_t*)newStatus.c_str(), newStatus.length());
         webServer.sendAsyncEvent(newStatus.c_str(), "status");
     }
 
     commandScheduler.service();
-    _workManager.service();
-    _robotController.service();
 
     // Give the LED strip our current position in x,y
-    RobotCommandArgs args;
-    _robotController.getCurStatus(args);
-    ledStrip.service(args.getPointMM().getVal(0), args.getPointMM().getVal(1));
+    AxisFloats curPosMM;
+    _workManager.getCurPositionMM(curPosMM);
+    ledStrip.service(curPosMM.getVal(0), curPosMM.getVal(1));
 }
 
 #endif  // UNIT_TEST
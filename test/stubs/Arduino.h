@@ -0,0 +1,94 @@
+// RBotFirmware
+// Host (native) stand-in for the Arduino core used by the unit tests
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <algorithm>
+#include <cmath>
+#include "WString.h"
+#include "ArduinoLog.h"
+
+using std::abs;
+using std::isinf;
+using std::isnan;
+using std::max;
+using std::min;
+
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+
+#ifndef PI
+#define PI 3.1415926535897932384626433832795
+#endif
+#define radians(deg) ((deg) * (PI / 180.0))
+#define degrees(rad) ((rad) * (180.0 / PI))
+#define sq(x) ((x) * (x))
+
+// Virtual time and pins - tests advance the clock and can watch pin writes (e.g. to count steps)
+class NativeHw
+{
+public:
+    static constexpr int MAX_PINS = 64;
+    static inline uint64_t _curUs = 0;
+    static inline uint8_t _pinLevels[MAX_PINS] = {};
+    static inline void (*_pinWriteCb)(int pin, bool level) = nullptr;
+
+    static void reset()
+    {
+        _curUs = 0;
+        memset(_pinLevels, 0, sizeof(_pinLevels));
+        _pinWriteCb = nullptr;
+    }
+    static void advanceUs(uint64_t us)
+    {
+        _curUs += us;
+    }
+};
+
+inline unsigned long millis()
+{
+    return (unsigned long)(NativeHw::_curUs / 1000);
+}
+inline unsigned long micros()
+{
+    return (unsigned long)NativeHw::_curUs;
+}
+inline void delay(unsigned long ms)
+{
+    NativeHw::advanceUs(ms * 1000);
+}
+inline void delayMicroseconds(unsigned int us)
+{
+    NativeHw::advanceUs(us);
+}
+inline void pinMode(int pin, int mode)
+{
+}
+inline void digitalWrite(int pin, int level)
+{
+    if ((pin < 0) || (pin >= NativeHw::MAX_PINS))
+        return;
+    NativeHw::_pinLevels[pin] = level ? 1 : 0;
+    if (NativeHw::_pinWriteCb)
+        NativeHw::_pinWriteCb(pin, level != 0);
+}
+inline int digitalRead(int pin)
+{
+    if ((pin < 0) || (pin >= NativeHw::MAX_PINS))
+        return 0;
+    return NativeHw::_pinLevels[pin];
+}
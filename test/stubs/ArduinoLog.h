@@ -0,0 +1,18 @@
+// RBotFirmware
+// Host (native) stand-in for ArduinoLog - output is discarded
+
+#pragma once
+
+class NativeLogging
+{
+public:
+    template <typename... Args> void fatal(Args...) {}
+    template <typename... Args> void error(Args...) {}
+    template <typename... Args> void warning(Args...) {}
+    template <typename... Args> void notice(Args...) {}
+    template <typename... Args> void info(Args...) {}
+    template <typename... Args> void trace(Args...) {}
+    template <typename... Args> void verbose(Args...) {}
+};
+
+static NativeLogging Log;
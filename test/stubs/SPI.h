@@ -0,0 +1,4 @@
+// RBotFirmware
+// Host (native) stand-in for the Arduino SPI header
+
+#pragma once
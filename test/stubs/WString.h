@@ -0,0 +1,155 @@
+// RBotFirmware
+// Host (native) stand-in for the Arduino String class (the subset used by the firmware)
+
+#pragma once
+
+#include <string>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class String
+{
+private:
+    std::string _s;
+
+    static std::string fromLong(long long val, unsigned char base)
+    {
+        if (base == 10)
+            return std::to_string(val);
+        return fromULong((unsigned long long)val, base);
+    }
+    static std::string fromULong(unsigned long long val, unsigned char base)
+    {
+        if (base < 2 || base > 16)
+            base = 10;
+        std::string out;
+        do
+        {
+            out.insert(out.begin(), "0123456789abcdef"[val % base]);
+            val /= base;
+        } while (val);
+        return out;
+    }
+    static std::string fromDouble(double val, unsigned char decimalPlaces)
+    {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", decimalPlaces, val);
+        return buf;
+    }
+
+public:
+    String(const char *cstr = "") : _s(cstr ? cstr : "") {}
+    String(const std::string &str) : _s(str) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(unsigned char val, unsigned char base = 10) : _s(fromULong(val, base)) {}
+    explicit String(int val, unsigned char base = 10) : _s(fromLong(val, base)) {}
+    explicit String(unsigned int val, unsigned char base = 10) : _s(fromULong(val, base)) {}
+    explicit String(long val, unsigned char base = 10) : _s(fromLong(val, base)) {}
+    explicit String(unsigned long val, unsigned char base = 10) : _s(fromULong(val, base)) {}
+    explicit String(long long val, unsigned char base = 10) : _s(fromLong(val, base)) {}
+    explicit String(unsigned long long val, unsigned char base = 10) : _s(fromULong(val, base)) {}
+    explicit String(float val, unsigned char decimalPlaces = 2) : _s(fromDouble(val, decimalPlaces)) {}
+    explicit String(double val, unsigned char decimalPlaces = 2) : _s(fromDouble(val, decimalPlaces)) {}
+
+    const char *c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.length(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    char charAt(unsigned int idx) const { return idx < _s.length() ? _s[idx] : 0; }
+    void setCharAt(unsigned int idx, char c) { if (idx < _s.length()) _s[idx] = c; }
+    char operator[](unsigned int idx) const { return charAt(idx); }
+    char &operator[](unsigned int idx) { return _s[idx]; }
+
+    bool concat(const String &str) { _s += str._s; return true; }
+    bool concat(const char *cstr) { if (cstr) _s += cstr; return true; }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(int val) { _s += fromLong(val, 10); return true; }
+    bool concat(unsigned int val) { _s += fromULong(val, 10); return true; }
+    bool concat(long val) { _s += fromLong(val, 10); return true; }
+    bool concat(unsigned long val) { _s += fromULong(val, 10); return true; }
+    bool concat(double val) { _s += fromDouble(val, 2); return true; }
+    template <typename T> String &operator+=(const T &val) { concat(val); return *this; }
+
+    bool equals(const String &str) const { return _s == str._s; }
+    bool equals(const char *cstr) const { return _s == (cstr ? cstr : ""); }
+    bool equalsIgnoreCase(const String &str) const { return strcasecmp(_s.c_str(), str.c_str()) == 0; }
+    bool operator==(const String &str) const { return equals(str); }
+    bool operator==(const char *cstr) const { return equals(cstr); }
+    bool operator!=(const String &str) const { return !equals(str); }
+    bool operator!=(const char *cstr) const { return !equals(cstr); }
+    bool operator<(const String &str) const { return _s < str._s; }
+    bool startsWith(const String &prefix) const { return _s.compare(0, prefix._s.length(), prefix._s) == 0; }
+    bool endsWith(const String &suffix) const
+    {
+        return (_s.length() >= suffix._s.length()) &&
+               (_s.compare(_s.length() - suffix._s.length(), suffix._s.length(), suffix._s) == 0);
+    }
+
+    int indexOf(char c, unsigned int fromIdx = 0) const
+    {
+        size_t pos = _s.find(c, fromIdx);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    int indexOf(const String &str, unsigned int fromIdx = 0) const
+    {
+        size_t pos = _s.find(str._s, fromIdx);
+        return pos == std::string::npos ? -1 : (int)pos;
+    }
+    String substring(unsigned int beginIdx) const
+    {
+        return beginIdx < _s.length() ? String(_s.substr(beginIdx)) : String();
+    }
+    String substring(unsigned int beginIdx, unsigned int endIdx) const
+    {
+        if (beginIdx > endIdx)
+            std::swap(beginIdx, endIdx);
+        if (beginIdx >= _s.length())
+            return String();
+        return String(_s.substr(beginIdx, endIdx - beginIdx));
+    }
+    void replace(char find, char replaceWith)
+    {
+        for (char &c : _s)
+            if (c == find)
+                c = replaceWith;
+    }
+    void replace(const String &find, const String &replaceWith)
+    {
+        if (find._s.empty())
+            return;
+        size_t pos = 0;
+        while ((pos = _s.find(find._s, pos)) != std::string::npos)
+        {
+            _s.replace(pos, find._s.length(), replaceWith._s);
+            pos += replaceWith._s.length();
+        }
+    }
+    void remove(unsigned int idx) { if (idx < _s.length()) _s.erase(idx); }
+    void remove(unsigned int idx, unsigned int count) { if (idx < _s.length()) _s.erase(idx, count); }
+    void trim()
+    {
+        size_t first = _s.find_first_not_of(" \t\r\n");
+        size_t last = _s.find_last_not_of(" \t\r\n");
+        _s = (first == std::string::npos) ? std::string() : _s.substr(first, last - first + 1);
+    }
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int idx = 0) const
+    {
+        if (!buf || bufsize == 0)
+            return;
+        std::string part = idx < _s.length() ? _s.substr(idx, bufsize - 1) : std::string();
+        memcpy(buf, part.c_str(), part.length() + 1);
+    }
+    long toInt() const { return atol(_s.c_str()); }
+    float toFloat() const { return (float)atof(_s.c_str()); }
+    double toDouble() const { return atof(_s.c_str()); }
+
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs._s + rhs._s); }
+    friend String operator+(const String &lhs, const char *rhs) { return String(lhs._s + (rhs ? rhs : "")); }
+    friend String operator+(const char *lhs, const String &rhs) { return String((lhs ? lhs : "") + rhs._s); }
+    friend String operator+(const String &lhs, char rhs) { return String(lhs._s + rhs); }
+};
@@ -0,0 +1,119 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// End-stop pin mask tests
+// The pins are read with digitalRead on the host (the ESP32 reads a register per bank with the
+// same masks) - pin levels are set directly and the masks checked for hit and not-hit levels
+
+#include <unity.h>
+#include "RobotMotion/MotionControl/RampGenerator/EndStopPinMask.h"
+
+void setUp()
+{
+    NativeHw::reset();
+}
+
+void tearDown()
+{
+}
+
+void test_no_pins()
+{
+    EndStopPinMask endStops;
+    TEST_ASSERT_FALSE(endStops.any());
+    TEST_ASSERT_FALSE(endStops.isHit());
+
+    // Unused end-stops (pin -1) and pins beyond the banks are ignored
+    endStops.add(-1, true);
+    endStops.add(64, false);
+    TEST_ASSERT_FALSE(endStops.any());
+    TEST_ASSERT_FALSE(endStops.isHit());
+}
+
+void test_hit_levels()
+{
+    // Active high and active low end-stops (including the top bit of the first bank)
+    const int pins[] = {4, 31};
+    for (int pin : pins)
+    {
+        for (int hitLevel = 0; hitLevel < 2; hitLevel++)
+        {
+            EndStopPinMask endStops;
+            endStops.add(pin, hitLevel != 0);
+            TEST_ASSERT_TRUE(endStops.any());
+            digitalWrite(pin, !hitLevel);
+            TEST_ASSERT_FALSE(endStops.isHit());
+            digitalWrite(pin, hitLevel);
+            TEST_ASSERT_TRUE(endStops.isHit());
+            // Other pins don't affect it
+            digitalWrite(pin, !hitLevel);
+            digitalWrite(pin + 1, hitLevel);
+            digitalWrite(pin - 1, hitLevel);
+            TEST_ASSERT_FALSE(endStops.isHit());
+        }
+    }
+}
+
+void test_second_bank()
+{
+    // Pins above 31 are in the second bank (the ESP32 input-only pins 34..39)
+    EndStopPinMask endStops;
+    endStops.add(36, false);
+    digitalWrite(36, 1);
+    digitalWrite(4, 0);
+    TEST_ASSERT_FALSE(endStops.isHit());
+    digitalWrite(36, 0);
+    TEST_ASSERT_TRUE(endStops.isHit());
+
+    // The same bit in the first bank is a different pin
+    digitalWrite(36, 1);
+    endStops.add(4, true);
+    TEST_ASSERT_FALSE(endStops.isHit());
+    digitalWrite(4, 1);
+    TEST_ASSERT_TRUE(endStops.isHit());
+}
+
+void test_min_and_max_on_same_axis()
+{
+    // Min end-stop active low in the first bank and max end-stop active high in the second bank -
+    // either one hit is a hit
+    EndStopPinMask endStops;
+    endStops.add(13, false);
+    endStops.add(39, true);
+    digitalWrite(13, 1);
+    digitalWrite(39, 0);
+    TEST_ASSERT_FALSE(endStops.isHit());
+    digitalWrite(13, 0);
+    TEST_ASSERT_TRUE(endStops.isHit());
+    digitalWrite(13, 1);
+    digitalWrite(39, 1);
+    TEST_ASSERT_TRUE(endStops.isHit());
+    digitalWrite(39, 0);
+    TEST_ASSERT_FALSE(endStops.isHit());
+
+    // Both in the same bank with opposite hit levels
+    endStops.clear();
+    TEST_ASSERT_FALSE(endStops.any());
+    endStops.add(13, false);
+    endStops.add(14, true);
+    digitalWrite(14, 0);
+    TEST_ASSERT_FALSE(endStops.isHit());
+    digitalWrite(14, 1);
+    TEST_ASSERT_TRUE(endStops.isHit());
+
+    // Adding a pin again changes its hit level
+    endStops.add(14, false);
+    TEST_ASSERT_FALSE(endStops.isHit());
+    digitalWrite(14, 0);
+    TEST_ASSERT_TRUE(endStops.isHit());
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_no_pins);
+    RUN_TEST(test_hit_levels);
+    RUN_TEST(test_second_bank);
+    RUN_TEST(test_min_and_max_on_same_axis);
+    return UNITY_END();
+}
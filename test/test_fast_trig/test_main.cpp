@@ -0,0 +1,142 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Fast trig tests
+// The table based sin/cos and atan2 are checked against the maths library - the times are printed
+// for comparison between builds but aren't checked as the host isn't the target
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "FastTrig.h"
+
+static const int NUM_ACCURACY_PTS = 1000000;
+static const int NUM_BENCH_PTS = 1000;
+static const int NUM_BENCH_REPEATS = 1000;
+
+static std::vector<float> _benchAngles;
+
+void setUp()
+{
+    // Angles over a few turns either side of zero
+    _benchAngles.resize(NUM_BENCH_PTS);
+    for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+        _benchAngles[ptIdx] = float(-6 * M_PI + 12 * M_PI * ptIdx / NUM_BENCH_PTS);
+}
+
+void tearDown()
+{
+}
+
+static double secsSince(std::chrono::steady_clock::time_point startTime)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+void test_sin_cos_accuracy()
+{
+    double maxErr = 0;
+    for (int ptIdx = 0; ptIdx <= NUM_ACCURACY_PTS; ptIdx++)
+    {
+        float angle = float(-4 * M_PI + 8 * M_PI * ptIdx / NUM_ACCURACY_PTS);
+        float sinVal = 0, cosVal = 0;
+        FastTrig::sinCosRad(angle, sinVal, cosVal);
+        maxErr = std::max(maxErr, fabs(sinVal - sin(double(angle))));
+        maxErr = std::max(maxErr, fabs(cosVal - cos(double(angle))));
+    }
+    printf("sin/cos max error %.3g\n", maxErr);
+    TEST_ASSERT_LESS_THAN(2e-5, maxErr);
+
+    // Degrees and turns are the same table
+    float sinDeg = 0, cosDeg = 0, sinTurns = 0, cosTurns = 0;
+    FastTrig::sinCosDeg(-30, sinDeg, cosDeg);
+    FastTrig::sinCosTurns(-1.0f / 12, sinTurns, cosTurns);
+    TEST_ASSERT_FLOAT_WITHIN(2e-5f, -0.5f, sinDeg);
+    TEST_ASSERT_FLOAT_WITHIN(2e-5f, sqrtf(3) / 2, cosDeg);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, sinDeg, sinTurns);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, cosDeg, cosTurns);
+}
+
+void test_atan2_accuracy()
+{
+    double maxErr = 0;
+    for (int ptIdx = 0; ptIdx < NUM_ACCURACY_PTS; ptIdx++)
+    {
+        // Points on circles of different radii all the way round
+        double angle = -M_PI + 2 * M_PI * ptIdx / NUM_ACCURACY_PTS;
+        double radius = 0.001 * (1 + ptIdx % 7) * pow(10, ptIdx % 5);
+        float x = float(radius * cos(angle));
+        float y = float(radius * sin(angle));
+        double err = fabs(FastTrig::atan2Rad(y, x) - atan2(double(y), double(x)));
+        // The angle of the negative x axis is PI or -PI
+        if (err > M_PI)
+            err = fabs(err - 2 * M_PI);
+        maxErr = std::max(maxErr, err);
+    }
+    printf("atan2 max error %.3g\n", maxErr);
+    TEST_ASSERT_LESS_THAN(2e-6, maxErr);
+
+    // Axes and the origin
+    TEST_ASSERT_TRUE(FastTrig::atan2Rad(0, 0) == 0);
+    TEST_ASSERT_TRUE(FastTrig::atan2Rad(0, 1) == 0);
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, float(M_PI / 2), FastTrig::atan2Rad(1, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, float(-M_PI / 2), FastTrig::atan2Rad(-1, 0));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, float(M_PI), FastTrig::atan2Rad(0, -1));
+}
+
+void test_fast_trig_bench()
+{
+    volatile float sinkVal = 0;
+    float sumVal = 0;
+    double numPts = double(NUM_BENCH_PTS) * NUM_BENCH_REPEATS;
+
+    // sin and cos
+    auto startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+    {
+        for (float angle : _benchAngles)
+        {
+            float sinVal = 0, cosVal = 0;
+            FastTrig::sinCosRad(angle, sinVal, cosVal);
+            sumVal += sinVal + cosVal;
+        }
+    }
+    double fastSecs = secsSince(startTime);
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+        for (float angle : _benchAngles)
+            sumVal += sinf(angle) + cosf(angle);
+    double floatSecs = secsSince(startTime);
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+        for (float angle : _benchAngles)
+            sumVal += float(sin(double(angle)) + cos(double(angle)));
+    double doubleSecs = secsSince(startTime);
+    printf("sin+cos table %.1f ns, sinf/cosf %.1f ns, double %.1f ns\n",
+                fastSecs * 1e9 / numPts, floatSecs * 1e9 / numPts, doubleSecs * 1e9 / numPts);
+
+    // atan2 of points on a circle
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+        for (float angle : _benchAngles)
+            sumVal += FastTrig::atan2Rad(angle, 10.0f - angle);
+    fastSecs = secsSince(startTime);
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+        for (float angle : _benchAngles)
+            sumVal += atan2f(angle, 10.0f - angle);
+    floatSecs = secsSince(startTime);
+    printf("atan2 table %.1f ns, atan2f %.1f ns\n", fastSecs * 1e9 / numPts, floatSecs * 1e9 / numPts);
+    sinkVal = sumVal;
+    TEST_ASSERT_TRUE(sinkVal == sinkVal);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_sin_cos_accuracy);
+    RUN_TEST(test_atan2_accuracy);
+    RUN_TEST(test_fast_trig_bench);
+    return UNITY_END();
+}
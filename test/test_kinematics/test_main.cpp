@@ -0,0 +1,243 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Sand-table kinematics tests
+// The robot's transforms are called as MotionHelper calls them (through the pointers the robot sets)
+// Timings are printed for comparison between builds - they aren't checked as the host isn't the target
+
+#include <unity.h>
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+#include "RobotMotion/MotionControl/MotionHelper.h"
+#include "RobotMotion/Robots/RobotSandTableRotary.h"
+#include "FastTrig.h"
+
+// Axes of the TranquilSmall robot (max radius 145mm)
+static const char *TEST_ROBOT_CONFIG =
+    "{\"robotGeom\":{\"model\":\"SandBotRotary\",\"pipelineLen\":32,"
+    "\"axis0\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":4,\"stepsPerRot\":38400,\"stepPin\":\"19\",\"dirnPin\":\"21\"},"
+    "\"axis1\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":30,\"stepsPerRot\":3200,\"unitsPerRot\":40.5,\"maxVal\":145,"
+    "\"stepPin\":\"27\",\"dirnPin\":\"3\"}}}";
+
+static const int NUM_BENCH_PTS = 1000;
+static const int NUM_BENCH_REPEATS = 200;
+
+static MotionHelper *_pMotionHelper = NULL;
+static RobotSandTableRotary *_pRobot = NULL;
+static AxesParams _axesParams;
+static ptToActuatorFnType _ptToActuatorFn = NULL;
+static ptsToActuatorFnType _ptsToActuatorFn = NULL;
+static actuatorToPtFnType _actuatorToPtFn = NULL;
+static correctStepOverflowFnType _correctStepOverflowFn = NULL;
+static AxisPosition _curPos;
+static std::vector<AxisFloats> _benchPts;
+
+void setUp()
+{
+    _pMotionHelper = new MotionHelper();
+    _pRobot = new RobotSandTableRotary("SandTableRotary", *_pMotionHelper);
+    _pMotionHelper->configure(TEST_ROBOT_CONFIG);
+    _axesParams = _pMotionHelper->getAxesParams();
+    _ptToActuatorFn = _pMotionHelper->testGetPtToActuatorFn();
+    _ptsToActuatorFn = _pMotionHelper->testGetPtsToActuatorFn();
+    _actuatorToPtFn = _pMotionHelper->testGetActuatorToPtFn();
+    _correctStepOverflowFn = _pMotionHelper->testGetCorrectStepOverflowFn();
+    _curPos.clear();
+
+    // Points on a spiral
+    _benchPts.resize(NUM_BENCH_PTS);
+    for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+    {
+        float angle = ptIdx * 0.05f;
+        float radius = 5 + 135.0f * ptIdx / NUM_BENCH_PTS;
+        _benchPts[ptIdx].set(radius * cosf(angle), radius * sinf(angle), 0);
+    }
+}
+
+void tearDown()
+{
+    delete _pRobot;
+    delete _pMotionHelper;
+    _pRobot = NULL;
+    _pMotionHelper = NULL;
+}
+
+static double secsSince(std::chrono::steady_clock::time_point startTime)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Batch conversion gives exactly the same actuator values as converting the points one at a time -
+// including points at the centre and beyond the edge - for current positions all the way round
+void test_batch_matches_scalar()
+{
+    std::vector<float> ptX(NUM_BENCH_PTS), ptY(NUM_BENCH_PTS), ptZ(NUM_BENCH_PTS);
+    std::vector<float> outTheta(NUM_BENCH_PTS), outRho(NUM_BENCH_PTS), outZ(NUM_BENCH_PTS);
+    for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+    {
+        ptX[ptIdx] = _benchPts[ptIdx].getVal(0);
+        ptY[ptIdx] = _benchPts[ptIdx].getVal(1);
+        ptZ[ptIdx] = 0;
+    }
+    ptX[10] = 0;
+    ptY[10] = 0;
+    ptX[20] = 0.5f;
+    ptY[20] = -0.5f;
+    ptX[30] = 200;
+    ptY[30] = 10;
+    const float *ptAxes[] = {ptX.data(), ptY.data(), ptZ.data()};
+    float *outAxes[] = {outTheta.data(), outRho.data(), outZ.data()};
+
+    for (int posIdx = 0; posIdx < 8; posIdx++)
+    {
+        AxisPosition curPos;
+        curPos.clear();
+        curPos.setAbsSteps(0, posIdx * 38400 / 8 + 123);
+        curPos.setAbsSteps(1, 3200 * posIdx);
+        curPos._axisPositionMM.set(_benchPts[posIdx * 100].getVal(0), _benchPts[posIdx * 100].getVal(1), 0);
+
+        // Out of bounds is only reported when it isn't allowed - the outputs are always filled in
+        for (int allowOutOfBounds = 0; allowOutOfBounds < 2; allowOutOfBounds++)
+        {
+            bool batchValid = _ptsToActuatorFn(ptAxes, outAxes, NUM_BENCH_PTS, curPos, _axesParams, allowOutOfBounds);
+            TEST_ASSERT_EQUAL(allowOutOfBounds != 0, batchValid);
+            for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+            {
+                AxisFloats pt(ptX[ptIdx], ptY[ptIdx], 0);
+                AxisFloats actuator;
+                TEST_ASSERT_TRUE(_ptToActuatorFn(pt, actuator, curPos, _axesParams, true));
+                TEST_ASSERT_TRUE(actuator.getVal(0) == outTheta[ptIdx]);
+                TEST_ASSERT_TRUE(actuator.getVal(1) == outRho[ptIdx]);
+            }
+        }
+    }
+}
+
+void test_batch_bench()
+{
+    std::vector<float> ptX(NUM_BENCH_PTS), ptY(NUM_BENCH_PTS), ptZ(NUM_BENCH_PTS, 0);
+    std::vector<float> outTheta(NUM_BENCH_PTS), outRho(NUM_BENCH_PTS), outZ(NUM_BENCH_PTS);
+    for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+    {
+        ptX[ptIdx] = _benchPts[ptIdx].getVal(0);
+        ptY[ptIdx] = _benchPts[ptIdx].getVal(1);
+    }
+    const float *ptAxes[] = {ptX.data(), ptY.data(), ptZ.data()};
+    float *outAxes[] = {outTheta.data(), outRho.data(), outZ.data()};
+    AxisFloats actuator;
+    float checkSumScalar = 0, checkSumBatch = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+    {
+        for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+        {
+            _ptToActuatorFn(_benchPts[ptIdx], actuator, _curPos, _axesParams, false);
+            checkSumScalar += actuator.getVal(0) + actuator.getVal(1);
+        }
+    }
+    double scalarSecs = secsSince(startTime);
+
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+    {
+        _ptsToActuatorFn(ptAxes, outAxes, NUM_BENCH_PTS, _curPos, _axesParams, false);
+        for (int ptIdx = 0; ptIdx < NUM_BENCH_PTS; ptIdx++)
+            checkSumBatch += outTheta[ptIdx] + outRho[ptIdx];
+    }
+    double batchSecs = secsSince(startTime);
+
+    double numPts = double(NUM_BENCH_PTS) * NUM_BENCH_REPEATS;
+    printf("ptToActuator %.1f ns/pt, ptsToActuator %.1f ns/pt\n", scalarSecs * 1e9 / numPts, batchSecs * 1e9 / numPts);
+    TEST_ASSERT_TRUE(checkSumScalar == checkSumBatch);
+}
+
+// Move to a point updating the position as the motion helper does
+static void moveToPt(AxisPosition &curPos, float x, float y)
+{
+    AxisFloats pt(x, y, 0);
+    AxisFloats actuator;
+    TEST_ASSERT_TRUE(_ptToActuatorFn(pt, actuator, curPos, _axesParams, false));
+    for (int axisIdx = 0; axisIdx < 2; axisIdx++)
+        curPos.addSteps(axisIdx, int32_t(actuator.getVal(axisIdx)) - curPos._stepsFromHome.getVal(axisIdx));
+    curPos._axisPositionMM = pt;
+    _correctStepOverflowFn(curPos, _axesParams);
+}
+
+// Positions any number of rotations from home (well beyond 32 bits of steps) reduce to within a
+// rotation of home and to the same cartesian point
+void test_step_overflow_far_from_home()
+{
+    AxisPosition nearPos;
+    nearPos.clear();
+    nearPos.setAbsSteps(0, 12345);
+    nearPos.setAbsSteps(1, 2222);
+    _correctStepOverflowFn(nearPos, _axesParams);
+    AxisFloats nearPt;
+    _actuatorToPtFn(nearPos._stepsFromHome, nearPt, nearPos, _axesParams);
+
+    const int64_t rotationsList[] = {1, -1, 1000, -1000, 5000000, -5000000};
+    for (int64_t rotations : rotationsList)
+    {
+        AxisPosition farPos;
+        farPos.clear();
+        farPos.setAbsSteps(0, 12345 + rotations * 38400);
+        farPos.setAbsSteps(1, 2222 + rotations * 3200);
+        _correctStepOverflowFn(farPos, _axesParams);
+
+        // The view is the absolute position less whole rotations (with the rho steps of each rotation)
+        int32_t thetaSteps = farPos._stepsFromHome.getVal(0);
+        TEST_ASSERT_LESS_THAN(38400, abs(thetaSteps));
+        TEST_ASSERT_EQUAL_INT32(0, (thetaSteps - 12345) % 38400);
+        TEST_ASSERT_EQUAL_INT32(2222 + (thetaSteps - 12345) / 38400 * 3200, farPos._stepsFromHome.getVal(1));
+        AxisFloats farPt;
+        _actuatorToPtFn(farPos._stepsFromHome, farPt, farPos, _axesParams);
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, nearPt.getVal(0), farPt.getVal(0));
+        TEST_ASSERT_FLOAT_WITHIN(0.001f, nearPt.getVal(1), farPt.getVal(1));
+    }
+}
+
+// Going round a circle many times counts whole rotations in the absolute steps and the position
+// doesn't drift - it is only ever out by the rounding of a single move
+void test_many_turns_no_drift()
+{
+    const int NUM_TURNS = 2000;
+    const int PTS_PER_TURN = 36;
+    const float RADIUS_MM = 100;
+    AxisPosition curPos;
+    curPos.clear();
+    moveToPt(curPos, RADIUS_MM, 0);
+    int64_t startAbsTheta = curPos._absStepsFromHome[0];
+    int64_t startAbsRho = curPos._absStepsFromHome[1];
+    int32_t startTheta = curPos._stepsFromHome.getVal(0);
+    int32_t startRho = curPos._stepsFromHome.getVal(1);
+
+    for (int turnIdx = 1; turnIdx <= NUM_TURNS; turnIdx++)
+    {
+        for (int ptIdx = 1; ptIdx <= PTS_PER_TURN; ptIdx++)
+        {
+            float sinVal = 0, cosVal = 0;
+            FastTrig::sinCosTurns(float(ptIdx) / PTS_PER_TURN, sinVal, cosVal);
+            moveToPt(curPos, RADIUS_MM * cosVal, RADIUS_MM * sinVal);
+        }
+        TEST_ASSERT_TRUE(curPos._absStepsFromHome[0] == startAbsTheta + int64_t(turnIdx) * 38400);
+        TEST_ASSERT_TRUE(llabs(curPos._absStepsFromHome[1] - (startAbsRho + int64_t(turnIdx) * 3200)) <= 1);
+        TEST_ASSERT_EQUAL_INT32(startTheta, curPos._stepsFromHome.getVal(0));
+        TEST_ASSERT_INT_WITHIN(1, startRho, curPos._stepsFromHome.getVal(1));
+    }
+    AxisFloats endPt;
+    _actuatorToPtFn(curPos._stepsFromHome, endPt, curPos, _axesParams);
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, RADIUS_MM, endPt.getVal(0));
+    TEST_ASSERT_FLOAT_WITHIN(0.05f, 0, endPt.getVal(1));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_batch_matches_scalar);
+    RUN_TEST(test_batch_bench);
+    RUN_TEST(test_step_overflow_far_from_home);
+    RUN_TEST(test_many_turns_no_drift);
+    return UNITY_END();
+}
@@ -0,0 +1,245 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Motion block tests
+// The step rates calculated when blocks are prepared for stepping are checked against a floating
+// point reference and the times of both are printed - with MOTION_STEP_RATES_FIXED_POINT defined
+// (pio test -e native_fixed_point) this checks the fixed point version
+
+#include <unity.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "RobotMotion/MotionControl/MotionBlock.h"
+
+static const int NUM_TEST_BLOCKS = 100000;
+static const int NUM_BENCH_REPEATS = 20;
+#ifdef MOTION_STEP_RATES_FIXED_POINT
+static const char *STEP_RATES_TYPE_STR = "fixed point";
+#else
+static const char *STEP_RATES_TYPE_STR = "float";
+#endif
+
+// Block and the values passed to calcStepRates
+struct TestBlock
+{
+    MotionBlock block;
+    uint32_t absMaxSteps;
+    bool isStepwise;
+    float accMMps2;
+    float maxStepRatePerSec;
+};
+
+static std::vector<TestBlock> _testBlocks;
+static uint32_t _randSeed;
+
+static float testRand(float minVal, float maxVal)
+{
+    // Simple LCG so that the sequence is the same on all hosts
+    _randSeed = _randSeed * 1664525 + 1013904223;
+    return minVal + (maxVal - minVal) * ((_randSeed >> 8) / float(1 << 24));
+}
+
+void setUp()
+{
+    _randSeed = 1234;
+    _testBlocks.resize(NUM_TEST_BLOCKS);
+    for (int blockIdx = 0; blockIdx < NUM_TEST_BLOCKS; blockIdx++)
+    {
+        TestBlock &testBlock = _testBlocks[blockIdx];
+        MotionBlock &block = testBlock.block;
+        float stepsPerMM = testRand(5, 500);
+        testBlock.absMaxSteps = uint32_t(testRand(1, 20000));
+        testBlock.isStepwise = (blockIdx % 10) == 0;
+        testBlock.accMMps2 = testRand(5, 2000);
+        testBlock.maxStepRatePerSec = testRand(100, 40000);
+        block._moveDistPrimaryAxesMM = testBlock.absMaxSteps / stepsPerMM;
+        block._feedrate = testBlock.isStepwise ? testRand(1, 40000) : testRand(1, 200);
+        block._entrySpeedMMps = testRand(0, block._feedrate);
+        block._exitSpeedMMps = testRand(0, block._feedrate);
+    }
+}
+
+void tearDown()
+{
+}
+
+static double secsSince(std::chrono::steady_clock::time_point startTime)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Floating point reference (the step rate calculation as built without MOTION_STEP_RATES_FIXED_POINT)
+static void calcStepRatesRef(MotionBlock &block, uint32_t absMaxSteps, bool isStepwise, float accMMps2,
+                float maxStepRatePerSec, MotionBlockExec &blockExec)
+{
+    // Check if stepwise movement
+    float initialStepRatePerSec = 0;
+    float finalStepRatePerSec = 0;
+    float maxAccStepsPerSec2 = 0;
+    float axisMaxStepRatePerSec = 0;
+    uint32_t stepsDecelerating = 0; 
+    if (isStepwise)
+    {
+        // Feedrate is in steps per second in this case
+        float stepRatePerSec = block._feedrate;
+        if (stepRatePerSec > maxStepRatePerSec)
+            stepRatePerSec = maxStepRatePerSec;
+        initialStepRatePerSec = stepRatePerSec;
+        finalStepRatePerSec = stepRatePerSec;
+        maxAccStepsPerSec2 = stepRatePerSec;
+        axisMaxStepRatePerSec = stepRatePerSec;
+        stepsDecelerating = 0;
+    }
+    else
+    {
+        // Get the initial step rate, final step rate and max acceleration for the axis with max steps
+        float stepsPerMM = absMaxSteps / block._moveDistPrimaryAxesMM;
+        initialStepRatePerSec = fabsf(block._entrySpeedMMps * stepsPerMM);
+        if (initialStepRatePerSec > maxStepRatePerSec)
+            initialStepRatePerSec = maxStepRatePerSec;
+        finalStepRatePerSec = fabsf(block._exitSpeedMMps * stepsPerMM);
+        if (finalStepRatePerSec > maxStepRatePerSec)
+            finalStepRatePerSec = maxStepRatePerSec;
+        maxAccStepsPerSec2 = fabsf(accMMps2 * stepsPerMM);
+        float halfInvAcc = 0.5F / maxAccStepsPerSec2;
+        float initialRateSq = initialStepRatePerSec * initialStepRatePerSec;
+        float finalRateSq = finalStepRatePerSec * finalStepRatePerSec;
+
+        // Calculate the distance decelerating and ensure within bounds
+        uint32_t stepsAccelerating = 0;
+        float stepsAcceleratingFloat =
+            ceilf((finalRateSq - initialRateSq) * 0.5F * halfInvAcc + absMaxSteps / 2);
+        if (stepsAcceleratingFloat > 0)
+        {
+            stepsAccelerating = uint32_t(stepsAcceleratingFloat);
+            if (stepsAccelerating > absMaxSteps)
+                stepsAccelerating = absMaxSteps;
+        }
+
+        // Find max possible rate for axis with max steps
+        axisMaxStepRatePerSec = fabsf(block._feedrate * stepsPerMM);
+        if (axisMaxStepRatePerSec > maxStepRatePerSec)
+            axisMaxStepRatePerSec = maxStepRatePerSec;
+        float axisMaxRateSq = axisMaxStepRatePerSec * axisMaxStepRatePerSec;
+
+        // See if max speed will be reached
+        float stepsToMaxSpeedFloat = (axisMaxRateSq - initialRateSq) * halfInvAcc;
+        uint32_t stepsToMaxSpeed = stepsToMaxSpeedFloat > 0 ? uint32_t(stepsToMaxSpeedFloat) : 0;
+        if (stepsAccelerating > stepsToMaxSpeed)
+        {
+            // Max speed will be reached
+            stepsAccelerating = stepsToMaxSpeed;
+
+            // Decelerating steps
+            float stepsDeceleratingFloat = (axisMaxRateSq - finalRateSq) * halfInvAcc;
+            stepsDecelerating = stepsDeceleratingFloat > 0 ? uint32_t(stepsDeceleratingFloat) : 0;
+        }
+        else
+        {
+            // Calculate max speed that will be reached
+            axisMaxStepRatePerSec = sqrtf(initialRateSq + 2.0F * maxAccStepsPerSec2 * stepsAccelerating);
+
+            // Decelerating steps
+            stepsDecelerating = absMaxSteps - stepsAccelerating;
+        }
+    }
+
+    // Fill in the step values for this axis
+    blockExec._initialStepRatePerSec = MotionBlockExec::stepRateToStored(initialStepRatePerSec);
+    blockExec._maxStepRatePerSec = MotionBlockExec::stepRateToStored(axisMaxStepRatePerSec);
+    blockExec._finalStepRatePerSec = MotionBlockExec::stepRateToStored(finalStepRatePerSec);
+    blockExec._accStepsPerTTicksPerMS = uint32_t(maxAccStepsPerSec2 * MotionBlock::TTICKS_PER_STEP_PER_SEC_PER_MS);
+    blockExec._stepsBeforeDecel = absMaxSteps - stepsDecelerating;
+}
+
+static void calcBlock(TestBlock &testBlock, MotionBlockExec &blockExec)
+{
+    testBlock.block.calcStepRates(testBlock.absMaxSteps, testBlock.isStepwise, testBlock.accMMps2,
+                testBlock.maxStepRatePerSec, blockExec);
+}
+
+static void calcRef(TestBlock &testBlock, MotionBlockExec &blockExec)
+{
+    calcStepRatesRef(testBlock.block, testBlock.absMaxSteps, testBlock.isStepwise, testBlock.accMMps2,
+                testBlock.maxStepRatePerSec, blockExec);
+}
+
+// The rates agree to within a step per second (the resolution of the execution record), the
+// acceleration to within rounding and the start of deceleration to within a step (the float
+// version matches exactly)
+void test_step_rates_match_reference()
+{
+    int maxRateDiff = 0, maxPeakRateDiff = 0;
+    uint32_t maxAccDiff = 0, maxDecelStepsDiff = 0;
+    for (TestBlock &testBlock : _testBlocks)
+    {
+        MotionBlockExec calcExec, refExec;
+        calcBlock(testBlock, calcExec);
+        calcRef(testBlock, refExec);
+
+        int rateDiff = std::max(abs(calcExec._initialStepRatePerSec - refExec._initialStepRatePerSec),
+                                abs(calcExec._finalStepRatePerSec - refExec._finalStepRatePerSec));
+        maxRateDiff = std::max(maxRateDiff, rateDiff);
+        maxPeakRateDiff = std::max(maxPeakRateDiff, abs(calcExec._maxStepRatePerSec - refExec._maxStepRatePerSec));
+        uint32_t accDiff = calcExec._accStepsPerTTicksPerMS > refExec._accStepsPerTTicksPerMS ?
+                    calcExec._accStepsPerTTicksPerMS - refExec._accStepsPerTTicksPerMS :
+                    refExec._accStepsPerTTicksPerMS - calcExec._accStepsPerTTicksPerMS;
+        maxAccDiff = std::max(maxAccDiff, accDiff);
+        uint32_t decelStepsDiff = calcExec._stepsBeforeDecel > refExec._stepsBeforeDecel ?
+                    calcExec._stepsBeforeDecel - refExec._stepsBeforeDecel :
+                    refExec._stepsBeforeDecel - calcExec._stepsBeforeDecel;
+        maxDecelStepsDiff = std::max(maxDecelStepsDiff, decelStepsDiff);
+    }
+    printf("Step rates vs reference max differences: rate %d, peak rate %d steps/s, acc %u, steps before decel %u\n",
+                maxRateDiff, maxPeakRateDiff, maxAccDiff, maxDecelStepsDiff);
+    TEST_ASSERT_LESS_OR_EQUAL(1, maxRateDiff);
+    TEST_ASSERT_LESS_OR_EQUAL(1, maxPeakRateDiff);
+    TEST_ASSERT_LESS_OR_EQUAL(2, maxAccDiff);
+    TEST_ASSERT_LESS_OR_EQUAL(1, maxDecelStepsDiff);
+#ifndef MOTION_STEP_RATES_FIXED_POINT
+    TEST_ASSERT_EQUAL(0, maxRateDiff + maxPeakRateDiff + maxAccDiff + maxDecelStepsDiff);
+#endif
+}
+
+void test_step_rates_bench()
+{
+    MotionBlockExec blockExec;
+    uint32_t checkSumCalc = 0, checkSumRef = 0;
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+    {
+        for (TestBlock &testBlock : _testBlocks)
+        {
+            calcBlock(testBlock, blockExec);
+            checkSumCalc += blockExec._stepsBeforeDecel + blockExec._maxStepRatePerSec;
+        }
+    }
+    double calcSecs = secsSince(startTime);
+
+    startTime = std::chrono::steady_clock::now();
+    for (int repeatIdx = 0; repeatIdx < NUM_BENCH_REPEATS; repeatIdx++)
+    {
+        for (TestBlock &testBlock : _testBlocks)
+        {
+            calcRef(testBlock, blockExec);
+            checkSumRef += blockExec._stepsBeforeDecel + blockExec._maxStepRatePerSec;
+        }
+    }
+    double refSecs = secsSince(startTime);
+
+    double numBlocks = double(NUM_TEST_BLOCKS) * NUM_BENCH_REPEATS;
+    printf("calcStepRates %s %.1f ns/block, float reference %.1f ns/block\n", STEP_RATES_TYPE_STR, calcSecs * 1e9 / numBlocks, refSecs * 1e9 / numBlocks);
+    TEST_ASSERT_TRUE(checkSumCalc != 0);
+    TEST_ASSERT_TRUE(checkSumRef != 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_step_rates_match_reference);
+    RUN_TEST(test_step_rates_bench);
+    return UNITY_END();
+}
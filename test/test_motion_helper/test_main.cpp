@@ -0,0 +1,306 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Motion helper tests
+// Moves are split into blocks by the motion helper before planning - these tests check the
+// blocks added to the pipeline for straight, arc and polar moves on the rotary sand-table kinematics
+
+#include <unity.h>
+#include "RobotMotion/MotionControl/MotionHelper.h"
+#include "RobotMotion/Robots/RobotSandTableRotary.h"
+
+// Rotary sand-table (max radius 145mm) with blocks of up to 20mm split adaptively to within 0.1mm
+// and arcs split into chords within 0.1mm
+static const char *TEST_ROBOT_CONFIG =
+    "{\"robotGeom\":{\"model\":\"SandBotRotary\",\"pipelineLen\":512,\"blockDistanceMM\":20,\"pathTolMM\":0.1,\"arcChordTolMM\":0.1,"
+    "\"allowOutOfBounds\":0,\"junctionDeviation\":0.05,"
+    "\"axis0\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":4,\"maxStepAcc\":5000,\"stepsPerRot\":38400,"
+    "\"stepPin\":\"19\",\"dirnPin\":\"21\"},"
+    "\"axis1\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":30,\"stepsPerRot\":3200,\"unitsPerRot\":40.5,\"maxVal\":145,"
+    "\"stepPin\":\"27\",\"dirnPin\":\"3\"}}}";
+
+static const float BLOCK_DIST_MM = 20;
+static const float MAX_RADIUS_MM = 145;
+static const float ARC_CHORD_TOL_MM = 0.1f;
+// Distance between points a step apart on either actuator (at up to 60mm from the centre)
+static const float STEP_RESOLUTION_MM = 0.015f;
+
+static MotionHelper *_pMotionHelper = NULL;
+static RobotSandTableRotary *_pRobot = NULL;
+
+void setUp()
+{
+    _pMotionHelper = new MotionHelper();
+    _pRobot = new RobotSandTableRotary("SandTableRotary", *_pMotionHelper);
+    _pMotionHelper->configure(TEST_ROBOT_CONFIG);
+}
+
+void tearDown()
+{
+    delete _pRobot;
+    delete _pMotionHelper;
+    _pRobot = NULL;
+    _pMotionHelper = NULL;
+}
+
+static bool moveMM(float x, float y)
+{
+    RobotCommandArgs args;
+    args.setAxisValMM(0, x, true);
+    args.setAxisValMM(1, y, true);
+    args.setFeedrate(10);
+    return _pMotionHelper->moveTo(args);
+}
+
+static bool moveArc(float x, float y, float centreOffsetX, float centreOffsetY, bool clockwise)
+{
+    RobotCommandArgs args;
+    args.setAxisValMM(0, x, true);
+    args.setAxisValMM(1, y, true);
+    args.setArc(clockwise);
+    args.setArcCentreOffset(0, centreOffsetX);
+    args.setArcCentreOffset(1, centreOffsetY);
+    args.setFeedrate(10);
+    return _pMotionHelper->moveTo(args);
+}
+
+static bool movePolar(float thetaDegrees, float rho, bool relative = false)
+{
+    RobotCommandArgs args;
+    args.setPointPolar(thetaDegrees, rho);
+    if (relative)
+        args.setMoveType(RobotMoveTypeArg_Relative);
+    args.setFeedrate(10);
+    return _pMotionHelper->moveTo(args);
+}
+
+// Blocks added since firstBlockIdx - checks that only the last is not followed and returns the
+// number of blocks, their total length, the shortest and the longest
+static int checkBlocks(int firstBlockIdx, float &totalLen, float &minLen, float &maxLen)
+{
+    totalLen = 0;
+    minLen = 1e9f;
+    maxLen = 0;
+    int numBlocks = _pMotionHelper->testGetPipelineCount() - firstBlockIdx;
+    for (int blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+    {
+        MotionBlock block;
+        MotionBlockExec blockExec;
+        TEST_ASSERT_TRUE(_pMotionHelper->testGetPipelineBlock(firstBlockIdx + blockIdx, block, blockExec));
+        TEST_ASSERT_EQUAL(blockIdx + 1 < numBlocks, block._blockIsFollowed);
+        totalLen += block._moveDistPrimaryAxesMM;
+        if (minLen > block._moveDistPrimaryAxesMM)
+            minLen = block._moveDistPrimaryAxesMM;
+        if (maxLen < block._moveDistPrimaryAxesMM)
+            maxLen = block._moveDistPrimaryAxesMM;
+    }
+    return numBlocks;
+}
+
+// Total steps of all blocks in the pipeline for an axis
+static int32_t pipelineSteps(int axisIdx)
+{
+    int32_t steps = 0;
+    for (int blockIdx = 0; blockIdx < _pMotionHelper->testGetPipelineCount(); blockIdx++)
+    {
+        MotionBlock block;
+        MotionBlockExec blockExec;
+        _pMotionHelper->testGetPipelineBlock(blockIdx, block, blockExec);
+        steps += blockExec._stepsTotalMaybeNeg[axisIdx];
+    }
+    return steps;
+}
+
+// Position (mm) at the end of a block found from the actuator steps of all blocks up to it
+static void blockEndMM(int blockIdx, AxisFloats &ptMM)
+{
+    AxisInt32s actuatorSteps;
+    for (int axisIdx = 0; axisIdx < 2; axisIdx++)
+    {
+        int32_t steps = 0;
+        for (int idx = 0; idx <= blockIdx; idx++)
+        {
+            MotionBlock block;
+            MotionBlockExec blockExec;
+            _pMotionHelper->testGetPipelineBlock(idx, block, blockExec);
+            steps += blockExec._stepsTotalMaybeNeg[axisIdx];
+        }
+        actuatorSteps.setVal(axisIdx, steps);
+    }
+    AxisPosition curPos;
+    _pMotionHelper->testGetActuatorToPtFn()(actuatorSteps, ptMM, curPos, _pMotionHelper->getAxesParams());
+}
+
+// Check the chords of an arc added after firstBlockIdx - the ends of the chords are on the arc and
+// the middles are within the chord tolerance of it - returns the number of chords
+static int checkArcChords(int firstBlockIdx, float centreX, float centreY, float radius)
+{
+    int numBlocks = _pMotionHelper->testGetPipelineCount() - firstBlockIdx;
+    AxisFloats prevEndMM;
+    blockEndMM(firstBlockIdx - 1, prevEndMM);
+    for (int blockIdx = firstBlockIdx; blockIdx < firstBlockIdx + numBlocks; blockIdx++)
+    {
+        AxisFloats endMM;
+        blockEndMM(blockIdx, endMM);
+        float endRadius = hypotf(endMM.getVal(0) - centreX, endMM.getVal(1) - centreY);
+        TEST_ASSERT_FLOAT_WITHIN(STEP_RESOLUTION_MM, radius, endRadius);
+        float midRadius = hypotf((prevEndMM.getVal(0) + endMM.getVal(0)) / 2 - centreX,
+                                 (prevEndMM.getVal(1) + endMM.getVal(1)) / 2 - centreY);
+        TEST_ASSERT_LESS_OR_EQUAL(ARC_CHORD_TOL_MM + STEP_RESOLUTION_MM, radius - midRadius);
+        prevEndMM = endMM;
+    }
+    return numBlocks;
+}
+
+void test_arc_chords()
+{
+    // Chords subtend at most this angle to stay within tolerance at 50mm radius
+    float maxChordAngle = 2 * acosf(1 - ARC_CHORD_TOL_MM / 50);
+
+    // Quarter circle anticlockwise (G3) about the centre from (50,0) to (0,50)
+    TEST_ASSERT_TRUE(moveMM(50, 0));
+    int firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    int32_t thetaStepsBefore = pipelineSteps(0);
+    int32_t rhoStepsBefore = pipelineSteps(1);
+    TEST_ASSERT_TRUE(moveArc(0, 50, -50, 0, false));
+    TEST_ASSERT_TRUE(_pMotionHelper->canAccept());
+    int numChords = checkArcChords(firstBlockIdx, 0, 0, 50);
+    TEST_ASSERT_EQUAL(int(ceilf(float(M_PI / 2) / maxChordAngle)), numChords);
+
+    // The arc ends exactly at the end point - a quarter turn of theta (38400 steps per rotation
+    // and 3200 steps of rho coupled to each rotation) and no change in radius (to within the
+    // rounding of rho to steps)
+    int32_t thetaSteps = pipelineSteps(0) - thetaStepsBefore;
+    TEST_ASSERT_EQUAL(9600, abs(thetaSteps));
+    TEST_ASSERT_INT_WITHIN(1, thetaSteps / 12, pipelineSteps(1) - rhoStepsBefore);
+    AxisFloats endMM;
+    blockEndMM(_pMotionHelper->testGetPipelineCount() - 1, endMM);
+    TEST_ASSERT_FLOAT_WITHIN(STEP_RESOLUTION_MM, 0, endMM.getVal(0));
+    TEST_ASSERT_FLOAT_WITHIN(STEP_RESOLUTION_MM, 50, endMM.getVal(1));
+
+    // Full circle clockwise (G2) about (0,20) back to the start - the circle encloses the centre
+    // of the table so theta makes exactly one turn clockwise
+    firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    thetaStepsBefore = pipelineSteps(0);
+    rhoStepsBefore = pipelineSteps(1);
+    TEST_ASSERT_TRUE(moveArc(0, 50, 0, -30, true));
+    TEST_ASSERT_TRUE(_pMotionHelper->canAccept());
+    numChords = checkArcChords(firstBlockIdx, 0, 20, 30);
+    TEST_ASSERT_EQUAL(int(ceilf(float(2 * M_PI) / (2 * acosf(1 - ARC_CHORD_TOL_MM / 30)))), numChords);
+    TEST_ASSERT_EQUAL(-38400, pipelineSteps(0) - thetaStepsBefore);
+    TEST_ASSERT_EQUAL(-3200, pipelineSteps(1) - rhoStepsBefore);
+}
+
+void test_arc_end_not_on_arc()
+{
+    // The end point is further from the centre than the start by more than the chord tolerance
+    TEST_ASSERT_TRUE(moveMM(50, 0));
+    int numBlocks = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_FALSE(moveArc(0, 50.5f, -50, 0, false));
+    TEST_ASSERT_EQUAL(numBlocks, _pMotionHelper->testGetPipelineCount());
+
+    // Within the tolerance is accepted and ends at the end point given
+    TEST_ASSERT_TRUE(moveArc(0, 50.05f, -50, 0, false));
+    TEST_ASSERT_TRUE(_pMotionHelper->testGetPipelineCount() > numBlocks);
+    AxisFloats endMM;
+    blockEndMM(_pMotionHelper->testGetPipelineCount() - 1, endMM);
+    TEST_ASSERT_FLOAT_WITHIN(STEP_RESOLUTION_MM, 0, endMM.getVal(0));
+    TEST_ASSERT_FLOAT_WITHIN(STEP_RESOLUTION_MM, 50.05f, endMM.getVal(1));
+}
+
+void test_adaptive_line_blocks()
+{
+    // Line well away from the centre - far fewer blocks than a fixed split into 1mm blocks
+    TEST_ASSERT_TRUE(moveMM(-60, 60));
+    int firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_TRUE(moveMM(60, 60));
+    TEST_ASSERT_TRUE(_pMotionHelper->canAccept());
+    float farLen = 0, farMinLen = 0, farMaxLen = 0;
+    int farBlocks = checkBlocks(firstBlockIdx, farLen, farMinLen, farMaxLen);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 120, farLen);
+    TEST_ASSERT_TRUE(farMaxLen <= BLOCK_DIST_MM + 0.01f);
+    TEST_ASSERT_TRUE(farBlocks >= 6);
+    TEST_ASSERT_TRUE(farBlocks <= 40);
+
+    // Line passing close to the centre - theta changes quickly so blocks there must be shorter
+    // but blocks further out can be up to the maximum block length
+    TEST_ASSERT_TRUE(moveMM(-60, 2));
+    firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_TRUE(moveMM(60, 2));
+    TEST_ASSERT_TRUE(_pMotionHelper->canAccept());
+    float nearLen = 0, nearMinLen = 0, nearMaxLen = 0;
+    checkBlocks(firstBlockIdx, nearLen, nearMinLen, nearMaxLen);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 120, nearLen);
+    TEST_ASSERT_TRUE(nearMaxLen <= BLOCK_DIST_MM + 0.01f);
+    TEST_ASSERT_TRUE(nearMinLen < farMinLen / 2);
+    TEST_ASSERT_FLOAT_WITHIN(0.01f, BLOCK_DIST_MM, nearMaxLen);
+}
+
+void test_adaptive_polar_blocks()
+{
+    // Quarter turn at half radius
+    TEST_ASSERT_TRUE(movePolar(0, 0.5f));
+    int firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_TRUE(movePolar(90, 0.5f));
+    TEST_ASSERT_TRUE(_pMotionHelper->canAccept());
+    float totalLen = 0, minLen = 0, maxLen = 0;
+    int numBlocks = checkBlocks(firstBlockIdx, totalLen, minLen, maxLen);
+    TEST_ASSERT_TRUE(numBlocks > 1);
+    TEST_ASSERT_TRUE(maxLen <= BLOCK_DIST_MM + 0.01f);
+
+    // The blocks are chords of the arc
+    TEST_ASSERT_FLOAT_WITHIN(0.5f, MAX_RADIUS_MM * 0.5f * float(M_PI) / 2, totalLen);
+}
+
+void test_polar_near_origin_holds_theta()
+{
+    // 38400 steps per rotation of theta
+    TEST_ASSERT_TRUE(movePolar(30, 0.5f));
+    TEST_ASSERT_EQUAL(3200, pipelineSteps(0));
+
+    // Moving to within 1mm of the origin keeps theta (going straight in)
+    TEST_ASSERT_TRUE(movePolar(200, 0.002f));
+    TEST_ASSERT_EQUAL(3200, pipelineSteps(0));
+
+    // Moving out from the origin turns to the destination theta at the origin and then goes
+    // straight out
+    int firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_TRUE(movePolar(210, 0.5f));
+    TEST_ASSERT_EQUAL(22400, pipelineSteps(0));
+    float totalLen = 0, minLen = 0, maxLen = 0;
+    checkBlocks(firstBlockIdx, totalLen, minLen, maxLen);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, MAX_RADIUS_MM * 0.5f, totalLen);
+}
+
+void test_polar_relative_and_long_arcs()
+{
+    TEST_ASSERT_TRUE(movePolar(30, 0.5f));
+
+    // Relative moves turn by the amount given (not the shortest route) - blocks never turn by
+    // half a turn or more
+    int firstBlockIdx = _pMotionHelper->testGetPipelineCount();
+    TEST_ASSERT_TRUE(movePolar(270, 0, true));
+    TEST_ASSERT_EQUAL(3200 + 28800, pipelineSteps(0));
+    float totalLen = 0, minLen = 0, maxLen = 0;
+    checkBlocks(firstBlockIdx, totalLen, minLen, maxLen);
+    TEST_ASSERT_FLOAT_WITHIN(2.0f, MAX_RADIUS_MM * 0.5f * float(M_PI) * 1.5f, totalLen);
+    TEST_ASSERT_TRUE(maxLen <= BLOCK_DIST_MM + 0.01f);
+
+    // Relative rho - the linear axis steps include those coupled to theta (3200 per rotation)
+    TEST_ASSERT_TRUE(movePolar(0, 0.25f, true));
+    TEST_ASSERT_EQUAL(3200 + 28800, pipelineSteps(0));
+    float linearSteps = pipelineSteps(1) - pipelineSteps(0) * 3200.0f / 38400;
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, MAX_RADIUS_MM * 0.75f, linearSteps * 40.5f / 3200);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_adaptive_line_blocks);
+    RUN_TEST(test_adaptive_polar_blocks);
+    RUN_TEST(test_polar_near_origin_holds_theta);
+    RUN_TEST(test_polar_relative_and_long_arcs);
+    RUN_TEST(test_arc_chords);
+    RUN_TEST(test_arc_end_not_on_arc);
+    return UNITY_END();
+}
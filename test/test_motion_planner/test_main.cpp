@@ -0,0 +1,388 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Motion planner tests
+// The planner only replans blocks from its watermark onwards - these tests check that the
+// result matches a full replan of the pipeline and that executing blocks are never changed
+
+#include <unity.h>
+#include <vector>
+#include <chrono>
+#include <stdio.h>
+#include "RobotMotion/MotionControl/MotionPlanner.h"
+
+static const char *TEST_ROBOT_CONFIG =
+    "{\"junctionDeviation\":0.05,"
+    "\"axis0\":{\"maxSpeed\":100,\"maxAcc\":100,\"stepsPerRot\":3200,\"unitsPerRot\":40},"
+    "\"axis1\":{\"maxSpeed\":100,\"maxAcc\":100,\"stepsPerRot\":3200,\"unitsPerRot\":40}}";
+
+static AxesParams _axesParams;
+static MotionPlanner _motionPlanner;
+static MotionPipeline _motionPipeline;
+static AxisPosition _curPos;
+static uint32_t _randSeed;
+
+static float testRand(float minVal, float maxVal)
+{
+    // Simple LCG so that the sequence is the same on all hosts
+    _randSeed = _randSeed * 1664525 + 1013904223;
+    return minVal + (maxVal - minVal) * ((_randSeed >> 8) / float(1 << 24));
+}
+
+void setUp()
+{
+    _axesParams.clearAxes();
+    String axisJSON;
+    for (int axisIdx = 0; axisIdx < 2; axisIdx++)
+        _axesParams.configureAxis(TEST_ROBOT_CONFIG, axisIdx, axisJSON);
+    _axesParams.configurePathLimits(TEST_ROBOT_CONFIG);
+    _motionPlanner = MotionPlanner();
+    _motionPlanner.configure(0.05f, false);
+    _motionPipeline.init(32);
+    _curPos.clear();
+    _randSeed = 1234;
+}
+
+void tearDown()
+{
+}
+
+// Add a cartesian move (actuator steps are proportional to mm)
+static bool addMove(float x, float y, float feedrate)
+{
+    RobotCommandArgs args;
+    args.setAxisValMM(0, x, true);
+    args.setAxisValMM(1, y, true);
+    args.setFeedrate(feedrate);
+    args.setMoreMovesComing(true);
+    AxisFloats destActuator(x * _axesParams.getStepsPerUnit(0), y * _axesParams.getStepsPerUnit(1), 0);
+    if (!_motionPlanner.moveTo(args, destActuator, _curPos, _axesParams, _motionPipeline))
+        return false;
+    _curPos._axisPositionMM.set(x, y, 0);
+    return true;
+}
+
+static void addRandomMove()
+{
+    float x = _curPos._axisPositionMM.getVal(0) + testRand(-20, 20);
+    float y = _curPos._axisPositionMM.getVal(1) + testRand(-20, 20);
+    addMove(x, y, testRand(10, 100));
+}
+
+// Plan the whole pipeline from scratch (as the planner did before the watermark was added)
+// The entry speed of the oldest block is held at its current value
+static void fullReplan(std::vector<float> &entrySpeeds)
+{
+    int numBlocks = _motionPipeline.count();
+    entrySpeeds.resize(numBlocks);
+    if (numBlocks == 0)
+        return;
+    float followingEntrySpeed = 0;
+    for (int blockIdx = numBlocks - 1; blockIdx >= 0; blockIdx--)
+    {
+        MotionBlock *pBlock = _motionPipeline.peekNthFromGet(blockIdx);
+        float entrySpeed = fminf(pBlock->_maxEntrySpeedMMps,
+                                 MotionBlock::maxAchievableSpeed(pBlock->_accMMps2, followingEntrySpeed, pBlock->_moveDistPrimaryAxesMM));
+        entrySpeeds[blockIdx] = (blockIdx == 0) ? pBlock->_entrySpeedMMps : entrySpeed;
+        followingEntrySpeed = entrySpeeds[blockIdx];
+    }
+    for (int blockIdx = 1; blockIdx < numBlocks; blockIdx++)
+    {
+        MotionBlock *pPrevBlock = _motionPipeline.peekNthFromGet(blockIdx - 1);
+        entrySpeeds[blockIdx] = fminf(entrySpeeds[blockIdx],
+                                      MotionBlock::maxAchievableSpeed(pPrevBlock->_accMMps2, entrySpeeds[blockIdx - 1], pPrevBlock->_moveDistPrimaryAxesMM));
+    }
+}
+
+// Compare the parts of an execution record which the planner writes
+static bool execRecordsSame(MotionBlockExec &exec1, MotionBlockExec &exec2)
+{
+    for (int axisIdx = 0; axisIdx < RobotConsts::MAX_AXES; axisIdx++)
+        if (exec1.getStepsToTarget(axisIdx) != exec2.getStepsToTarget(axisIdx))
+            return false;
+    return (exec1._stepsBeforeDecel == exec2._stepsBeforeDecel) &&
+           (exec1._initialStepRatePerSec == exec2._initialStepRatePerSec) &&
+           (exec1._maxStepRatePerSec == exec2._maxStepRatePerSec) &&
+           (exec1._finalStepRatePerSec == exec2._finalStepRatePerSec) &&
+           (exec1._accStepsPerTTicksPerMS == exec2._accStepsPerTTicksPerMS) &&
+           (exec1._canExecute == exec2._canExecute);
+}
+
+static void checkMatchesFullReplan()
+{
+    std::vector<float> entrySpeeds;
+    fullReplan(entrySpeeds);
+    int numBlocks = _motionPipeline.count();
+    for (int blockIdx = 0; blockIdx < numBlocks; blockIdx++)
+    {
+        MotionBlock *pBlock = _motionPipeline.peekNthFromGet(blockIdx);
+        TEST_ASSERT_FLOAT_WITHIN(0.01f + entrySpeeds[blockIdx] * 1e-4f, entrySpeeds[blockIdx], pBlock->_entrySpeedMMps);
+        float exitSpeed = (blockIdx == numBlocks - 1) ? 0 : _motionPipeline.peekNthFromGet(blockIdx + 1)->_entrySpeedMMps;
+        TEST_ASSERT_FLOAT_WITHIN(0.01f, exitSpeed, pBlock->_exitSpeedMMps);
+        TEST_ASSERT_TRUE(pBlock->_entrySpeedMMps <= pBlock->_maxEntrySpeedMMps + 0.01f);
+    }
+}
+
+void test_watermark_matches_full_replan()
+{
+    for (int moveIdx = 0; moveIdx < 25; moveIdx++)
+    {
+        addRandomMove();
+        checkMatchesFullReplan();
+    }
+}
+
+void test_watermark_advances()
+{
+    // Straight line at a speed which is reached within the first block - all but the last
+    // few blocks are optimally planned so the watermark should move up behind them
+    for (int moveIdx = 1; moveIdx <= 20; moveIdx++)
+        addMove(moveIdx * 10.0f, 0, 50);
+    checkMatchesFullReplan();
+    int plannedIdx = _motionPipeline.getPlannedNthFromPut();
+    TEST_ASSERT_TRUE(plannedIdx >= 0);
+    TEST_ASSERT_TRUE(plannedIdx < 5);
+}
+
+void test_blocks_consumed_while_planning()
+{
+    // Remove blocks (as the ISR does) between additions - the watermark block may leave the pipeline
+    for (int moveIdx = 0; moveIdx < 60; moveIdx++)
+    {
+        addRandomMove();
+        if ((moveIdx % 3 == 2) && _motionPipeline.count() > 2)
+        {
+            _motionPipeline.remove();
+            _motionPipeline.remove();
+        }
+        checkMatchesFullReplan();
+    }
+}
+
+void test_executing_block_not_changed()
+{
+    // A long block followed by short blocks in a straight line - the short blocks are limited
+    // by the need to stop so the planner would raise their speeds when more blocks are added
+    addMove(50, 0, 100);
+    for (int moveIdx = 1; moveIdx <= 3; moveIdx++)
+        addMove(50 + moveIdx * 1.0f, 0, 100);
+
+    // Mark the oldest block as executing (as the RampGenerator does when it starts compiling it)
+    MotionBlockExec *pExec = _motionPipeline.peekExecNthFromGet(0);
+    TEST_ASSERT_TRUE(pExec != NULL);
+    pExec->_isExecuting = true;
+    MotionBlockExec execBefore = *pExec;
+    MotionBlock blockBefore = *_motionPipeline.peekNthFromGet(0);
+    float nextEntrySpeedBefore = _motionPipeline.peekNthFromGet(1)->_entrySpeedMMps;
+
+    // More blocks allow higher speeds at the end of the pipeline
+    for (int moveIdx = 4; moveIdx <= 14; moveIdx++)
+        addMove(50 + moveIdx * 1.0f, 0, 100);
+    TEST_ASSERT_TRUE(_motionPipeline.peekNthFromGet(2)->_entrySpeedMMps > nextEntrySpeedBefore);
+
+    MotionBlock *pBlock = _motionPipeline.peekNthFromGet(0);
+    TEST_ASSERT_TRUE(execRecordsSame(execBefore, *pExec));
+    TEST_ASSERT_TRUE(blockBefore._entrySpeedMMps == pBlock->_entrySpeedMMps);
+    TEST_ASSERT_TRUE(blockBefore._exitSpeedMMps == pBlock->_exitSpeedMMps);
+    // The block following the executing one must enter at the speed the executing block exits at
+    TEST_ASSERT_TRUE(nextEntrySpeedBefore == _motionPipeline.peekNthFromGet(1)->_entrySpeedMMps);
+}
+
+void test_all_blocks_executing()
+{
+    addRandomMove();
+    addRandomMove();
+    _motionPipeline.peekExecNthFromGet(0)->_isExecuting = true;
+    _motionPipeline.peekExecNthFromGet(1)->_isExecuting = true;
+    MotionBlockExec exec0 = *_motionPipeline.peekExecNthFromGet(0);
+    MotionBlockExec exec1 = *_motionPipeline.peekExecNthFromGet(1);
+    _motionPlanner.recalculatePipeline(_motionPipeline, _axesParams);
+    TEST_ASSERT_TRUE(execRecordsSame(exec0, *_motionPipeline.peekExecNthFromGet(0)));
+    TEST_ASSERT_TRUE(execRecordsSame(exec1, *_motionPipeline.peekExecNthFromGet(1)));
+}
+
+void test_clear_resets_watermark()
+{
+    for (int moveIdx = 0; moveIdx < 6; moveIdx++)
+        addRandomMove();
+    _motionPipeline.clear();
+    TEST_ASSERT_TRUE(_motionPipeline.serviceClearISR());
+    _motionPipeline.service();
+    TEST_ASSERT_EQUAL(0, _motionPipeline.count());
+    TEST_ASSERT_EQUAL(-1, _motionPipeline.getPlannedNthFromPut());
+    for (int moveIdx = 0; moveIdx < 6; moveIdx++)
+    {
+        addRandomMove();
+        checkMatchesFullReplan();
+    }
+    TEST_ASSERT_TRUE(0 == _motionPipeline.peekNthFromGet(0)->_entrySpeedMMps);
+}
+
+// Check the step rates of a block prepared for stepping keep each actuator within its max step rate
+// (the rates are for the axis with most steps - the other axes step in proportion)
+static void checkExecRatesWithinLimits(MotionBlockExec &blockExec)
+{
+    float maxAxisSteps = fabsf(float(blockExec.getStepsToTarget(blockExec._axisIdxWithMaxSteps)));
+    for (int axisIdx = 0; axisIdx < 2; axisIdx++)
+    {
+        float axisStepsRatio = fabsf(float(blockExec.getStepsToTarget(axisIdx))) / maxAxisSteps;
+        // Allow for the rounding of the stored rates
+        float axisMaxStepRate = _axesParams.getMaxStepRatePerSec(axisIdx) + 0.5f;
+        TEST_ASSERT_LESS_OR_EQUAL(axisMaxStepRate, blockExec._initialStepRatePerSec * axisStepsRatio);
+        TEST_ASSERT_LESS_OR_EQUAL(axisMaxStepRate, blockExec._maxStepRatePerSec * axisStepsRatio);
+        TEST_ASSERT_LESS_OR_EQUAL(axisMaxStepRate, blockExec._finalStepRatePerSec * axisStepsRatio);
+    }
+}
+
+// Rotary sand table axes - theta (in rotations) and rho (in mm) - the rho RPM limit is below its
+// max speed so that rho's step rate limit binds where the motion is mostly radial
+static const char *ROTARY_ROBOT_CONFIG =
+    "{\"junctionDeviation\":0.05,"
+    "\"axis0\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":4,\"stepsPerRot\":38400},"
+    "\"axis1\":{\"maxSpeed\":15,\"maxAcc\":25,\"maxRPM\":15,\"stepsPerRot\":3200,\"unitsPerRot\":40.5,\"maxVal\":145}}";
+
+void test_rotary_limits_bind_near_centre()
+{
+    // Configure as the sand table does (the kinematics set the theta axis as rotary)
+    _axesParams.clearAxes();
+    String axisJSON;
+    for (int axisIdx = 0; axisIdx < 2; axisIdx++)
+        _axesParams.configureAxis(ROTARY_ROBOT_CONFIG, axisIdx, axisJSON);
+    _axesParams.configurePathLimits(ROTARY_ROBOT_CONFIG);
+    _axesParams.setAxisRotary(0);
+    float thetaMaxStepAcc = _axesParams.getMaxAccStepsPerSec2(0);
+    float thetaMaxStepRate = _axesParams.getMaxStepRatePerSec(0);
+    TEST_ASSERT_FLOAT_WITHIN(1, 4 * 38400 / 30, thetaMaxStepAcc);
+
+    // A straight line passing 2mm from the centre in 1mm blocks - actuator steps are found from
+    // polar coordinates (theta unwrapped so it is continuous)
+    float thetaStepsPerRad = _axesParams.getStepsPerRot(0) / (2 * M_PI);
+    float rhoStepsPerMM = _axesParams.getStepsPerUnit(1);
+    float prevTheta = atan2f(2, -20);
+    float thetaTotal = prevTheta;
+    AxisFloats startActuator(thetaTotal * thetaStepsPerRad, sqrtf(20 * 20 + 2 * 2) * rhoStepsPerMM, 0);
+    _curPos._stepsFromHome.set(int32_t(ceilf(startActuator.getVal(0))), int32_t(ceilf(startActuator.getVal(1))), 0);
+    _curPos._axisPositionMM.set(-20, 2, 0);
+    bool nearCentreBinds = false;
+    bool farFromCentreAtPathLimit = false;
+    int numExecChecked = 0;
+    for (int blockIdx = 1; blockIdx <= 30; blockIdx++)
+    {
+        float x = -20.0f + blockIdx;
+        float y = 2;
+        float theta = atan2f(y, x);
+        float thetaChange = theta - prevTheta;
+        if (thetaChange > M_PI)
+            thetaChange -= 2 * M_PI;
+        if (thetaChange < -M_PI)
+            thetaChange += 2 * M_PI;
+        thetaTotal += thetaChange;
+        prevTheta = theta;
+        AxisFloats destActuator(thetaTotal * thetaStepsPerRad, sqrtf(x * x + y * y) * rhoStepsPerMM, 0);
+
+        RobotCommandArgs args;
+        args.setAxisValMM(0, x, true);
+        args.setAxisValMM(1, y, true);
+        args.setFeedrate(15);
+        args.setMoreMovesComing(true);
+        TEST_ASSERT_TRUE(_motionPlanner.moveTo(args, destActuator, _curPos, _axesParams, _motionPipeline));
+        _curPos._axisPositionMM.set(x, y, 0);
+
+        // Check the newest block keeps each actuator within its own limits
+        MotionBlock *pBlock = _motionPipeline.peekNthFromPut(0);
+        MotionBlockExec *pExec = _motionPipeline.peekExecNthFromPut(0);
+        float thetaStepsPerMM = fabsf(pExec->getStepsToTarget(0) / pBlock->_moveDistPrimaryAxesMM);
+        TEST_ASSERT_LESS_OR_EQUAL(thetaMaxStepAcc * 1.001f, pBlock->_accMMps2 * thetaStepsPerMM);
+        TEST_ASSERT_LESS_OR_EQUAL(thetaMaxStepRate * 1.001f, pBlock->_feedrate * thetaStepsPerMM);
+        if (fabsf(x) < 2)
+            nearCentreBinds |= pBlock->_accMMps2 < _axesParams._pathMaxAccMMps2 / 10;
+        if (fabsf(x) > 8)
+            farFromCentreAtPathLimit |= pBlock->_accMMps2 == _axesParams._pathMaxAccMMps2;
+
+        // Keep the pipeline from filling - the oldest block has been prepared for stepping
+        if (_motionPipeline.count() > 20)
+        {
+            TEST_ASSERT_TRUE(_motionPipeline.peekGet()->_canExecute);
+            checkExecRatesWithinLimits(*_motionPipeline.peekGet());
+            numExecChecked++;
+            _motionPipeline.remove();
+        }
+    }
+    TEST_ASSERT_TRUE(nearCentreBinds);
+    TEST_ASSERT_TRUE(farFromCentreAtPathLimit);
+    TEST_ASSERT_GREATER_THAN(5, numExecChecked);
+}
+
+void test_stepwise_ends_junction()
+{
+    // Two blocks in line have a junction speed
+    addMove(10, 0, 50);
+    addMove(20, 0, 50);
+    TEST_ASSERT_GREATER_THAN(0, _motionPipeline.peekNthFromPut(0)->_maxEntrySpeedMMps);
+
+    // A stepwise move ends at rest so the next block in line starts from rest
+    RobotCommandArgs stepwiseArgs;
+    stepwiseArgs.setAxisSteps(0, 100, true);
+    stepwiseArgs.setMoveType(RobotMoveTypeArg_Relative);
+    TEST_ASSERT_TRUE(_motionPlanner.moveToStepwise(stepwiseArgs, _curPos, _axesParams, _motionPipeline));
+    checkExecRatesWithinLimits(*_motionPipeline.peekExecNthFromPut(0));
+    addMove(30, 0, 50);
+    TEST_ASSERT_TRUE(0 == _motionPipeline.peekNthFromPut(0)->_maxEntrySpeedMMps);
+    TEST_ASSERT_TRUE(0 == _motionPipeline.peekNthFromPut(0)->_entrySpeedMMps);
+}
+
+// Time to add a block with the pipeline kept full (the oldest block is removed before each addition
+// as the ISR would) - random moves and a straight line of short blocks (full speed is only reached
+// after about 200 blocks so each addition replans back over many blocks) - the times are printed
+// but not checked as the host isn't the target
+static double timeInserts(int pipelineLen, bool straightLine)
+{
+    const int NUM_TIMED_INSERTS = 2000;
+    _motionPlanner = MotionPlanner();
+    _motionPlanner.configure(0.05f, false);
+    _motionPipeline.init(pipelineLen);
+    _curPos.clear();
+    _randSeed = 1234;
+    int moveIdx = 0;
+    auto addBenchMove = [&]() {
+        moveIdx++;
+        if (straightLine)
+            TEST_ASSERT_TRUE(addMove(moveIdx * 0.25f, 0, 100));
+        else
+            addRandomMove();
+    };
+    while (_motionPipeline.canAccept())
+        addBenchMove();
+    auto startTime = std::chrono::steady_clock::now();
+    for (int insertIdx = 0; insertIdx < NUM_TIMED_INSERTS; insertIdx++)
+    {
+        _motionPipeline.remove();
+        addBenchMove();
+    }
+    double insertSecs = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    TEST_ASSERT_FALSE(_motionPipeline.canAccept());
+    return insertSecs * 1e9 / NUM_TIMED_INSERTS;
+}
+
+void test_insert_cost_bench()
+{
+    const int pipelineLens[] = {100, 256, 1000};
+    for (int pipelineLen : pipelineLens)
+        printf("Pipeline length %d insert random moves %.0f ns, short straight blocks %.0f ns\n",
+                    pipelineLen, timeInserts(pipelineLen, false), timeInserts(pipelineLen, true));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_watermark_matches_full_replan);
+    RUN_TEST(test_watermark_advances);
+    RUN_TEST(test_blocks_consumed_while_planning);
+    RUN_TEST(test_executing_block_not_changed);
+    RUN_TEST(test_all_blocks_executing);
+    RUN_TEST(test_clear_resets_watermark);
+    RUN_TEST(test_rotary_limits_bind_near_centre);
+    RUN_TEST(test_stepwise_ends_junction);
+    RUN_TEST(test_insert_cost_bench);
+    return UNITY_END();
+}
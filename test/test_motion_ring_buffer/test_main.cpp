@@ -0,0 +1,265 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Motion ring buffer tests
+// The producer and consumer run on separate threads to check the single-producer single-consumer
+// ordering and the requestFlush/consumerFlush/producerFlushAck handshake
+
+#include <unity.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "RobotMotion/MotionControl/MotionRingBuffer.h"
+
+// Element with several words so that a partly written element can be detected
+struct TestElem
+{
+    uint32_t _epoch;
+    uint32_t _seq;
+    uint32_t _check;
+    uint32_t _payload[5];
+
+    void set(uint32_t epoch, uint32_t seq)
+    {
+        _epoch = epoch;
+        _seq = seq;
+        _check = epoch * 2654435761u ^ seq;
+        for (int i = 0; i < 5; i++)
+            _payload[i] = seq + i;
+    }
+    bool valid()
+    {
+        if (_check != (_epoch * 2654435761u ^ _seq))
+            return false;
+        for (int i = 0; i < 5; i++)
+            if (_payload[i] != _seq + i)
+                return false;
+        return true;
+    }
+};
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+void test_size_rounded_to_power_of_two()
+{
+    MotionRingBufferPosn posn(200);
+    TEST_ASSERT_EQUAL(256, posn.size());
+    posn.init(256);
+    TEST_ASSERT_EQUAL(256, posn.size());
+    posn.init(1);
+    TEST_ASSERT_EQUAL(1, posn.size());
+    posn.init(0);
+    TEST_ASSERT_FALSE(posn.canPut());
+}
+
+void test_put_get_wraps()
+{
+    MotionRingBufferPosn posn(4);
+    int vals[4];
+    int nextPut = 0;
+    int nextGet = 0;
+    // Run the positions around the buffer many times with different fill levels
+    for (int loopIdx = 0; loopIdx < 1000; loopIdx++)
+    {
+        int toPut = loopIdx % 5;
+        for (int i = 0; i < toPut && posn.canPut(); i++)
+        {
+            vals[posn.putIdx()] = nextPut++;
+            posn.hasPut();
+        }
+        TEST_ASSERT_TRUE(posn.count() <= 4);
+        TEST_ASSERT_EQUAL(nextPut - nextGet, posn.count());
+        // Newest element is 0 from put and oldest is 0 from get
+        if (posn.count() > 0)
+        {
+            TEST_ASSERT_EQUAL(nextPut - 1, vals[posn.getNthFromPut(0)]);
+            TEST_ASSERT_EQUAL(nextGet, vals[posn.getNthFromGet(0)]);
+            TEST_ASSERT_EQUAL(nextGet, vals[posn.getNthFromPut(posn.count() - 1)]);
+        }
+        TEST_ASSERT_EQUAL(-1, posn.getNthFromPut(posn.count()));
+        TEST_ASSERT_EQUAL(-1, posn.getNthFromGet(posn.count()));
+        int toGet = (loopIdx * 7) % 4;
+        for (int i = 0; i < toGet && posn.canGet(); i++)
+        {
+            TEST_ASSERT_EQUAL(nextGet++, vals[posn.getIdx()]);
+            posn.hasGot();
+        }
+    }
+}
+
+void test_flush_handshake()
+{
+    MotionRingBufferPosn posn(8);
+    for (int i = 0; i < 5; i++)
+        posn.hasPut();
+    posn.requestFlush();
+    // Nothing can be added while the flush is pending
+    TEST_ASSERT_TRUE(posn.isFlushPending());
+    TEST_ASSERT_FALSE(posn.canPut());
+    // The producer can't complete the flush until the consumer has discarded the elements
+    TEST_ASSERT_FALSE(posn.producerFlushAck());
+    TEST_ASSERT_TRUE(posn.consumerFlush());
+    TEST_ASSERT_EQUAL(0, posn.count());
+    TEST_ASSERT_TRUE(posn.producerFlushAck());
+    TEST_ASSERT_FALSE(posn.isFlushPending());
+    TEST_ASSERT_FALSE(posn.consumerFlush());
+    TEST_ASSERT_TRUE(posn.canPut());
+    // Two requests before the consumer runs are completed together
+    posn.hasPut();
+    posn.requestFlush();
+    posn.requestFlush();
+    TEST_ASSERT_TRUE(posn.consumerFlush());
+    TEST_ASSERT_TRUE(posn.producerFlushAck());
+    TEST_ASSERT_FALSE(posn.isFlushPending());
+}
+
+void test_threaded_ordering()
+{
+    static constexpr uint32_t NUM_ELEMS = 200000;
+    MotionRingBufferPosn posn(16);
+    std::vector<TestElem> elems(posn.size());
+    std::atomic<bool> failed(false);
+
+    std::thread consumer([&]() {
+        uint32_t expectedSeq = 0;
+        while (expectedSeq < NUM_ELEMS && !failed)
+        {
+            if (!posn.canGet())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            TestElem &elem = elems[posn.getIdx()];
+            if (!elem.valid() || elem._seq != expectedSeq)
+                failed = true;
+            posn.hasGot();
+            expectedSeq++;
+        }
+    });
+
+    for (uint32_t seq = 0; seq < NUM_ELEMS && !failed;)
+    {
+        if (!posn.canPut())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        elems[posn.putIdx()].set(0, seq++);
+        posn.hasPut();
+    }
+    consumer.join();
+    TEST_ASSERT_FALSE(failed);
+    TEST_ASSERT_EQUAL(0, posn.count());
+}
+
+void test_threaded_flush()
+{
+    // The producer puts elements tagged with an epoch which changes after each completed flush
+    // The consumer must see a valid element, never an epoch going backwards and, within an epoch,
+    // consecutive sequence numbers unless it has discarded elements
+    static constexpr uint32_t NUM_FLUSHES = 500;
+    MotionRingBufferPosn posn(16);
+    std::vector<TestElem> elems(posn.size());
+    std::atomic<bool> producerDone(false);
+    std::atomic<bool> failed(false);
+    std::atomic<uint32_t> elemsGot(0);
+    std::atomic<uint32_t> elemsDiscarded(0);
+
+    std::thread consumer([&]() {
+        uint32_t lastEpoch = 0;
+        uint32_t lastSeq = 0;
+        bool haveLast = false;
+        while (!producerDone && !failed)
+        {
+            if (posn.consumerFlush())
+            {
+                elemsDiscarded++;
+                haveLast = false;
+                continue;
+            }
+            if (!posn.canGet())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            TestElem &elem = elems[posn.getIdx()];
+            if (!elem.valid() || elem._epoch < lastEpoch)
+                failed = true;
+            if (haveLast && elem._epoch == lastEpoch && elem._seq != lastSeq + 1)
+                failed = true;
+            lastEpoch = elem._epoch;
+            lastSeq = elem._seq;
+            haveLast = true;
+            posn.hasGot();
+            elemsGot++;
+        }
+    });
+
+    // Flushes are requested from another thread (requestFlush can be called from any context)
+    std::atomic<uint32_t> flushesRequested(0);
+    std::thread requester([&]() {
+        while (flushesRequested < NUM_FLUSHES && !failed)
+        {
+            if (!posn.isFlushPending())
+            {
+                posn.requestFlush();
+                flushesRequested++;
+            }
+            std::this_thread::yield();
+        }
+    });
+
+    uint32_t epoch = 0;
+    uint32_t seq = 0;
+    while ((flushesRequested < NUM_FLUSHES) && !failed)
+    {
+        if (posn.isFlushPending())
+        {
+            // Complete the flush and reset state relating to discarded elements
+            if (posn.producerFlushAck())
+            {
+                epoch++;
+                seq = 0;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+        if (!posn.canPut())
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        elems[posn.putIdx()].set(epoch, seq++);
+        posn.hasPut();
+    }
+    requester.join();
+    // Let the consumer finish any final flush before stopping it
+    while (posn.isFlushPending() && !posn.producerFlushAck())
+        std::this_thread::yield();
+    producerDone = true;
+    consumer.join();
+    TEST_ASSERT_FALSE(failed);
+    TEST_ASSERT_TRUE(epoch > 0);
+    TEST_ASSERT_TRUE(elemsGot > 0);
+    TEST_ASSERT_TRUE(elemsDiscarded > 0);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_size_rounded_to_power_of_two);
+    RUN_TEST(test_put_get_wraps);
+    RUN_TEST(test_flush_handshake);
+    RUN_TEST(test_threaded_ordering);
+    RUN_TEST(test_threaded_flush);
+    return UNITY_END();
+}
@@ -0,0 +1,83 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Pipeline underrun tests
+// The robot state after each service of the motion task is fed to the underrun check for traces of
+// normal running, homing and stopping - only motion stopping while the robot could have taken more
+// work is counted
+
+#include <unity.h>
+#include "WorkManager/PipelineUnderrunCheck.h"
+
+// Robot state after a service of the motion task
+struct ServiceState
+{
+    bool robotIdle;
+    bool robotHoming;
+    bool workPending;
+};
+
+static PipelineUnderrunCheck *_pUnderrunCheck = NULL;
+
+void setUp()
+{
+    _pUnderrunCheck = new PipelineUnderrunCheck();
+}
+
+void tearDown()
+{
+    delete _pUnderrunCheck;
+}
+
+static int runTrace(const ServiceState *pTrace, int traceLen)
+{
+    uint32_t prevCount = _pUnderrunCheck->getCount();
+    int numUnderruns = 0;
+    for (int serviceIdx = 0; serviceIdx < traceLen; serviceIdx++)
+        if (_pUnderrunCheck->check(pTrace[serviceIdx].robotIdle, pTrace[serviceIdx].robotHoming, pTrace[serviceIdx].workPending))
+            numUnderruns++;
+    TEST_ASSERT_EQUAL(prevCount + numUnderruns, _pUnderrunCheck->getCount());
+    return numUnderruns;
+}
+
+void test_real_underruns_counted()
+{
+    // Pattern running, the pipeline runs dry twice while the work queue still holds moves
+    // then finishes with nothing left to do
+    const ServiceState trace[] = {
+        {true, false, true}, {false, false, true}, {false, false, true},
+        {true, false, true}, {true, false, true}, {false, false, true},
+        {true, false, true}, {false, false, false}, {true, false, false}, {true, false, false}};
+    TEST_ASSERT_EQUAL(2, runTrace(trace, sizeof(trace) / sizeof(trace[0])));
+}
+
+void test_homing_gaps_not_counted()
+{
+    // Homing with a pattern queued behind it - the pipeline empties after each homing move
+    // and homing ends in the service in which its last move completes
+    const ServiceState trace[] = {
+        {true, true, true}, {false, true, true}, {true, true, true}, {true, true, true},
+        {false, true, true}, {true, true, true}, {false, true, true}, {true, false, true},
+        {false, false, true}, {false, false, true}};
+    TEST_ASSERT_EQUAL(0, runTrace(trace, sizeof(trace) / sizeof(trace[0])));
+
+    // Running out of work after homing is still counted
+    const ServiceState afterHoming[] = {{false, false, true}, {true, false, true}};
+    TEST_ASSERT_EQUAL(1, runTrace(afterHoming, sizeof(afterHoming) / sizeof(afterHoming[0])));
+}
+
+void test_stop_not_counted()
+{
+    // Stop clears the pipeline along with the work queue and evaluators
+    const ServiceState trace[] = {{false, false, true}, {false, false, true}, {true, false, false}, {true, false, false}};
+    TEST_ASSERT_EQUAL(0, runTrace(trace, sizeof(trace) / sizeof(trace[0])));
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_real_underruns_counted);
+    RUN_TEST(test_homing_gaps_not_counted);
+    RUN_TEST(test_stop_not_counted);
+    return UNITY_END();
+}
@@ -0,0 +1,540 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Step generation simulation
+// The planner, RampGenerator and RampGenIO run together with the step ISR driven by a fake timer in
+// virtual time - step and direction pin writes are recorded so that step counts, final positions,
+// step timing and the order of pin changes can be checked
+
+#include <unity.h>
+#include <vector>
+#include "RobotMotion/MotionControl/MotionPlanner.h"
+#include "RobotMotion/MotionControl/MotionPipeline.h"
+#include "RobotMotion/MotionControl/RampGenerator/RampGenerator.h"
+
+static const char *TEST_ROBOT_CONFIG =
+    "{\"junctionDeviation\":0.05,"
+    "\"axis0\":{\"maxSpeed\":100,\"maxAcc\":100,\"stepsPerRot\":3200,\"unitsPerRot\":40},"
+    "\"axis1\":{\"maxSpeed\":100,\"maxAcc\":100,\"stepsPerRot\":3200,\"unitsPerRot\":40}}";
+
+// Step and direction pins of each axis
+static const int NUM_TEST_AXES = 2;
+static const int STEP_PINS[NUM_TEST_AXES] = {2, 4};
+static const int DIRN_PINS[NUM_TEST_AXES] = {3, 5};
+static const char *AXIS_PINS_JSON[NUM_TEST_AXES] = {
+    "{\"stepPin\":\"2\",\"dirnPin\":\"3\"}",
+    "{\"stepPin\":\"4\",\"dirnPin\":\"5\"}"};
+
+// Timer which calls the ISR in virtual time
+class FakeRampGenTimer : public RampGenTimer
+{
+public:
+    void (*_isrFn)();
+    uint32_t _periodUs;
+
+    FakeRampGenTimer()
+    {
+        _isrFn = NULL;
+        _periodUs = 0;
+    }
+    virtual bool start(void (*isrFn)(), uint32_t periodUs)
+    {
+        _isrFn = isrFn;
+        _periodUs = periodUs;
+        return true;
+    }
+    virtual void stop()
+    {
+        _isrFn = NULL;
+    }
+    virtual void setPeriodUs(uint32_t periodUs)
+    {
+        _periodUs = periodUs;
+    }
+};
+
+// A step recorded from the pins
+struct StepRecord
+{
+    uint64_t _timeUs;
+    int _axisIdx;
+    bool _dirnPositive;
+};
+
+// Simulation results
+struct SimResult
+{
+    std::vector<StepRecord> _steps;
+    // Step rate of the axis with max steps (steps per TTicks) sampled every ms while moving
+    std::vector<uint32_t> _stepRates;
+    uint32_t _isrCalls;
+};
+
+static AxesParams _axesParams;
+static MotionPlanner _motionPlanner;
+static MotionPipeline _motionPipeline;
+static FakeRampGenTimer _fakeTimer;
+static RampGenerator *_pRampGenerator = NULL;
+static AxisPosition _curPos;
+static std::vector<AxisFloats> _movesToAdd;
+static float _feedrate;
+static SimResult _simResult;
+static bool _inIsr = false;
+
+static void recordPinWrite(int pin, bool level)
+{
+    for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+    {
+        // Steps are counted on the rising edge - a positive direction is a low direction pin
+        if ((pin == STEP_PINS[axisIdx]) && level)
+        {
+            StepRecord step = {NativeHw::_curUs, axisIdx, digitalRead(DIRN_PINS[axisIdx]) == LOW};
+            _simResult._steps.push_back(step);
+        }
+    }
+}
+
+// Set up the robot - each test can then set the planner profile and the step timer mode
+static void setupSim(bool jerkLimited, bool stepTimerVariable, bool stepSmoothing)
+{
+    _motionPlanner.configure(0.05f, jerkLimited);
+    for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+        _pRampGenerator->configureAxis(axisIdx, AXIS_PINS_JSON[axisIdx]);
+    _pRampGenerator->configure(true, stepTimerVariable, stepSmoothing, false);
+    _pRampGenerator->pause(false);
+}
+
+// Clear the robot and simulation state
+static void resetSim(const char *robotConfig)
+{
+    delete _pRampGenerator;
+    NativeHw::reset();
+    NativeHw::_pinWriteCb = recordPinWrite;
+    _axesParams.clearAxes();
+    String axisJSON;
+    for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+        _axesParams.configureAxis(robotConfig, axisIdx, axisJSON);
+    _axesParams.configurePathLimits(robotConfig);
+    _motionPlanner = MotionPlanner();
+    _motionPipeline.init(32);
+    _pRampGenerator = new RampGenerator(&_motionPipeline, &_fakeTimer);
+    _curPos.clear();
+    _movesToAdd.clear();
+    _feedrate = 100;
+    _simResult = SimResult();
+}
+
+void setUp()
+{
+    resetSim(TEST_ROBOT_CONFIG);
+}
+
+void tearDown()
+{
+    NativeHw::_pinWriteCb = NULL;
+    delete _pRampGenerator;
+    _pRampGenerator = NULL;
+}
+
+// Add a cartesian move (actuator steps are proportional to mm)
+static bool addMove(float x, float y, bool moreMovesComing)
+{
+    RobotCommandArgs args;
+    args.setAxisValMM(0, x, true);
+    args.setAxisValMM(1, y, true);
+    args.setFeedrate(_feedrate);
+    args.setMoreMovesComing(moreMovesComing);
+    AxisFloats destActuator(x * _axesParams.getStepsPerUnit(0), y * _axesParams.getStepsPerUnit(1), 0);
+    if (!_motionPlanner.moveTo(args, destActuator, _curPos, _axesParams, _motionPipeline))
+        return false;
+    _curPos._axisPositionMM.set(x, y, 0);
+    return true;
+}
+
+// Add a straight line (from the current position) split into blocks
+static void queueLine(float x, float y, int numBlocks)
+{
+    AxisFloats startPos = _movesToAdd.empty() ? _curPos._axisPositionMM : _movesToAdd.back();
+    for (int blockIdx = 1; blockIdx <= numBlocks; blockIdx++)
+    {
+        float frac = float(blockIdx) / numBlocks;
+        _movesToAdd.push_back(AxisFloats(startPos.getVal(0) + (x - startPos.getVal(0)) * frac,
+                                         startPos.getVal(1) + (y - startPos.getVal(1)) * frac, 0));
+    }
+}
+
+// Run until all moves have been added and executed - moves are added as the pipeline has space
+// (as the motion helper does) and process() is called every ms with ISR calls in between at
+// the times set by the timer
+static void runSim(uint32_t maxMs = 60000)
+{
+    unsigned int nextMoveIdx = 0;
+    uint64_t nextProcessUs = NativeHw::_curUs;
+    uint64_t nextIsrUs = NativeHw::_curUs + _fakeTimer._periodUs;
+    uint64_t maxUs = NativeHw::_curUs + maxMs * 1000ull;
+    MotionSnapshot snapshot;
+    uint32_t idleMs = 0;
+    while (NativeHw::_curUs < maxUs)
+    {
+        if (nextProcessUs <= nextIsrUs)
+        {
+            NativeHw::_curUs = nextProcessUs;
+            while ((nextMoveIdx < _movesToAdd.size()) && _motionPipeline.canAccept())
+            {
+                AxisFloats &pt = _movesToAdd[nextMoveIdx++];
+                addMove(pt.getVal(0), pt.getVal(1), nextMoveIdx < _movesToAdd.size());
+            }
+            // Stop a few ms after the last block has ended (so the last step pulse is complete)
+            if ((nextMoveIdx >= _movesToAdd.size()) && (_motionPipeline.count() == 0))
+                idleMs++;
+            if (idleMs > 5)
+                break;
+            _pRampGenerator->process();
+            _pRampGenerator->getMotionSnapshot(snapshot);
+            if (snapshot._stepRatePerTTicks != 0)
+                _simResult._stepRates.push_back(snapshot._stepRatePerTTicks);
+            nextProcessUs += 1000;
+        }
+        else
+        {
+            NativeHw::_curUs = nextIsrUs;
+            _inIsr = true;
+            _fakeTimer._isrFn();
+            _inIsr = false;
+            _simResult._isrCalls++;
+            nextIsrUs += _fakeTimer._periodUs;
+        }
+    }
+}
+
+// Times of the steps of an axis
+static std::vector<uint64_t> stepTimes(int axisIdx)
+{
+    std::vector<uint64_t> times;
+    for (StepRecord &step : _simResult._steps)
+        if (step._axisIdx == axisIdx)
+            times.push_back(step._timeUs);
+    return times;
+}
+
+// Check the steps output (and the RampGenerator's position) match the planned position
+static void checkFinalPosition()
+{
+    TEST_ASSERT_EQUAL(0, _motionPipeline.count());
+    AxisPosition rampGenPos;
+    _pRampGenerator->getTotalStepPosition(rampGenPos);
+    for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+    {
+        int64_t pinSteps = 0;
+        for (StepRecord &step : _simResult._steps)
+            if (step._axisIdx == axisIdx)
+                pinSteps += step._dirnPositive ? 1 : -1;
+        TEST_ASSERT_EQUAL_INT64(_curPos._stepsFromHome.getVal(axisIdx), pinSteps);
+        TEST_ASSERT_EQUAL_INT64(_curPos._stepsFromHome.getVal(axisIdx), rampGenPos._absStepsFromHome[axisIdx]);
+    }
+}
+
+// Add moves around a square spiral in short blocks
+static void queueSpiral()
+{
+    for (int sideIdx = 0; sideIdx < 12; sideIdx++)
+    {
+        float sideLen = 5.0f + sideIdx * 2.0f;
+        float x = ((sideIdx & 3) == 0 || (sideIdx & 3) == 3) ? sideLen : -sideLen;
+        float y = ((sideIdx & 3) < 2) ? sideLen : -sideLen;
+        queueLine(x, y, int(sideLen));
+    }
+}
+
+// Max change in acceleration (steps per sec^2) from one ms to the next - from the step rate
+// of the segments being executed
+static float maxAccChangePerMs()
+{
+    std::vector<uint32_t> &rates = _simResult._stepRates;
+    float maxChange = 0;
+    for (unsigned int sampleIdx = 2; sampleIdx < rates.size(); sampleIdx++)
+    {
+        float acc1 = (float(rates[sampleIdx - 1]) - float(rates[sampleIdx - 2])) * 1000 / MotionBlock::TTICKS_PER_STEP_PER_SEC;
+        float acc2 = (float(rates[sampleIdx]) - float(rates[sampleIdx - 1])) * 1000 / MotionBlock::TTICKS_PER_STEP_PER_SEC;
+        maxChange = std::max(maxChange, fabsf(acc2 - acc1));
+    }
+    return maxChange;
+}
+
+// RMS change between consecutive step intervals of an axis (relative to the mean interval)
+static float stepIntervalVariation(int axisIdx)
+{
+    std::vector<uint64_t> times = stepTimes(axisIdx);
+    if (times.size() < 3)
+        return 0;
+    double sumSq = 0;
+    for (unsigned int stepIdx = 2; stepIdx < times.size(); stepIdx++)
+    {
+        double change = double(times[stepIdx] - times[stepIdx - 1]) - double(times[stepIdx - 1] - times[stepIdx - 2]);
+        sumSq += change * change;
+    }
+    double meanInterval = double(times.back() - times.front()) / (times.size() - 1);
+    return sqrt(sumSq / (times.size() - 2)) / meanInterval;
+}
+
+void test_step_counts_and_final_position()
+{
+    // All combinations of ramp profile, step timer and step smoothing
+    for (int modeIdx = 0; modeIdx < 8; modeIdx++)
+    {
+        resetSim(TEST_ROBOT_CONFIG);
+        setupSim((modeIdx & 1) != 0, (modeIdx & 2) != 0, (modeIdx & 4) != 0);
+        queueSpiral();
+        runSim();
+        checkFinalPosition();
+    }
+}
+
+void test_jerk_limited_acceleration_continuous()
+{
+    // Accelerate and decelerate along a line made of short blocks - with the trapezoid profile the
+    // acceleration steps at the start and end of each ramp, with the jerk-limited profile it changes
+    // gradually (including where blocks join)
+    float maxAccChange[2];
+    for (int jerkLimited = 0; jerkLimited < 2; jerkLimited++)
+    {
+        resetSim(TEST_ROBOT_CONFIG);
+        setupSim(jerkLimited != 0, false, true);
+        queueLine(80, 0, 40);
+        runSim();
+        checkFinalPosition();
+        maxAccChange[jerkLimited] = maxAccChangePerMs();
+    }
+    float maxAcc = _axesParams.getMaxAccStepsPerSec2(0);
+    TEST_ASSERT_GREATER_THAN(maxAcc, maxAccChange[0]);
+    TEST_ASSERT_LESS_THAN(maxAcc / 2, maxAccChange[1]);
+}
+
+void test_block_joins_keep_step_timing()
+{
+    // Cruise along a line made of 1mm blocks - the steps must stay within a tick of the ideal
+    // timing across the block joins (so no time is lost at a join) - the feedrate is chosen so
+    // that blocks don't take a whole number of ticks
+    for (int stepTimerVariable = 0; stepTimerVariable < 2; stepTimerVariable++)
+    {
+        resetSim(TEST_ROBOT_CONFIG);
+        _feedrate = 45;
+        setupSim(false, stepTimerVariable != 0, true);
+        queueLine(60, 0, 60);
+        runSim();
+        checkFinalPosition();
+        std::vector<uint64_t> times = stepTimes(0);
+        float stepsPerMM = _axesParams.getStepsPerUnit(0);
+        float stepIntervalUs = 1e6f / (_feedrate * stepsPerMM);
+        unsigned int firstStepIdx = int(20 * stepsPerMM);
+        unsigned int lastStepIdx = int(40 * stepsPerMM);
+        for (unsigned int stepIdx = firstStepIdx; stepIdx <= lastStepIdx; stepIdx++)
+        {
+            float idealUs = (stepIdx - firstStepIdx) * stepIntervalUs;
+            TEST_ASSERT_FLOAT_WITHIN(MotionBlock::TICK_INTERVAL_NS / 1000, idealUs, float(times[stepIdx] - times[firstStepIdx]));
+        }
+    }
+}
+
+void test_variable_timer_same_steps()
+{
+    // The variable step timer must give exactly the same steps (at the same times) as the fixed
+    // timer with far fewer ISR calls
+    SimResult simResults[2];
+    for (int stepTimerVariable = 0; stepTimerVariable < 2; stepTimerVariable++)
+    {
+        resetSim(TEST_ROBOT_CONFIG);
+        setupSim(true, stepTimerVariable != 0, true);
+        queueSpiral();
+        runSim();
+        checkFinalPosition();
+        simResults[stepTimerVariable] = _simResult;
+        // When idle the variable timer is called every ms
+        if (stepTimerVariable)
+            TEST_ASSERT_EQUAL(1000, _fakeTimer._periodUs);
+    }
+    TEST_ASSERT_EQUAL(simResults[0]._steps.size(), simResults[1]._steps.size());
+    for (unsigned int stepIdx = 0; stepIdx < simResults[0]._steps.size(); stepIdx++)
+    {
+        StepRecord &step0 = simResults[0]._steps[stepIdx];
+        StepRecord &step1 = simResults[1]._steps[stepIdx];
+        TEST_ASSERT_TRUE(step0._timeUs == step1._timeUs);
+        TEST_ASSERT_EQUAL(step0._axisIdx, step1._axisIdx);
+        TEST_ASSERT_EQUAL(step0._dirnPositive, step1._dirnPositive);
+    }
+    TEST_ASSERT_LESS_THAN(simResults[0]._isrCalls / 3, simResults[1]._isrCalls);
+}
+
+void test_step_smoothing_reduces_variation()
+{
+    // At a low step rate the slower axis steps more evenly with step smoothing
+    float variation[2];
+    for (int stepSmoothing = 0; stepSmoothing < 2; stepSmoothing++)
+    {
+        resetSim(TEST_ROBOT_CONFIG);
+        _feedrate = 2;
+        setupSim(false, false, stepSmoothing != 0);
+        queueLine(20, 7, 10);
+        runSim();
+        checkFinalPosition();
+        variation[stepSmoothing] = stepIntervalVariation(1);
+    }
+    TEST_ASSERT_LESS_THAN(variation[0] / 3, variation[1]);
+}
+
+void test_set_position_applied_by_isr()
+{
+    // While the ISR is running a position change is made by the ISR (the only writer of the snapshot)
+    setupSim(false, true, true);
+    _pRampGenerator->setTotalStepPosition(0, 1000);
+    AxisPosition rampGenPos;
+    TEST_ASSERT_TRUE(_pRampGenerator->getTotalStepPosition(rampGenPos));
+    TEST_ASSERT_EQUAL_INT64(0, rampGenPos._absStepsFromHome[0]);
+    _fakeTimer._isrFn();
+    TEST_ASSERT_TRUE(_pRampGenerator->getTotalStepPosition(rampGenPos));
+    TEST_ASSERT_EQUAL_INT64(1000, rampGenPos._absStepsFromHome[0]);
+
+    // Steps then count from the new position
+    _curPos.setAbsSteps(0, 1000);
+    _curPos._axisPositionMM.setVal(0, 1000 / _axesParams.getStepsPerUnit(0));
+    queueLine(0, 10, 10);
+    runSim();
+    TEST_ASSERT_EQUAL(0, _motionPipeline.count());
+    TEST_ASSERT_TRUE(_pRampGenerator->getTotalStepPosition(rampGenPos));
+    TEST_ASSERT_EQUAL_INT64(0, rampGenPos._absStepsFromHome[0]);
+    TEST_ASSERT_EQUAL_INT64(_curPos._stepsFromHome.getVal(1), rampGenPos._absStepsFromHome[1]);
+}
+
+// Axes with a step rate at max speed of 20000 steps per sec - this is above the max rate of an ISR
+// which needed a tick to start each step and another to end it
+static const char *FAST_ROBOT_CONFIG =
+    "{\"junctionDeviation\":0.05,"
+    "\"axis0\":{\"maxSpeed\":50,\"maxAcc\":200,\"stepsPerRot\":3200,\"unitsPerRot\":8,\"maxRPM\":600},"
+    "\"axis1\":{\"maxSpeed\":50,\"maxAcc\":200,\"stepsPerRot\":3200,\"unitsPerRot\":8,\"maxRPM\":600}}";
+
+void test_high_step_rate()
+{
+    // Check the step rate at cruise (the middle half of the line) is the planned rate
+    for (int stepTimerVariable = 0; stepTimerVariable < 2; stepTimerVariable++)
+    {
+        resetSim(FAST_ROBOT_CONFIG);
+        _feedrate = 50;
+        setupSim(false, stepTimerVariable != 0, true);
+        queueLine(100, 0, 10);
+        runSim();
+        checkFinalPosition();
+        std::vector<uint64_t> times = stepTimes(0);
+        unsigned int numSteps = times.size();
+        float stepsPerSec = (numSteps / 2) * 1e6f / (times[3 * numSteps / 4] - times[numSteps / 4]);
+        TEST_ASSERT_FLOAT_WITHIN(100, _feedrate * _axesParams.getStepsPerUnit(0), stepsPerSec);
+    }
+}
+
+// Step and direction pins for the pin change trace - axis 0 is on the second bank so that one pass
+// over the banks in apply() writes the axes in the opposite order to the axis order
+static const int TRACE_STEP_PINS[NUM_TEST_AXES] = {33, 2};
+static const int TRACE_DIRN_PINS[NUM_TEST_AXES] = {34, 5};
+static const char *TRACE_AXIS_PINS_JSON[NUM_TEST_AXES] = {
+    "{\"stepPin\":\"33\",\"dirnPin\":\"34\"}",
+    "{\"stepPin\":\"2\",\"dirnPin\":\"5\"}"};
+
+// A pin write recorded in the ISR
+struct PinWriteRecord
+{
+    uint64_t _timeUs;
+    uint32_t _isrCallIdx;
+    int _pin;
+    bool _level;
+};
+static std::vector<PinWriteRecord> _pinTrace;
+
+static void recordPinTrace(int pin, bool level)
+{
+    if (_inIsr)
+        _pinTrace.push_back({NativeHw::_curUs, _simResult._isrCalls, pin, level});
+}
+
+void test_pin_change_order()
+{
+    // Zigzag of diagonal lines at a high step rate (both axes step on the same ticks) - axis 0
+    // reverses at each corner and a large junction deviation keeps the corners fast so steps are
+    // due soon after each direction change
+    const int NUM_ZIGZAG_LINES = 16;
+    const int ZIGZAG_LINE_STEPS = 800;
+    for (int stepTimerVariable = 0; stepTimerVariable < 2; stepTimerVariable++)
+    {
+        resetSim(FAST_ROBOT_CONFIG);
+        _feedrate = 50;
+        _motionPlanner.configure(5.0f, false);
+        for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+            _pRampGenerator->configureAxis(axisIdx, TRACE_AXIS_PINS_JSON[axisIdx]);
+        _pRampGenerator->configure(true, stepTimerVariable != 0, true, false);
+        _pRampGenerator->pause(false);
+        _pinTrace.clear();
+        NativeHw::_pinWriteCb = recordPinTrace;
+        int pinLevels[NativeHw::MAX_PINS];
+        for (int pin = 0; pin < NativeHw::MAX_PINS; pin++)
+            pinLevels[pin] = digitalRead(pin);
+        for (int lineIdx = 1; lineIdx <= NUM_ZIGZAG_LINES; lineIdx++)
+            queueLine((lineIdx % 2) ? 2.0f : 0.0f, lineIdx * 2.0f, 2);
+        runSim();
+        TEST_ASSERT_EQUAL(0, _motionPipeline.count());
+
+        // The writes of each ISR call are a single pass over the pins in bank and bit order
+        for (unsigned int writeIdx = 1; writeIdx < _pinTrace.size(); writeIdx++)
+            if (_pinTrace[writeIdx]._isrCallIdx == _pinTrace[writeIdx - 1]._isrCallIdx)
+                TEST_ASSERT_GREATER_THAN(_pinTrace[writeIdx - 1]._pin, _pinTrace[writeIdx]._pin);
+
+        // Both axes step on the same ticks along the diagonals - the steps must change in the same
+        // apply() - and a direction change must be at least a tick before the next step edge
+        uint64_t tickUs = MotionBlock::TICK_INTERVAL_NS / 1000;
+        int numDirnChanges = 0;
+        int numSameApplySteps = 0;
+        uint64_t lastDirnChangeUs[NUM_TEST_AXES] = {};
+        uint32_t lastStepIsrCallIdx[NUM_TEST_AXES] = {UINT32_MAX, UINT32_MAX};
+        int64_t stepCounts[NUM_TEST_AXES] = {};
+        int64_t absStepCounts[NUM_TEST_AXES] = {};
+        for (PinWriteRecord &pinWrite : _pinTrace)
+        {
+            for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+            {
+                if ((pinWrite._pin == TRACE_DIRN_PINS[axisIdx]) && (pinWrite._level != pinLevels[pinWrite._pin]))
+                {
+                    lastDirnChangeUs[axisIdx] = pinWrite._timeUs;
+                    numDirnChanges++;
+                }
+                if ((pinWrite._pin == TRACE_STEP_PINS[axisIdx]) && pinWrite._level && !pinLevels[pinWrite._pin])
+                {
+                    TEST_ASSERT_GREATER_OR_EQUAL(lastDirnChangeUs[axisIdx] + tickUs, pinWrite._timeUs);
+                    // Positive direction is a low direction pin
+                    stepCounts[axisIdx] += pinLevels[TRACE_DIRN_PINS[axisIdx]] ? -1 : 1;
+                    absStepCounts[axisIdx]++;
+                    lastStepIsrCallIdx[axisIdx] = pinWrite._isrCallIdx;
+                    if (lastStepIsrCallIdx[1 - axisIdx] == pinWrite._isrCallIdx)
+                        numSameApplySteps++;
+                }
+            }
+            pinLevels[pinWrite._pin] = pinWrite._level;
+        }
+        TEST_ASSERT_EQUAL(NUM_ZIGZAG_LINES - 1, numDirnChanges);
+        TEST_ASSERT_EQUAL_INT64(NUM_ZIGZAG_LINES * ZIGZAG_LINE_STEPS, absStepCounts[0]);
+        TEST_ASSERT_EQUAL_INT64(NUM_ZIGZAG_LINES * ZIGZAG_LINE_STEPS, absStepCounts[1]);
+        TEST_ASSERT_EQUAL(NUM_ZIGZAG_LINES * ZIGZAG_LINE_STEPS, numSameApplySteps);
+        for (int axisIdx = 0; axisIdx < NUM_TEST_AXES; axisIdx++)
+            TEST_ASSERT_EQUAL_INT64(_curPos._stepsFromHome.getVal(axisIdx), stepCounts[axisIdx]);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_step_counts_and_final_position);
+    RUN_TEST(test_jerk_limited_acceleration_continuous);
+    RUN_TEST(test_high_step_rate);
+    RUN_TEST(test_block_joins_keep_step_timing);
+    RUN_TEST(test_variable_timer_same_steps);
+    RUN_TEST(test_step_smoothing_reduces_variation);
+    RUN_TEST(test_set_position_applied_by_isr);
+    RUN_TEST(test_pin_change_order);
+    return UNITY_END();
+}
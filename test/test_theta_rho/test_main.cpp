@@ -0,0 +1,141 @@
+// RBotFirmware
+// Rob Dobson 2016-18
+
+// Theta-rho tests
+// Points along each line of a theta-rho file are interpolated in float from the start of the line
+// (wrapped to one turn) and the step number - these tests check the points against a double
+// reference over long patterns in which theta goes many turns from zero
+
+#include <unity.h>
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include "FastTrig.h"
+#include "WorkManager/Evaluators/EvaluatorThetaRhoLine.h"
+
+static const float BED_RADIUS_MM = 145;
+static const float STEP_ANGLE = float(M_PI / 64);
+
+// Line of a theta-rho file
+struct ThetaRho
+{
+    double theta;
+    float rho;
+};
+
+static std::vector<ThetaRho> _pattern;
+
+void setUp()
+{
+    _pattern.clear();
+}
+
+void tearDown()
+{
+}
+
+// Interpolate the pattern as EvaluatorThetaRhoLine does (without step adaptation) and return the max
+// distance (mm) of the points from the double reference - unwrappedErrMM is the max error if the
+// points were instead summed in float from the unwrapped start of each line
+static double interpolatePattern(double &unwrappedErrMM)
+{
+    double maxErrMM = 0;
+    unwrappedErrMM = 0;
+    double prevTheta = _pattern[0].theta;
+    float prevRho = _pattern[0].rho;
+    for (size_t lineIdx = 1; lineIdx < _pattern.size(); lineIdx++)
+    {
+        double newTheta = _pattern[lineIdx].theta;
+        float newRho = _pattern[lineIdx].rho;
+        float deltaTheta = newTheta - prevTheta;
+        float absDeltaTheta = fabsf(deltaTheta);
+        float deltaRho = newRho - prevRho;
+        float thetaInc = deltaTheta >= 0 ? STEP_ANGLE : -STEP_ANGLE;
+        float rhoInc = deltaRho;
+        int interpolateSteps = 1;
+        if (absDeltaTheta < STEP_ANGLE)
+        {
+            thetaInc = deltaTheta;
+        }
+        else
+        {
+            interpolateSteps = int(floorf(absDeltaTheta / STEP_ANGLE));
+            rhoInc = deltaRho * STEP_ANGLE / absDeltaTheta;
+        }
+        float lineStartTheta = EvaluatorThetaRhoLine::wrapThetaToTurn(prevTheta);
+        float unwrappedTheta = float(prevTheta);
+        float unwrappedRho = prevRho;
+        for (int stepIdx = 1; stepIdx <= interpolateSteps; stepIdx++)
+        {
+            double refTheta = prevTheta + stepIdx * double(thetaInc);
+            double refRho = prevRho + stepIdx * double(rhoInc);
+            double refX = sin(refTheta) * refRho * BED_RADIUS_MM;
+            double refY = cos(refTheta) * refRho * BED_RADIUS_MM;
+
+            float sinTheta = 0, cosTheta = 0;
+            float rho = prevRho + stepIdx * rhoInc;
+            FastTrig::sinCosRad(lineStartTheta + stepIdx * thetaInc, sinTheta, cosTheta);
+            maxErrMM = std::max(maxErrMM, hypot(sinTheta * rho * BED_RADIUS_MM - refX, cosTheta * rho * BED_RADIUS_MM - refY));
+
+            unwrappedTheta += thetaInc;
+            unwrappedRho += rhoInc;
+            FastTrig::sinCosRad(unwrappedTheta, sinTheta, cosTheta);
+            unwrappedErrMM = std::max(unwrappedErrMM,
+                        hypot(sinTheta * unwrappedRho * BED_RADIUS_MM - refX, cosTheta * unwrappedRho * BED_RADIUS_MM - refY));
+        }
+        prevTheta = newTheta;
+        prevRho = newRho;
+    }
+    return maxErrMM;
+}
+
+void test_wrap_theta_to_turn()
+{
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 1.0f, EvaluatorThetaRhoLine::wrapThetaToTurn(1));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, float(2 * M_PI - 1), EvaluatorThetaRhoLine::wrapThetaToTurn(-1));
+    // Far from zero the result is still accurate to float precision
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, EvaluatorThetaRhoLine::wrapThetaToTurn(1000 * 2 * M_PI + 0.5));
+    TEST_ASSERT_FLOAT_WITHIN(1e-6f, 0.5f, EvaluatorThetaRhoLine::wrapThetaToTurn(-1000 * 2 * M_PI + 0.5));
+}
+
+void test_long_patterns()
+{
+    double unwrappedErrMM = 0;
+
+    // Spiral out over 300 turns
+    const int SPIRAL_LINES = 40000;
+    for (int lineIdx = 0; lineIdx <= SPIRAL_LINES; lineIdx++)
+        _pattern.push_back({300 * 2 * M_PI * lineIdx / SPIRAL_LINES, float(lineIdx) / SPIRAL_LINES});
+    double errMM = interpolatePattern(unwrappedErrMM);
+    printf("Spiral max error %.2fum (summed from unwrapped start %.2fum)\n", errMM * 1000, unwrappedErrMM * 1000);
+    TEST_ASSERT_LESS_THAN(0.005, errMM);
+
+    // Rose over 400 turns
+    const int ROSE_LINES = 50000;
+    _pattern.clear();
+    for (int lineIdx = 0; lineIdx <= ROSE_LINES; lineIdx++)
+    {
+        double theta = 400 * 2 * M_PI * lineIdx / ROSE_LINES;
+        _pattern.push_back({theta, float(fabs(sin(theta * 7 / 3)))});
+    }
+    errMM = interpolatePattern(unwrappedErrMM);
+    printf("Rose max error %.2fum (summed from unwrapped start %.2fum)\n", errMM * 1000, unwrappedErrMM * 1000);
+    TEST_ASSERT_LESS_THAN(0.005, errMM);
+
+    // Long lines - 8 turns each between the edge and near the centre
+    _pattern.clear();
+    for (int lineIdx = 0; lineIdx <= 250; lineIdx++)
+        _pattern.push_back({8 * 2 * M_PI * lineIdx, (lineIdx % 2) ? 0.2f : 1.0f});
+    errMM = interpolatePattern(unwrappedErrMM);
+    printf("Long lines max error %.2fum (summed from unwrapped start %.2fum)\n", errMM * 1000, unwrappedErrMM * 1000);
+    TEST_ASSERT_LESS_THAN(0.005, errMM);
+    TEST_ASSERT_GREATER_THAN(errMM, unwrappedErrMM);
+}
+
+int main(int argc, char **argv)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_wrap_theta_to_turn);
+    RUN_TEST(test_long_patterns);
+    return UNITY_END();
+}